@@ -0,0 +1,435 @@
+/*
+ * Character set detection for subtitle files
+ *
+ * Guesses the character set of a text from a single pass over a sample of
+ * it: byte order marks, zero bytes for BOM-less UTF-16, UTF-8 validity,
+ * the structure of the common CJK multi-byte encodings, and for the
+ * single-byte encodings of the subtitle encoding table, a score of how
+ * likely each high byte is to be a letter of the languages they're used for.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "bacon-video-charset.h"
+
+#define SAMPLE_SIZE (64 * 1024)
+
+/* The preferred character set wins if it scores within
+ * this fraction of the best one */
+#define PREFERRED_SCORE_MARGIN 0.05
+
+#define LETTERS_WESTERN "éäöüàèáíóúçñãêßôâîûëïùõœ"
+#define LETTERS_CENTRAL_EUROPEAN "ěščřžýáíéůúňťďóąęłńśźżőűĺľ"
+#define LETTERS_CYRILLIC "оеаинтсрвлкмдпуяыьгзбчйхжшюцщэфъёіїєґў"
+#define LETTERS_GREEK "αοεινταςρπμλκυηωδγχθφβζξψάέήίόύώϊϋ"
+#define LETTERS_TURKISH "ıüşöçğâîû"
+#define LETTERS_BALTIC "ąčęėįšųūžāēīļņķģõäöü"
+#define LETTERS_HEBREW "יוהלאמתבשרנעכדקפחסטגזצםןךףץ"
+#define LETTERS_ARABIC "اليمونهرتبكعدسفقحجشطصىخثزضغذظءأإآةؤئ"
+#define LETTERS_THAI "กขคงจฉชซญดตถทธนบปผพฟภมยรลวศษสหอฮะัาำิีึืุูเแโใไ่้๊๋็์"
+#define LETTERS_VIETNAMESE "ăâđêôơư\xcc\x80\xcc\x81\xcc\x83\xcc\x89\xcc\xa3"
+#define LETTERS_ROMANIAN "ăâîșțşţ"
+#define LETTERS_NORDIC "åäöæøðþáéíóúý"
+
+typedef struct {
+  const char *charset;
+  const char *letters; /* the most common non-ASCII letters of its
+			* languages, most frequent first */
+  gboolean    latin; /* whether those letters mix with ASCII ones */
+} SingleByteCharset;
+
+/* In order of preference for ties */
+static const SingleByteCharset single_byte_charsets[] = {
+  { "WINDOWS-1252", LETTERS_WESTERN, TRUE },
+  { "ISO-8859-15", LETTERS_WESTERN, TRUE },
+  { "ISO-8859-1", LETTERS_WESTERN, TRUE },
+  { "WINDOWS-1250", LETTERS_CENTRAL_EUROPEAN, TRUE },
+  { "ISO-8859-2", LETTERS_CENTRAL_EUROPEAN, TRUE },
+  { "WINDOWS-1251", LETTERS_CYRILLIC, FALSE },
+  { "KOI8-R", LETTERS_CYRILLIC, FALSE },
+  { "KOI8-U", LETTERS_CYRILLIC, FALSE },
+  { "ISO-8859-5", LETTERS_CYRILLIC, FALSE },
+  { "CP866", LETTERS_CYRILLIC, FALSE },
+  { "WINDOWS-1253", LETTERS_GREEK, FALSE },
+  { "ISO-8859-7", LETTERS_GREEK, FALSE },
+  { "WINDOWS-1254", LETTERS_TURKISH, TRUE },
+  { "ISO-8859-9", LETTERS_TURKISH, TRUE },
+  { "WINDOWS-1257", LETTERS_BALTIC, TRUE },
+  { "ISO-8859-13", LETTERS_BALTIC, TRUE },
+  { "ISO-8859-4", LETTERS_BALTIC, TRUE },
+  { "WINDOWS-1255", LETTERS_HEBREW, FALSE },
+  { "ISO-8859-8", LETTERS_HEBREW, FALSE },
+  { "WINDOWS-1256", LETTERS_ARABIC, FALSE },
+  { "ISO-8859-6", LETTERS_ARABIC, FALSE },
+  { "TIS-620", LETTERS_THAI, FALSE },
+  { "WINDOWS-1258", LETTERS_VIETNAMESE, TRUE },
+  { "ISO-8859-16", LETTERS_ROMANIAN, TRUE },
+  { "ISO-8859-10", LETTERS_NORDIC, TRUE }
+};
+
+/* How likely each byte from 0x80 up is to appear in a text in
+ * each of the above, built from the system's conversion tables */
+static gint8 weights[G_N_ELEMENTS (single_byte_charsets)][128];
+
+/* Returns the length of the character starting with the non-ASCII
+ * byte at @p, or 0 if it's not valid, and whether it is one of the
+ * frequently used characters of the language */
+typedef guint (*CharLenFunc) (const guchar *p, const guchar *end, gboolean *common);
+
+typedef struct {
+  const char  *charset;
+  CharLenFunc  char_len;
+} MultiByteCharset;
+
+static guint
+gb18030_char_len (const guchar *p, const guchar *end, gboolean *common)
+{
+  if (end - p < 2 || p[0] < 0x81 || p[0] > 0xfe)
+    return 0;
+
+  if (p[1] >= 0x30 && p[1] <= 0x39) {
+    if (end - p < 4 ||
+	p[2] < 0x81 || p[2] > 0xfe ||
+	p[3] < 0x30 || p[3] > 0x39)
+      return 0;
+    *common = FALSE;
+    return 4;
+  }
+
+  if (p[1] < 0x40 || p[1] == 0x7f || p[1] == 0xff)
+    return 0;
+
+  /* GB2312 level 1 hanzi */
+  *common = (p[0] >= 0xb0 && p[0] <= 0xd7 && p[1] >= 0xa1);
+  return 2;
+}
+
+static guint
+big5_char_len (const guchar *p, const guchar *end, gboolean *common)
+{
+  if (end - p < 2 || p[0] < 0xa1 || p[0] > 0xf9)
+    return 0;
+  if (!((p[1] >= 0x40 && p[1] <= 0x7e) || (p[1] >= 0xa1 && p[1] <= 0xfe)))
+    return 0;
+
+  /* Frequently used hanzi */
+  *common = (p[0] >= 0xa4 && p[0] <= 0xc6);
+  return 2;
+}
+
+static guint
+euc_kr_char_len (const guchar *p, const guchar *end, gboolean *common)
+{
+  if (end - p < 2 ||
+      p[0] < 0xa1 || p[0] > 0xfe ||
+      p[1] < 0xa1 || p[1] > 0xfe)
+    return 0;
+
+  /* Hangul syllables */
+  *common = (p[0] >= 0xb0 && p[0] <= 0xc8);
+  return 2;
+}
+
+static guint
+euc_jp_char_len (const guchar *p, const guchar *end, gboolean *common)
+{
+  *common = FALSE;
+
+  if (p[0] == 0x8e) {
+    if (end - p < 2 || p[1] < 0xa1 || p[1] > 0xdf)
+      return 0;
+    return 2;
+  }
+  if (p[0] == 0x8f) {
+    if (end - p < 3 ||
+	p[1] < 0xa1 || p[1] > 0xfe ||
+	p[2] < 0xa1 || p[2] > 0xfe)
+      return 0;
+    return 3;
+  }
+
+  if (end - p < 2 ||
+      p[0] < 0xa1 || p[0] > 0xfe ||
+      p[1] < 0xa1 || p[1] > 0xfe)
+    return 0;
+
+  /* Kana and level 1 kanji */
+  *common = (p[0] == 0xa4 || p[0] == 0xa5 || (p[0] >= 0xb0 && p[0] <= 0xcf));
+  return 2;
+}
+
+static guint
+shift_jis_char_len (const guchar *p, const guchar *end, gboolean *common)
+{
+  *common = FALSE;
+
+  /* Half-width katakana */
+  if (p[0] >= 0xa1 && p[0] <= 0xdf)
+    return 1;
+
+  if (end - p < 2 ||
+      !((p[0] >= 0x81 && p[0] <= 0x9f) || (p[0] >= 0xe0 && p[0] <= 0xfc)) ||
+      p[1] < 0x40 || p[1] == 0x7f || p[1] > 0xfc)
+    return 0;
+
+  /* Kana and level 1 kanji */
+  *common = (p[0] == 0x82 || p[0] == 0x83 || (p[0] >= 0x88 && p[0] <= 0x98));
+  return 2;
+}
+
+/* Korean text is also valid, and as common, as GB18030
+ * and EUC-JP, so it wins the ties */
+static const MultiByteCharset multi_byte_charsets[] = {
+  { "EUC-KR", euc_kr_char_len },
+  { "GB18030", gb18030_char_len },
+  { "BIG5", big5_char_len },
+  { "EUC-JP", euc_jp_char_len },
+  { "SHIFT-JIS", shift_jis_char_len }
+};
+
+static gint8
+byte_weight (const char *utf8, const char *letters)
+{
+  const char *letter;
+  gunichar c;
+
+  if (utf8 == NULL || *utf8 == '\0')
+    return -10;
+
+  c = g_utf8_get_char (utf8);
+  if (g_unichar_iscntrl (c) || !g_unichar_isdefined (c))
+    return -10;
+
+  letter = g_utf8_strchr (letters, -1, c);
+  if (letter != NULL) {
+    if (g_utf8_pointer_to_offset (letters, letter) < g_utf8_strlen (letters, -1) / 2)
+      return 4;
+    return 3;
+  }
+  if (g_unichar_isupper (c) && g_utf8_strchr (letters, -1, g_unichar_tolower (c)) != NULL)
+    return 2;
+  if (g_unichar_isalpha (c))
+    return 1;
+
+  return 0;
+}
+
+static gpointer
+build_weights (gpointer data)
+{
+  guint i, byte;
+
+  for (i = 0; i < G_N_ELEMENTS (single_byte_charsets); i++) {
+    for (byte = 0x80; byte <= 0xff; byte++) {
+      char str = byte;
+      char *utf8;
+
+      utf8 = g_convert (&str, 1, "UTF-8", single_byte_charsets[i].charset, NULL, NULL, NULL);
+      weights[i][byte - 0x80] = byte_weight (utf8, single_byte_charsets[i].letters);
+      g_free (utf8);
+    }
+  }
+
+  return NULL;
+}
+
+/* Returns the number of characters, and of frequently used ones,
+ * or FALSE if the text isn't valid in that encoding */
+static gboolean
+check_multi_byte (const MultiByteCharset *charset,
+		  const guchar           *p,
+		  const guchar           *end,
+		  gboolean                truncated,
+		  guint                  *n_chars,
+		  guint                  *n_common)
+{
+  *n_chars = *n_common = 0;
+
+  while (p < end) {
+    gboolean common;
+    guint len;
+
+    if (*p < 0x80) {
+      p++;
+      continue;
+    }
+
+    len = charset->char_len (p, end, &common);
+    if (len == 0) {
+      /* The sample might have cut the last character */
+      if (truncated && end - p < 4)
+	break;
+      return FALSE;
+    }
+
+    (*n_chars)++;
+    if (common)
+      (*n_common)++;
+    p += len;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+is_preferred (const char *charset, const char *preferred)
+{
+  return preferred != NULL && g_ascii_strcasecmp (charset, preferred) == 0;
+}
+
+/**
+ * bacon_video_charset_detect:
+ * @data: the text to look at
+ * @len: the length of @data, in bytes
+ * @preferred: (allow-none): the character set to use when unsure, usually
+ * the one the user picked
+ *
+ * Guesses the character set of @data, looking at its first 64 kB at most.
+ *
+ * Return value: the name of the character set, as understood by g_convert(),
+ * or @preferred if none matched; the string must not be freed
+ **/
+const char *
+bacon_video_charset_detect (const char *data,
+			    gsize       len,
+			    const char *preferred)
+{
+  static GOnce weights_once = G_ONCE_INIT;
+  const guchar *p = (const guchar *) data;
+  gsize sample_len, i;
+  guint counts[128];
+  guint n_high = 0, n_in_ascii_words = 0, n_escapes = 0, zeros_even = 0, zeros_odd = 0;
+  const char *valid_end, *best;
+  gdouble best_score, preferred_score;
+  gboolean truncated, have_preferred;
+
+  g_return_val_if_fail (data != NULL, NULL);
+
+  /* Byte order marks */
+  if (len >= 3 && memcmp (data, "\xef\xbb\xbf", 3) == 0)
+    return "UTF-8";
+  if (len >= 4 && memcmp (data, "\xff\xfe\x00\x00", 4) == 0)
+    return "UTF-32LE";
+  if (len >= 4 && memcmp (data, "\x00\x00\xfe\xff", 4) == 0)
+    return "UTF-32BE";
+  if (len >= 2 && memcmp (data, "\xff\xfe", 2) == 0)
+    return "UTF-16LE";
+  if (len >= 2 && memcmp (data, "\xfe\xff", 2) == 0)
+    return "UTF-16BE";
+
+  truncated = (len > SAMPLE_SIZE);
+  sample_len = MIN (len, SAMPLE_SIZE);
+
+  memset (counts, 0, sizeof (counts));
+  for (i = 0; i < sample_len; i++) {
+    if (p[i] >= 0x80) {
+      counts[p[i] - 0x80]++;
+      n_high++;
+      if ((i > 0 && g_ascii_isalpha (p[i - 1])) ||
+	  (i + 1 < sample_len && g_ascii_isalpha (p[i + 1])))
+	n_in_ascii_words++;
+    } else if (p[i] == 0x00) {
+      if (i % 2 == 0)
+	zeros_even++;
+      else
+	zeros_odd++;
+    } else if (p[i] == 0x1b) {
+      n_escapes++;
+    }
+  }
+
+  /* BOM-less UTF-16: subtitles are mostly digits,
+   * punctuation and spaces, so every other byte is zero */
+  if (zeros_odd > sample_len / 4)
+    return "UTF-16LE";
+  if (zeros_even > sample_len / 4)
+    return "UTF-16BE";
+
+  if (n_high == 0) {
+    if (n_escapes > 0) {
+      if (g_strstr_len (data, sample_len, "\x1b$B") != NULL ||
+	  g_strstr_len (data, sample_len, "\x1b$@") != NULL)
+	return "ISO-2022-JP";
+      if (g_strstr_len (data, sample_len, "\x1b$)C") != NULL)
+	return "ISO-2022-KR";
+    }
+    /* Plain ASCII */
+    return "UTF-8";
+  }
+
+  if (g_utf8_validate (data, sample_len, &valid_end) ||
+      (truncated && valid_end - data > (gssize) sample_len - 4))
+    return "UTF-8";
+
+  /* Multi-byte encodings only apply if the whole sample is valid,
+   * and mostly made of the language's common characters */
+  best = NULL;
+  best_score = 0.5;
+  for (i = 0; i < G_N_ELEMENTS (multi_byte_charsets); i++) {
+    guint n_chars, n_common;
+    gdouble score;
+
+    if (!check_multi_byte (&multi_byte_charsets[i], p, p + sample_len, truncated, &n_chars, &n_common) ||
+	n_chars == 0)
+      continue;
+
+    score = (gdouble) n_common / n_chars;
+    if (score > best_score ||
+	(score == best_score && is_preferred (multi_byte_charsets[i].charset, preferred))) {
+      best = multi_byte_charsets[i].charset;
+      best_score = score;
+    }
+  }
+  if (best != NULL)
+    return best;
+
+  g_once (&weights_once, build_weights, NULL);
+
+  best = NULL;
+  best_score = preferred_score = 0;
+  have_preferred = FALSE;
+  for (i = 0; i < G_N_ELEMENTS (single_byte_charsets); i++) {
+    gdouble score = 0;
+    guint byte;
+
+    for (byte = 0; byte < 128; byte++)
+      score += (gdouble) counts[byte] * weights[i][byte];
+
+    /* Non-latin letters don't usually sit next to latin ones */
+    if (!single_byte_charsets[i].latin)
+      score -= 4.0 * n_in_ascii_words;
+
+    if (best == NULL || score > best_score) {
+      best = single_byte_charsets[i].charset;
+      best_score = score;
+    }
+    if (is_preferred (single_byte_charsets[i].charset, preferred)) {
+      have_preferred = TRUE;
+      preferred_score = score;
+    }
+  }
+
+  if (have_preferred && preferred_score >= best_score - ABS (best_score) * PREFERRED_SCORE_MARGIN)
+    return g_intern_string (preferred);
+  if (best_score <= 0)
+    return preferred ? g_intern_string (preferred) : NULL;
+
+  return best;
+}
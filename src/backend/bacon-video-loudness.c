@@ -0,0 +1,756 @@
+/*
+ * Loudness measurement and cache for loudness normalisation
+ *
+ * Measures the integrated loudness and sample peak of files as defined by
+ * EBU R128 / ITU-R BS.1770, by decoding only their audio as fast as it
+ * goes, without a clock. The results are kept in a small cache in the
+ * user's cache directory, keyed by a fingerprint of the contents of the
+ * file, so that they are there the next time the file is opened, even
+ * if it was moved or renamed.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n-lib.h>
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#include "bacon-video-loudness.h"
+
+/* The fingerprint covers the size of the file, and this much
+ * of its start and of its end */
+#define FINGERPRINT_CHUNK (64 * 1024)
+
+/* Everything is resampled to 48 kHz, which the K-weighting
+ * coefficients below are for */
+#define ANALYSIS_RATE 48000
+#define ANALYSIS_MAX_CHANNELS 8
+
+/* Gating blocks are 400 ms long and overlap by 75%, so they're
+ * made of four 100 ms sub-blocks */
+#define SUB_BLOCK_FRAMES (ANALYSIS_RATE / 10)
+#define SUB_BLOCKS_PER_BLOCK 4
+
+#define ABSOLUTE_GATE (-70.0) /* LUFS */
+#define RELATIVE_GATE (-10.0) /* LU */
+
+/* K-weighting: a high shelf for the head, then a high pass */
+#define SHELF_B0 1.53512485958697
+#define SHELF_B1 (-2.69169618940638)
+#define SHELF_B2 1.19839281085285
+#define SHELF_A1 (-1.69065929318241)
+#define SHELF_A2 0.73248077421585
+#define HIGHPASS_A1 (-1.99004745483398)
+#define HIGHPASS_A2 0.99007225036621
+
+/* Highest gain applied, which is the most the volume element allows */
+#define MAX_GAIN 10.0
+
+/* Not in a public header, but part of decodebin's API */
+typedef enum {
+  AUTOPLUG_SELECT_TRY,
+  AUTOPLUG_SELECT_EXPOSE,
+  AUTOPLUG_SELECT_SKIP
+} AutoplugSelectResult;
+
+static gdouble
+power_to_loudness (gdouble power)
+{
+  return -0.691 + 10.0 * log10 (power);
+}
+
+static gdouble
+loudness_to_power (gdouble loudness)
+{
+  return pow (10.0, (loudness + 0.691) / 10.0);
+}
+
+/* Fingerprints */
+
+static char *
+loudness_fingerprint (GFile         *file,
+		      GCancellable  *cancellable,
+		      GError       **error)
+{
+  GFileInputStream *stream;
+  GFileInfo *info;
+  GChecksum *checksum;
+  guchar *buffer;
+  goffset size;
+  gsize len;
+  char *size_str, *fingerprint = NULL;
+
+  stream = g_file_read (file, cancellable, error);
+  if (stream == NULL)
+    return NULL;
+
+  info = g_file_input_stream_query_info (stream, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					 cancellable, error);
+  if (info == NULL)
+    goto out;
+  size = g_file_info_get_size (info);
+  g_object_unref (info);
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  size_str = g_strdup_printf ("%" G_GINT64_FORMAT, (gint64) size);
+  g_checksum_update (checksum, (const guchar *) size_str, -1);
+  g_free (size_str);
+
+  buffer = g_malloc (FINGERPRINT_CHUNK);
+  if (!g_input_stream_read_all (G_INPUT_STREAM (stream), buffer, FINGERPRINT_CHUNK,
+				&len, cancellable, error))
+    goto done;
+  g_checksum_update (checksum, buffer, len);
+
+  if (size > 2 * FINGERPRINT_CHUNK) {
+    if (!g_seekable_seek (G_SEEKABLE (stream), size - FINGERPRINT_CHUNK, G_SEEK_SET,
+			  cancellable, error) ||
+	!g_input_stream_read_all (G_INPUT_STREAM (stream), buffer, FINGERPRINT_CHUNK,
+				  &len, cancellable, error))
+      goto done;
+    g_checksum_update (checksum, buffer, len);
+  }
+
+  fingerprint = g_strdup (g_checksum_get_string (checksum));
+
+done:
+  g_free (buffer);
+  g_checksum_free (checksum);
+out:
+  g_input_stream_close (G_INPUT_STREAM (stream), NULL, NULL);
+  g_object_unref (stream);
+  return fingerprint;
+}
+
+/* The cache, which is a text file with a "fingerprint loudness peak"
+ * line per file, appended to as files get measured */
+
+static GHashTable *loudness_cache = NULL;
+G_LOCK_DEFINE_STATIC (loudness_cache);
+
+static char *
+loudness_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "xplayer", "loudness", NULL);
+}
+
+/* Called with the lock held */
+static void
+loudness_cache_ensure (void)
+{
+  char *path, *contents;
+  char **lines;
+  guint i;
+
+  if (loudness_cache != NULL)
+    return;
+
+  loudness_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  path = loudness_cache_path ();
+  if (!g_file_get_contents (path, &contents, NULL, NULL)) {
+    g_free (path);
+    return;
+  }
+  g_free (path);
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i] != NULL; i++) {
+    BaconVideoLoudness *loudness;
+    char **fields;
+
+    fields = g_strsplit (lines[i], " ", 3);
+    if (g_strv_length (fields) == 3) {
+      loudness = g_new (BaconVideoLoudness, 1);
+      loudness->loudness = g_ascii_strtod (fields[1], NULL);
+      loudness->peak = g_ascii_strtod (fields[2], NULL);
+      g_hash_table_replace (loudness_cache, g_strdup (fields[0]), loudness);
+    }
+    g_strfreev (fields);
+  }
+  g_strfreev (lines);
+}
+
+static gboolean
+loudness_cache_lookup (const char         *fingerprint,
+		       BaconVideoLoudness *loudness)
+{
+  BaconVideoLoudness *cached;
+
+  G_LOCK (loudness_cache);
+  loudness_cache_ensure ();
+  cached = g_hash_table_lookup (loudness_cache, fingerprint);
+  if (cached != NULL)
+    *loudness = *cached;
+  G_UNLOCK (loudness_cache);
+
+  return (cached != NULL);
+}
+
+static void
+loudness_cache_store (const char               *fingerprint,
+		      const BaconVideoLoudness *loudness)
+{
+  char loudness_str[G_ASCII_DTOSTR_BUF_SIZE], peak_str[G_ASCII_DTOSTR_BUF_SIZE];
+  BaconVideoLoudness *cached;
+  char *path, *dir, *line;
+  GFileOutputStream *stream;
+  GFile *file;
+  GError *error = NULL;
+
+  G_LOCK (loudness_cache);
+  loudness_cache_ensure ();
+  cached = g_new (BaconVideoLoudness, 1);
+  *cached = *loudness;
+  g_hash_table_replace (loudness_cache, g_strdup (fingerprint), cached);
+
+  path = loudness_cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0700);
+  g_free (dir);
+
+  file = g_file_new_for_path (path);
+  g_free (path);
+  stream = g_file_append_to (file, G_FILE_CREATE_PRIVATE, NULL, &error);
+  g_object_unref (file);
+
+  if (stream != NULL) {
+    line = g_strdup_printf ("%s %s %s\n", fingerprint,
+			    g_ascii_formatd (loudness_str, sizeof (loudness_str), "%.2f", loudness->loudness),
+			    g_ascii_formatd (peak_str, sizeof (peak_str), "%.6f", loudness->peak));
+    g_output_stream_write_all (G_OUTPUT_STREAM (stream), line, strlen (line), NULL, NULL, &error);
+    g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, NULL);
+    g_object_unref (stream);
+    g_free (line);
+  }
+  G_UNLOCK (loudness_cache);
+
+  if (error != NULL) {
+    g_warning ("Couldn't save the loudness of a file: %s", error->message);
+    g_error_free (error);
+  }
+}
+
+/* Measurement */
+
+typedef struct {
+  GstCaps *caps;
+  guint    channels;
+  gdouble  weights[ANALYSIS_MAX_CHANNELS];
+  gdouble  state[ANALYSIS_MAX_CHANNELS][4];
+
+  gdouble  sub_block_sum;
+  guint    sub_block_len;
+  gdouble  sub_blocks[SUB_BLOCKS_PER_BLOCK];
+  guint    n_sub_blocks;
+
+  GArray  *blocks; /* mean square of each gating block */
+  gdouble  peak;
+} Analysis;
+
+static void
+analysis_configure (Analysis *analysis,
+		    GstCaps  *caps)
+{
+  GstAudioInfo info;
+  guint i;
+
+  gst_caps_replace (&analysis->caps, caps);
+  memset (analysis->state, 0, sizeof (analysis->state));
+
+  if (!gst_audio_info_from_caps (&info, caps) ||
+      GST_AUDIO_INFO_CHANNELS (&info) > ANALYSIS_MAX_CHANNELS) {
+    analysis->channels = 0;
+    return;
+  }
+
+  analysis->channels = GST_AUDIO_INFO_CHANNELS (&info);
+  for (i = 0; i < analysis->channels; i++) {
+    if (GST_AUDIO_INFO_IS_UNPOSITIONED (&info)) {
+      analysis->weights[i] = 1.0;
+      continue;
+    }
+
+    switch (GST_AUDIO_INFO_POSITION (&info, i)) {
+      case GST_AUDIO_CHANNEL_POSITION_LFE1:
+      case GST_AUDIO_CHANNEL_POSITION_LFE2:
+	analysis->weights[i] = 0.0;
+	break;
+      case GST_AUDIO_CHANNEL_POSITION_REAR_LEFT:
+      case GST_AUDIO_CHANNEL_POSITION_REAR_RIGHT:
+      case GST_AUDIO_CHANNEL_POSITION_SIDE_LEFT:
+      case GST_AUDIO_CHANNEL_POSITION_SIDE_RIGHT:
+	analysis->weights[i] = 1.41;
+	break;
+      default:
+	analysis->weights[i] = 1.0;
+	break;
+    }
+  }
+}
+
+static void
+analysis_end_sub_block (Analysis *analysis)
+{
+  gdouble block;
+  guint i;
+
+  analysis->sub_blocks[analysis->n_sub_blocks % SUB_BLOCKS_PER_BLOCK] =
+    analysis->sub_block_sum / SUB_BLOCK_FRAMES;
+  analysis->n_sub_blocks++;
+  analysis->sub_block_sum = 0.0;
+  analysis->sub_block_len = 0;
+
+  if (analysis->n_sub_blocks < SUB_BLOCKS_PER_BLOCK)
+    return;
+
+  block = 0.0;
+  for (i = 0; i < SUB_BLOCKS_PER_BLOCK; i++)
+    block += analysis->sub_blocks[i];
+  block /= SUB_BLOCKS_PER_BLOCK;
+  g_array_append_val (analysis->blocks, block);
+}
+
+static void
+analysis_process (Analysis     *analysis,
+		  const gfloat *samples,
+		  gsize         n_frames)
+{
+  gsize i;
+  guint c;
+
+  for (i = 0; i < n_frames; i++) {
+    gdouble sum = 0.0;
+
+    for (c = 0; c < analysis->channels; c++) {
+      gdouble *s = analysis->state[c];
+      gdouble x, y;
+
+      x = *samples++;
+      if (fabs (x) > analysis->peak)
+	analysis->peak = fabs (x);
+
+      /* Both stages as transposed direct form II biquads */
+      y = SHELF_B0 * x + s[0];
+      s[0] = SHELF_B1 * x - SHELF_A1 * y + s[1];
+      s[1] = SHELF_B2 * x - SHELF_A2 * y;
+
+      x = y;
+      y = x + s[2];
+      s[2] = -2.0 * x - HIGHPASS_A1 * y + s[3];
+      s[3] = x - HIGHPASS_A2 * y;
+
+      sum += analysis->weights[c] * y * y;
+    }
+
+    analysis->sub_block_sum += sum;
+    if (++analysis->sub_block_len == SUB_BLOCK_FRAMES)
+      analysis_end_sub_block (analysis);
+  }
+}
+
+static gboolean
+analysis_get_loudness (Analysis *analysis,
+		       gdouble  *loudness)
+{
+  gdouble absolute_gate, relative_gate, sum;
+  guint i, n;
+
+  absolute_gate = loudness_to_power (ABSOLUTE_GATE);
+
+  sum = 0.0;
+  n = 0;
+  for (i = 0; i < analysis->blocks->len; i++) {
+    gdouble block = g_array_index (analysis->blocks, gdouble, i);
+    if (block > absolute_gate) {
+      sum += block;
+      n++;
+    }
+  }
+  if (n == 0)
+    return FALSE;
+
+  relative_gate = loudness_to_power (power_to_loudness (sum / n) + RELATIVE_GATE);
+
+  sum = 0.0;
+  n = 0;
+  for (i = 0; i < analysis->blocks->len; i++) {
+    gdouble block = g_array_index (analysis->blocks, gdouble, i);
+    if (block > absolute_gate && block > relative_gate) {
+      sum += block;
+      n++;
+    }
+  }
+  if (n == 0)
+    return FALSE;
+
+  *loudness = power_to_loudness (sum / n);
+  return TRUE;
+}
+
+static void
+analysis_handoff_cb (GstElement *sink,
+		     GstBuffer  *buffer,
+		     GstPad     *pad,
+		     Analysis   *analysis)
+{
+  GstCaps *caps;
+  GstMapInfo map;
+
+  caps = gst_pad_get_current_caps (pad);
+  if (caps == NULL)
+    return;
+  if (analysis->caps == NULL || !gst_caps_is_equal (caps, analysis->caps))
+    analysis_configure (analysis, caps);
+  gst_caps_unref (caps);
+
+  if (analysis->channels == 0 ||
+      !gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return;
+  analysis_process (analysis, (const gfloat *) map.data,
+		    map.size / (sizeof (gfloat) * analysis->channels));
+  gst_buffer_unmap (buffer, &map);
+}
+
+/* Only decode the audio, the other streams are left unlinked */
+static gint
+analysis_autoplug_select_cb (GstElement        *decoder,
+			     GstPad            *pad,
+			     GstCaps           *caps,
+			     GstElementFactory *factory,
+			     gpointer           user_data)
+{
+  if (gst_element_factory_list_is_type (factory, GST_ELEMENT_FACTORY_TYPE_DECODER) &&
+      !gst_element_factory_list_is_type (factory, GST_ELEMENT_FACTORY_TYPE_DECODER |
+					 GST_ELEMENT_FACTORY_TYPE_MEDIA_AUDIO))
+    return AUTOPLUG_SELECT_EXPOSE;
+
+  return AUTOPLUG_SELECT_TRY;
+}
+
+static void
+analysis_pad_added_cb (GstElement *decoder,
+		       GstPad     *pad,
+		       GstElement *convert)
+{
+  GstCaps *caps;
+  GstPad *sinkpad;
+
+  caps = gst_pad_get_current_caps (pad);
+  if (caps == NULL)
+    caps = gst_pad_query_caps (pad, NULL);
+
+  sinkpad = gst_element_get_static_pad (convert, "sink");
+  if (gst_caps_get_size (caps) > 0 &&
+      gst_structure_has_name (gst_caps_get_structure (caps, 0), "audio/x-raw") &&
+      !gst_pad_is_linked (sinkpad))
+    gst_pad_link (pad, sinkpad);
+
+  gst_object_unref (sinkpad);
+  gst_caps_unref (caps);
+}
+
+static gboolean
+loudness_measure (GFile               *file,
+		  BaconVideoLoudness  *loudness,
+		  GCancellable        *cancellable,
+		  GError             **error)
+{
+  GstElement *pipeline, *decoder, *convert, *resample, *filter, *sink;
+  GstCaps *caps;
+  GstBus *bus;
+  Analysis analysis;
+  char *uri;
+  gboolean done = FALSE, ret = FALSE;
+
+  decoder = gst_element_factory_make ("uridecodebin", NULL);
+  convert = gst_element_factory_make ("audioconvert", NULL);
+  resample = gst_element_factory_make ("audioresample", NULL);
+  filter = gst_element_factory_make ("capsfilter", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+
+  pipeline = gst_pipeline_new ("loudness");
+  if (decoder == NULL || convert == NULL || resample == NULL || filter == NULL || sink == NULL) {
+    GstElement *elements[] = { decoder, convert, resample, filter, sink };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (elements); i++) {
+      if (elements[i] != NULL)
+	gst_object_unref (gst_object_ref_sink (elements[i]));
+    }
+    gst_object_unref (pipeline);
+
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			 _("Some necessary plug-ins are missing. "
+			   "Make sure that the program is correctly installed."));
+    return FALSE;
+  }
+
+  memset (&analysis, 0, sizeof (analysis));
+  analysis.blocks = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+  uri = g_file_get_uri (file);
+  g_object_set (decoder, "uri", uri, NULL);
+  g_free (uri);
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+			      "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
+			      "layout", G_TYPE_STRING, "interleaved",
+			      "rate", G_TYPE_INT, ANALYSIS_RATE,
+			      "channels", GST_TYPE_INT_RANGE, 1, ANALYSIS_MAX_CHANNELS,
+			      NULL);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  /* No clock, so that it goes as fast as decoding does */
+  g_object_set (sink,
+		"sync", FALSE,
+		"signal-handoffs", TRUE,
+		NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), decoder, convert, resample, filter, sink, NULL);
+  gst_element_link_many (convert, resample, filter, sink, NULL);
+
+  g_signal_connect (decoder, "autoplug-select",
+		    G_CALLBACK (analysis_autoplug_select_cb), NULL);
+  g_signal_connect (decoder, "pad-added",
+		    G_CALLBACK (analysis_pad_added_cb), convert);
+  g_signal_connect (sink, "handoff",
+		    G_CALLBACK (analysis_handoff_cb), &analysis);
+
+  bus = gst_element_get_bus (pipeline);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  while (!done) {
+    GstMessage *msg;
+
+    if (g_cancellable_set_error_if_cancelled (cancellable, error))
+      break;
+
+    msg = gst_bus_timed_pop_filtered (bus, 100 * GST_MSECOND,
+				      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (msg == NULL)
+      continue;
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+      gst_message_parse_error (msg, error, NULL);
+    } else if (analysis_get_loudness (&analysis, &loudness->loudness)) {
+      loudness->peak = analysis.peak;
+      ret = TRUE;
+    } else {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			   _("There is no sound to measure."));
+    }
+    gst_message_unref (msg);
+    done = TRUE;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  gst_caps_replace (&analysis.caps, NULL);
+  g_array_free (analysis.blocks, TRUE);
+
+  return ret;
+}
+
+/* Async API */
+
+static void
+lookup_thread (GSimpleAsyncResult *result,
+	       GObject            *object,
+	       GCancellable       *cancellable)
+{
+  BaconVideoLoudness *loudness;
+  char *fingerprint;
+  GError *error = NULL;
+
+  fingerprint = loudness_fingerprint (G_FILE (object), cancellable, &error);
+  if (fingerprint == NULL) {
+    g_simple_async_result_take_error (result, error);
+    return;
+  }
+
+  loudness = g_simple_async_result_get_op_res_gpointer (result);
+  if (!loudness_cache_lookup (fingerprint, loudness)) {
+    g_simple_async_result_set_error (result, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+				     _("The loudness of the file wasn't measured yet."));
+  }
+
+  g_free (fingerprint);
+}
+
+/**
+ * bacon_video_loudness_lookup_async:
+ * @file: a media file
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: the function to call when the lookup is done
+ * @user_data: data to pass to @callback
+ *
+ * Looks up the loudness of @file in the cache, which only reads the
+ * little of @file its fingerprint needs. The lookup fails with
+ * %G_IO_ERROR_NOT_FOUND if @file wasn't measured yet, see
+ * bacon_video_loudness_analyze_async().
+ **/
+void
+bacon_video_loudness_lookup_async (GFile               *file,
+				   GCancellable        *cancellable,
+				   GAsyncReadyCallback  callback,
+				   gpointer             user_data)
+{
+  GSimpleAsyncResult *result;
+
+  g_return_if_fail (G_IS_FILE (file));
+
+  result = g_simple_async_result_new (G_OBJECT (file), callback, user_data,
+				      bacon_video_loudness_lookup_async);
+  g_simple_async_result_set_op_res_gpointer (result, g_new0 (BaconVideoLoudness, 1), g_free);
+  g_simple_async_result_run_in_thread (result, lookup_thread, G_PRIORITY_DEFAULT, cancellable);
+  g_object_unref (result);
+}
+
+/**
+ * bacon_video_loudness_lookup_finish:
+ * @result: a #GAsyncResult
+ * @loudness: (out): return location for the loudness
+ * @error: a #GError, or %NULL
+ *
+ * Finishes a lookup started with bacon_video_loudness_lookup_async().
+ *
+ * Return value: %TRUE if @loudness was set, %FALSE on error
+ **/
+gboolean
+bacon_video_loudness_lookup_finish (GAsyncResult        *result,
+				    BaconVideoLoudness  *loudness,
+				    GError             **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  g_return_val_if_fail (g_simple_async_result_get_source_tag (simple) == bacon_video_loudness_lookup_async, FALSE);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  *loudness = *(BaconVideoLoudness *) g_simple_async_result_get_op_res_gpointer (simple);
+  return TRUE;
+}
+
+static void
+analyze_thread (GSimpleAsyncResult *result,
+		GObject            *object,
+		GCancellable       *cancellable)
+{
+  BaconVideoLoudness *loudness;
+  char *fingerprint;
+  GError *error = NULL;
+
+  fingerprint = loudness_fingerprint (G_FILE (object), cancellable, &error);
+  if (fingerprint == NULL) {
+    g_simple_async_result_take_error (result, error);
+    return;
+  }
+
+  loudness = g_simple_async_result_get_op_res_gpointer (result);
+  if (!loudness_measure (G_FILE (object), loudness, cancellable, &error))
+    g_simple_async_result_take_error (result, error);
+  else
+    loudness_cache_store (fingerprint, loudness);
+
+  g_free (fingerprint);
+}
+
+/**
+ * bacon_video_loudness_analyze_async:
+ * @file: a media file
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: the function to call when the file has been measured
+ * @user_data: data to pass to @callback
+ *
+ * Measures the loudness of the audio of @file in a thread, and saves it
+ * in the cache. This decodes all of the audio, so it takes a while.
+ **/
+void
+bacon_video_loudness_analyze_async (GFile               *file,
+				    GCancellable        *cancellable,
+				    GAsyncReadyCallback  callback,
+				    gpointer             user_data)
+{
+  GSimpleAsyncResult *result;
+
+  g_return_if_fail (G_IS_FILE (file));
+
+  result = g_simple_async_result_new (G_OBJECT (file), callback, user_data,
+				      bacon_video_loudness_analyze_async);
+  g_simple_async_result_set_op_res_gpointer (result, g_new0 (BaconVideoLoudness, 1), g_free);
+  g_simple_async_result_run_in_thread (result, analyze_thread, G_PRIORITY_LOW, cancellable);
+  g_object_unref (result);
+}
+
+/**
+ * bacon_video_loudness_analyze_finish:
+ * @result: a #GAsyncResult
+ * @loudness: (out): return location for the loudness
+ * @error: a #GError, or %NULL
+ *
+ * Finishes measuring a file started with bacon_video_loudness_analyze_async().
+ *
+ * Return value: %TRUE if @loudness was set, %FALSE on error
+ **/
+gboolean
+bacon_video_loudness_analyze_finish (GAsyncResult        *result,
+				     BaconVideoLoudness  *loudness,
+				     GError             **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  g_return_val_if_fail (g_simple_async_result_get_source_tag (simple) == bacon_video_loudness_analyze_async, FALSE);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  *loudness = *(BaconVideoLoudness *) g_simple_async_result_get_op_res_gpointer (simple);
+  return TRUE;
+}
+
+/**
+ * bacon_video_loudness_get_gain:
+ * @loudness: a #BaconVideoLoudness
+ *
+ * Returns the gain that brings @loudness to %BACON_VIDEO_LOUDNESS_TARGET,
+ * lowered if needed so that the peak doesn't clip.
+ *
+ * Return value: the gain, as a linear factor
+ **/
+gdouble
+bacon_video_loudness_get_gain (const BaconVideoLoudness *loudness)
+{
+  gdouble gain;
+
+  g_return_val_if_fail (loudness != NULL, 1.0);
+
+  gain = pow (10.0, (BACON_VIDEO_LOUDNESS_TARGET - loudness->loudness) / 20.0);
+  if (loudness->peak > 0.0 && gain * loudness->peak > 1.0)
+    gain = 1.0 / loudness->peak;
+
+  return MIN (gain, MAX_GAIN);
+}
@@ -0,0 +1,61 @@
+/*
+ * Loudness measurement and cache for loudness normalisation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#ifndef BACON_VIDEO_LOUDNESS_H
+#define BACON_VIDEO_LOUDNESS_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The loudness everything is brought to, in LUFS, which is also
+ * the reference of ReplayGain 2.0 */
+#define BACON_VIDEO_LOUDNESS_TARGET (-18.0)
+
+/**
+ * BaconVideoLoudness:
+ * @loudness: the integrated loudness, in LUFS
+ * @peak: the sample peak, 1.0 being full scale, or 0 if unknown
+ *
+ * The loudness of a file, as measured by EBU R128.
+ **/
+typedef struct {
+  gdouble loudness;
+  gdouble peak;
+} BaconVideoLoudness;
+
+void     bacon_video_loudness_lookup_async   (GFile               *file,
+					      GCancellable        *cancellable,
+					      GAsyncReadyCallback  callback,
+					      gpointer             user_data);
+gboolean bacon_video_loudness_lookup_finish  (GAsyncResult        *result,
+					      BaconVideoLoudness  *loudness,
+					      GError             **error);
+void     bacon_video_loudness_analyze_async  (GFile               *file,
+					      GCancellable        *cancellable,
+					      GAsyncReadyCallback  callback,
+					      gpointer             user_data);
+gboolean bacon_video_loudness_analyze_finish (GAsyncResult        *result,
+					      BaconVideoLoudness  *loudness,
+					      GError             **error);
+
+gdouble  bacon_video_loudness_get_gain       (const BaconVideoLoudness *loudness);
+
+G_END_DECLS
+
+#endif /* BACON_VIDEO_LOUDNESS_H */
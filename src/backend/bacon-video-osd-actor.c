@@ -47,8 +47,12 @@ struct BaconVideoOsdActorPrivate
 	char              *message;
 	GtkStyleContext   *style;
 	GsdOsdDrawContext *ctx;
+	GHashTable        *icons;
+	gulong             theme_changed_id;
+	guint              redraw_id;
 
         guint              hide_timeout_id;
+        gint64             hide_time; /* monotonic, in usecs */
         guint              fade_timeout_id;
         double             fade_out_alpha;
 };
@@ -73,6 +77,17 @@ fade_timeout (BaconVideoOsdActor *osd)
 static gboolean
 hide_timeout (BaconVideoOsdActor *osd)
 {
+	gint64 remaining;
+
+	/* Shown again since, wait for the rest */
+	remaining = osd->priv->hide_time - g_get_monotonic_time ();
+	if (remaining > 1000) {
+		osd->priv->hide_timeout_id = g_timeout_add (remaining / 1000,
+							    (GSourceFunc) hide_timeout,
+							    osd);
+		return FALSE;
+	}
+
 	osd->priv->hide_timeout_id = 0;
 	osd->priv->fade_timeout_id = g_timeout_add (FADE_FRAME_TIMEOUT,
 						    (GSourceFunc) fade_timeout,
@@ -99,6 +114,7 @@ remove_hide_timeout (BaconVideoOsdActor *osd)
 static void
 add_hide_timeout (BaconVideoOsdActor *osd)
 {
+        osd->priv->hide_time = g_get_monotonic_time () + DIALOG_FADE_TIMEOUT * 1000;
         osd->priv->hide_timeout_id = g_timeout_add (DIALOG_FADE_TIMEOUT,
                                                     (GSourceFunc) hide_timeout,
                                                     osd);
@@ -110,6 +126,16 @@ bacon_video_osd_actor_finalize (GObject *object)
 	BaconVideoOsdActor *osd;
 
 	osd = BACON_VIDEO_OSD_ACTOR (object);
+	remove_hide_timeout (osd);
+	if (osd->priv->redraw_id != 0) {
+		g_source_remove (osd->priv->redraw_id);
+		osd->priv->redraw_id = 0;
+	}
+	if (osd->priv->theme_changed_id != 0) {
+		g_signal_handler_disconnect (osd->priv->ctx->theme, osd->priv->theme_changed_id);
+		osd->priv->theme_changed_id = 0;
+	}
+	g_clear_pointer (&osd->priv->icons, g_hash_table_unref);
 	if (osd->priv->ctx) {
 		g_free (osd->priv->ctx);
 		osd->priv->ctx = NULL;
@@ -167,6 +193,32 @@ bacon_video_osd_actor_draw (ClutterCanvas      *canvas,
 	return FALSE;
 }
 
+static void
+icon_free (gpointer pixbuf)
+{
+	if (pixbuf != NULL)
+		g_object_unref (pixbuf);
+}
+
+/* The icons are rendered with the style's colours, so this is called
+ * for changes to either the icon theme or the style */
+static void
+icons_changed_cb (GObject            *object,
+		  BaconVideoOsdActor *osd)
+{
+	g_hash_table_remove_all (osd->priv->icons);
+	clutter_content_invalidate (CLUTTER_CONTENT (osd->priv->canvas));
+}
+
+static gboolean
+redraw_idle (BaconVideoOsdActor *osd)
+{
+	osd->priv->redraw_id = 0;
+	clutter_content_invalidate (CLUTTER_CONTENT (osd->priv->canvas));
+
+	return FALSE;
+}
+
 static void
 bacon_video_osd_actor_init (BaconVideoOsdActor *osd)
 {
@@ -201,6 +253,15 @@ bacon_video_osd_actor_init (BaconVideoOsdActor *osd)
 	osd->priv->ctx->theme = gtk_icon_theme_get_default ();
 	osd->priv->ctx->style = osd->priv->style;
 
+	/* The icons, rendered once for the theme, the OSD always
+	 * using the same size */
+	osd->priv->icons = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, icon_free);
+	osd->priv->ctx->icons = osd->priv->icons;
+	osd->priv->theme_changed_id = g_signal_connect (osd->priv->ctx->theme, "changed",
+							G_CALLBACK (icons_changed_cb), osd);
+	g_signal_connect (osd->priv->style, "changed",
+			  G_CALLBACK (icons_changed_cb), osd);
+
 	g_signal_connect (osd->priv->canvas, "draw", G_CALLBACK (bacon_video_osd_actor_draw), osd);
         osd->priv->fade_out_alpha = 1.0;
 }
@@ -218,14 +279,23 @@ bacon_video_osd_actor_set_content (BaconVideoOsdActor *osd,
 {
 	g_return_if_fail (BACON_IS_VIDEO_OSD_ACTOR (osd));
 
+	/* Only redraw when something changed */
+	if (g_strcmp0 (icon_name, osd->priv->icon_name) == 0 &&
+	    g_strcmp0 (message, osd->priv->message) == 0)
+		return;
+
 	g_free (osd->priv->icon_name);
 	osd->priv->icon_name = g_strdup (icon_name);
 
 	g_free (osd->priv->message);
 	osd->priv->message = g_strdup (message);
 
-	if (icon_name != NULL || message != NULL)
-		clutter_content_invalidate (CLUTTER_CONTENT (osd->priv->canvas));
+	/* Drawn just before the next frame, so that key repeats coming
+	 * faster than frames only get the last of them drawn */
+	if ((icon_name != NULL || message != NULL) && osd->priv->redraw_id == 0)
+		osd->priv->redraw_id = g_idle_add_full (CLUTTER_PRIORITY_REDRAW - 1,
+							(GSourceFunc) redraw_idle,
+							osd, NULL);
 }
 
 void
@@ -255,6 +325,14 @@ bacon_video_osd_actor_show_and_fade (BaconVideoOsdActor *osd)
 {
 	g_return_if_fail (BACON_IS_VIDEO_OSD_ACTOR (osd));
 
+	/* Still fully shown, as when a key is held down, so only push
+	 * the fading back rather than restarting everything */
+	if (osd->priv->hide_timeout_id != 0 &&
+	    CLUTTER_ACTOR_IS_VISIBLE (CLUTTER_ACTOR (osd))) {
+		osd->priv->hide_time = g_get_monotonic_time () + DIALOG_FADE_TIMEOUT * 1000;
+		return;
+	}
+
 	remove_hide_timeout (osd);
 	clutter_actor_set_opacity (CLUTTER_ACTOR (osd), 0xff);
 	clutter_actor_show (CLUTTER_ACTOR (osd));
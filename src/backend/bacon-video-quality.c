@@ -0,0 +1,117 @@
+/*
+ * Adaptive video quality controller
+ *
+ * Decides, from the frame counters of the video sink, when to lower the
+ * quality of the video processing because frames keep being dropped, and
+ * when to raise it again once the machine keeps up.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "bacon-video-quality.h"
+
+/* Step down after this many consecutive intervals with more than
+ * QUALITY_DROP_RATIO of the frames dropped, and back up after
+ * QUALITY_STEP_UP_INTERVALS intervals without any dropped frames */
+#define QUALITY_DROP_RATIO 0.05
+#define QUALITY_STEP_DOWN_INTERVALS 3
+#define QUALITY_STEP_UP_INTERVALS 10
+
+/**
+ * bacon_video_quality_reset:
+ * @quality: a #BaconVideoQuality
+ * @rendered: the current count of rendered frames
+ * @dropped: the current count of dropped frames
+ *
+ * Starts counting intervals again from the given frame counters.
+ **/
+void
+bacon_video_quality_reset (BaconVideoQuality *quality,
+			   guint64            rendered,
+			   guint64            dropped)
+{
+  g_return_if_fail (quality != NULL);
+
+  quality->last_rendered = rendered;
+  quality->last_dropped = dropped;
+  quality->overload_intervals = 0;
+  quality->headroom_intervals = 0;
+}
+
+/**
+ * bacon_video_quality_update:
+ * @quality: a #BaconVideoQuality
+ * @rendered: the current count of rendered frames
+ * @dropped: the current count of dropped frames
+ * @level: the current quality level, 0 being full quality
+ * @lowest_level: the highest level, with the lowest quality
+ *
+ * Ends an interval, with the frame counters of the video sink at its end.
+ *
+ * Return value: the quality level to use from now on
+ **/
+guint
+bacon_video_quality_update (BaconVideoQuality *quality,
+			    guint64            rendered,
+			    guint64            dropped,
+			    guint              level,
+			    guint              lowest_level)
+{
+  guint64 new_rendered, new_dropped;
+
+  g_return_val_if_fail (quality != NULL, level);
+
+  /* The sink's counters start again from 0 on flushes, which
+   * seeking does, so skip the interval rather than underflow */
+  if (rendered < quality->last_rendered || dropped < quality->last_dropped) {
+    quality->last_rendered = rendered;
+    quality->last_dropped = dropped;
+    return level;
+  }
+
+  new_rendered = rendered - quality->last_rendered;
+  new_dropped = dropped - quality->last_dropped;
+  quality->last_rendered = rendered;
+  quality->last_dropped = dropped;
+
+  /* Paused, or stalled, which says nothing either way */
+  if (new_rendered + new_dropped == 0)
+    return level;
+
+  if ((gdouble) new_dropped / (new_rendered + new_dropped) > QUALITY_DROP_RATIO) {
+    quality->headroom_intervals = 0;
+    if (++quality->overload_intervals >= QUALITY_STEP_DOWN_INTERVALS &&
+	level < lowest_level) {
+      quality->overload_intervals = 0;
+      return level + 1;
+    }
+  } else if (new_dropped == 0) {
+    quality->overload_intervals = 0;
+    if (++quality->headroom_intervals >= QUALITY_STEP_UP_INTERVALS &&
+	level > 0) {
+      quality->headroom_intervals = 0;
+      return level - 1;
+    }
+  } else {
+    quality->overload_intervals = 0;
+    quality->headroom_intervals = 0;
+  }
+
+  return level;
+}
@@ -0,0 +1,44 @@
+/*
+ * Adaptive video quality controller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#ifndef BACON_VIDEO_QUALITY_H
+#define BACON_VIDEO_QUALITY_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+  guint64 last_rendered;
+  guint64 last_dropped;
+  guint   overload_intervals;
+  guint   headroom_intervals;
+} BaconVideoQuality;
+
+void  bacon_video_quality_reset  (BaconVideoQuality *quality,
+				  guint64            rendered,
+				  guint64            dropped);
+guint bacon_video_quality_update (BaconVideoQuality *quality,
+				  guint64            rendered,
+				  guint64            dropped,
+				  guint              level,
+				  guint              lowest_level);
+
+G_END_DECLS
+
+#endif /* BACON_VIDEO_QUALITY_H */
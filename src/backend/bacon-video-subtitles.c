@@ -0,0 +1,922 @@
+/*
+ * Cue store for external text subtitles
+ *
+ * Parses SubRip, WebVTT, SubStation Alpha and MicroDVD files into a table
+ * of cues sorted by start time, so that BaconVideoWidget can render them
+ * itself instead of restarting the pipeline to plug a subtitle parser.
+ *
+ * The table doubles as an implicit balanced search tree, each cue being
+ * the root of the sub-table around it, augmented with the latest end time
+ * in each subtree, so that the cues showing at any time, overlapping or
+ * not, are found in logarithmic time.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n-lib.h>
+
+#include "bacon-video-subtitles.h"
+#include "bacon-video-charset.h"
+
+/* Same default as GStreamer's subparse */
+#define DEFAULT_SUBTITLE_ENCODING "ISO-8859-15"
+#define DEFAULT_SUBTITLE_FPS (24000.0 / 1001.0)
+
+typedef enum {
+  MARKUP_HTML,
+  MARKUP_SSA,
+  MARKUP_MICRODVD
+} MarkupType;
+
+struct BaconVideoSubtitles
+{
+  volatile gint  ref_count;
+  GArray        *cues; /* BaconVideoSubtitleCue, sorted by start time */
+  gint64        *max_end; /* latest end in the subtree rooted at each cue */
+  char         **folded; /* case-folded texts, for searching */
+};
+
+static BaconVideoSubtitles *
+bacon_video_subtitles_new (void)
+{
+  BaconVideoSubtitles *subs;
+
+  subs = g_slice_new0 (BaconVideoSubtitles);
+  subs->ref_count = 1;
+  subs->cues = g_array_new (FALSE, FALSE, sizeof (BaconVideoSubtitleCue));
+
+  return subs;
+}
+
+/**
+ * bacon_video_subtitles_ref:
+ * @subs: a #BaconVideoSubtitles
+ *
+ * Increases the reference count of @subs.
+ *
+ * Return value: @subs
+ **/
+BaconVideoSubtitles *
+bacon_video_subtitles_ref (BaconVideoSubtitles *subs)
+{
+  g_return_val_if_fail (subs != NULL, NULL);
+
+  g_atomic_int_inc (&subs->ref_count);
+  return subs;
+}
+
+/**
+ * bacon_video_subtitles_unref:
+ * @subs: a #BaconVideoSubtitles
+ *
+ * Decreases the reference count of @subs, freeing it when it drops to zero.
+ **/
+void
+bacon_video_subtitles_unref (BaconVideoSubtitles *subs)
+{
+  guint i;
+
+  g_return_if_fail (subs != NULL);
+
+  if (!g_atomic_int_dec_and_test (&subs->ref_count))
+    return;
+
+  for (i = 0; i < subs->cues->len; i++)
+    g_free (g_array_index (subs->cues, BaconVideoSubtitleCue, i).text);
+  g_array_free (subs->cues, TRUE);
+  g_free (subs->max_end);
+  g_strfreev (subs->folded);
+  g_slice_free (BaconVideoSubtitles, subs);
+}
+
+/* Removes the styling from a cue's text, as we render it as plain text */
+static char *
+strip_markup (const char *text, MarkupType type)
+{
+  GString *str;
+  const char *p;
+
+  str = g_string_sized_new (strlen (text));
+
+  for (p = text; *p != '\0'; p++) {
+    if (*p == '<' && type == MARKUP_HTML) {
+      const char *close = strchr (p, '>');
+      if (close != NULL) {
+	p = close;
+	continue;
+      }
+    } else if (*p == '{') {
+      /* SSA override blocks also turn up in a lot of SubRip files */
+      const char *close = strchr (p, '}');
+      if (close != NULL && (type != MARKUP_HTML || p[1] == '\\')) {
+	p = close;
+	continue;
+      }
+    } else if (*p == '\\' && type == MARKUP_SSA) {
+      if (p[1] == 'N' || p[1] == 'n') {
+	g_string_append_c (str, '\n');
+	p++;
+	continue;
+      } else if (p[1] == 'h') {
+	g_string_append_c (str, ' ');
+	p++;
+	continue;
+      }
+    } else if (*p == '|' && type == MARKUP_MICRODVD) {
+      g_string_append_c (str, '\n');
+      continue;
+    } else if (*p == '&' && type == MARKUP_HTML) {
+      if (g_str_has_prefix (p, "&amp;")) {
+	g_string_append_c (str, '&');
+	p += 4;
+	continue;
+      } else if (g_str_has_prefix (p, "&lt;")) {
+	g_string_append_c (str, '<');
+	p += 3;
+	continue;
+      } else if (g_str_has_prefix (p, "&gt;")) {
+	g_string_append_c (str, '>');
+	p += 3;
+	continue;
+      } else if (g_str_has_prefix (p, "&nbsp;")) {
+	g_string_append_c (str, ' ');
+	p += 5;
+	continue;
+      }
+    }
+
+    g_string_append_c (str, *p);
+  }
+
+  return g_strstrip (g_string_free (str, FALSE));
+}
+
+static void
+add_cue (BaconVideoSubtitles *subs,
+	 gint64               start,
+	 gint64               end,
+	 const char          *text,
+	 MarkupType           type)
+{
+  BaconVideoSubtitleCue cue;
+
+  if (start < 0 || end <= start)
+    return;
+
+  cue.text = strip_markup (text, type);
+  if (*cue.text == '\0') {
+    g_free (cue.text);
+    return;
+  }
+
+  cue.start = start;
+  cue.end = end;
+  g_array_append_val (subs->cues, cue);
+}
+
+/* Parses "[hh:]mm:ss[.,fraction]", as used by SubRip, WebVTT
+ * and, with centiseconds, SubStation Alpha */
+static gboolean
+parse_clock_time (const char *str,
+		  gint64     *msecs)
+{
+  guint64 fields[3];
+  guint n_fields = 0;
+  gint64 secs, frac = 0;
+  char *end;
+
+  while (g_ascii_isspace (*str))
+    str++;
+
+  while (n_fields < G_N_ELEMENTS (fields)) {
+    if (!g_ascii_isdigit (*str))
+      return FALSE;
+    fields[n_fields++] = g_ascii_strtoull (str, &end, 10);
+    str = end;
+    if (*str != ':')
+      break;
+    str++;
+  }
+
+  if (n_fields < 2)
+    return FALSE;
+
+  if (*str == ',' || *str == '.') {
+    guint digits;
+
+    for (str++, digits = 0; g_ascii_isdigit (*str); str++) {
+      if (digits < 3) {
+	frac = frac * 10 + (*str - '0');
+	digits++;
+      }
+    }
+    for (; digits < 3; digits++)
+      frac *= 10;
+  }
+
+  if (n_fields == 3)
+    secs = fields[0] * 3600 + fields[1] * 60 + fields[2];
+  else
+    secs = fields[0] * 60 + fields[1];
+
+  *msecs = secs * 1000 + frac;
+  return TRUE;
+}
+
+static gboolean
+is_blank (const char *line)
+{
+  for (; *line != '\0'; line++) {
+    if (!g_ascii_isspace (*line))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* SubRip and WebVTT: blocks of text lines following a
+ * "start --> end" line, separated by blank lines */
+static void
+parse_srt (BaconVideoSubtitles *subs,
+	   char               **lines)
+{
+  guint i = 0;
+
+  while (lines[i] != NULL) {
+    const char *arrow;
+    gint64 start, end;
+    GString *text;
+
+    arrow = strstr (lines[i], "-->");
+    if (arrow == NULL ||
+	!parse_clock_time (lines[i], &start) ||
+	!parse_clock_time (arrow + 3, &end)) {
+      i++;
+      continue;
+    }
+
+    text = g_string_new (NULL);
+    for (i++; lines[i] != NULL && !is_blank (lines[i]); i++) {
+      if (text->len > 0)
+	g_string_append_c (text, '\n');
+      g_string_append (text, lines[i]);
+    }
+
+    add_cue (subs, start, end, text->str, MARKUP_HTML);
+    g_string_free (text, TRUE);
+  }
+}
+
+/* SubStation Alpha and Advanced SubStation Alpha: "Dialogue:" lines
+ * in the [Events] section, laid out as its "Format:" line says */
+static void
+parse_ssa (BaconVideoSubtitles *subs,
+	   char               **lines)
+{
+  gboolean in_events = FALSE;
+  guint start_field = 1, end_field = 2, n_fields = 10;
+  guint i;
+
+  for (i = 0; lines[i] != NULL; i++) {
+    const char *line = lines[i];
+    char **fields;
+    gint64 start, end;
+
+    while (g_ascii_isspace (*line))
+      line++;
+
+    if (*line == '[') {
+      in_events = (g_ascii_strncasecmp (line, "[Events]", 8) == 0);
+      continue;
+    }
+    if (!in_events)
+      continue;
+
+    if (g_str_has_prefix (line, "Format:")) {
+      guint j;
+
+      fields = g_strsplit (line + strlen ("Format:"), ",", -1);
+      n_fields = g_strv_length (fields);
+      for (j = 0; j < n_fields; j++) {
+	g_strstrip (fields[j]);
+	if (g_ascii_strcasecmp (fields[j], "Start") == 0)
+	  start_field = j;
+	else if (g_ascii_strcasecmp (fields[j], "End") == 0)
+	  end_field = j;
+      }
+      g_strfreev (fields);
+      continue;
+    }
+
+    if (!g_str_has_prefix (line, "Dialogue:") ||
+	n_fields <= MAX (start_field, end_field) + 1)
+      continue;
+
+    /* The text is always the last field, and may contain commas */
+    fields = g_strsplit (line + strlen ("Dialogue:"), ",", n_fields);
+    if (g_strv_length (fields) == n_fields &&
+	parse_clock_time (fields[start_field], &start) &&
+	parse_clock_time (fields[end_field], &end))
+      add_cue (subs, start, end, fields[n_fields - 1], MARKUP_SSA);
+    g_strfreev (fields);
+  }
+}
+
+static gboolean
+parse_frame_number (const char **str,
+		    guint64     *frame)
+{
+  char *end;
+
+  if (**str != '{' || !g_ascii_isdigit ((*str)[1]))
+    return FALSE;
+
+  *frame = g_ascii_strtoull (*str + 1, &end, 10);
+  if (*end != '}')
+    return FALSE;
+
+  *str = end + 1;
+  return TRUE;
+}
+
+/* MicroDVD: "{start frame}{end frame}text", where a first line
+ * with both frames set to 1 may give the frame rate */
+static void
+parse_microdvd (BaconVideoSubtitles *subs,
+		char               **lines,
+		gdouble              fps)
+{
+  guint i;
+
+  if (fps <= 0.0)
+    fps = DEFAULT_SUBTITLE_FPS;
+
+  for (i = 0; lines[i] != NULL; i++) {
+    const char *text = lines[i];
+    guint64 start, end;
+
+    if (!parse_frame_number (&text, &start) ||
+	!parse_frame_number (&text, &end))
+      continue;
+
+    if (start == end && start <= 1) {
+      gdouble file_fps = g_ascii_strtod (text, NULL);
+      if (file_fps > 0.0)
+	fps = file_fps;
+      continue;
+    }
+
+    add_cue (subs, start * 1000 / fps, end * 1000 / fps, text, MARKUP_MICRODVD);
+  }
+}
+
+static char *
+subtitles_to_utf8 (const char  *data,
+		   gsize        len,
+		   const char  *charset,
+		   const char  *fallback,
+		   GError     **error)
+{
+  char *text;
+
+  if (charset != NULL && g_ascii_strcasecmp (charset, "UTF-8") == 0 &&
+      g_utf8_validate (data, len, NULL)) {
+    text = g_strndup (data, len);
+  } else {
+    /* Neither detected nor valid, so trust the user's choice, unless
+     * that's the UTF-8 that just failed */
+    if (charset == NULL || g_ascii_strcasecmp (charset, "UTF-8") == 0)
+      charset = fallback;
+    if (charset == NULL || *charset == '\0' || g_ascii_strcasecmp (charset, "UTF-8") == 0)
+      charset = DEFAULT_SUBTITLE_ENCODING;
+
+    text = g_convert_with_fallback (data, len, "UTF-8", charset, "?", NULL, NULL, error);
+    if (text == NULL)
+      return NULL;
+  }
+
+  /* Byte order mark */
+  if (g_str_has_prefix (text, "\xef\xbb\xbf"))
+    memmove (text, text + 3, strlen (text + 3) + 1);
+
+  return text;
+}
+
+static int
+compare_cues (gconstpointer a,
+	      gconstpointer b)
+{
+  const BaconVideoSubtitleCue *cue_a = a;
+  const BaconVideoSubtitleCue *cue_b = b;
+
+  if (cue_a->start != cue_b->start)
+    return cue_a->start < cue_b->start ? -1 : 1;
+  if (cue_a->end != cue_b->end)
+    return cue_a->end < cue_b->end ? -1 : 1;
+  return 0;
+}
+
+/* The root of the subtree covering [lo, hi) is the cue in the middle */
+static gint64
+build_index (BaconVideoSubtitles *subs,
+	     guint                lo,
+	     guint                hi)
+{
+  guint mid;
+  gint64 max_end;
+
+  if (lo >= hi)
+    return G_MININT64;
+
+  mid = lo + (hi - lo) / 2;
+  max_end = g_array_index (subs->cues, BaconVideoSubtitleCue, mid).end;
+  max_end = MAX (max_end, build_index (subs, lo, mid));
+  max_end = MAX (max_end, build_index (subs, mid + 1, hi));
+  subs->max_end[mid] = max_end;
+
+  return max_end;
+}
+
+/* Appends the indices of the cues showing at @time, in start time order */
+static void
+query_index (BaconVideoSubtitles *subs,
+	     guint                lo,
+	     guint                hi,
+	     gint64               time,
+	     GArray              *indices)
+{
+  const BaconVideoSubtitleCue *cues = (const BaconVideoSubtitleCue *) subs->cues->data;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    /* Nothing in this subtree lasts until @time */
+    if (subs->max_end[mid] <= time)
+      return;
+
+    query_index (subs, lo, mid, time, indices);
+
+    /* Nor does anything to the right start before it */
+    if (cues[mid].start > time)
+      return;
+
+    if (cues[mid].end > time)
+      g_array_append_val (indices, mid);
+
+    lo = mid + 1;
+  }
+}
+
+/* The first cue starting after @time */
+static guint
+upper_bound (BaconVideoSubtitles *subs,
+	     gint64               time)
+{
+  const BaconVideoSubtitleCue *cues = (const BaconVideoSubtitleCue *) subs->cues->data;
+  guint lo = 0, hi = subs->cues->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    if (cues[mid].start <= time)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static BaconVideoSubtitles *
+subtitles_parse (const char  *data,
+		 gsize        len,
+		 const char  *charset,
+		 const char  *fallback,
+		 gdouble      fps,
+		 GError     **error)
+{
+  BaconVideoSubtitles *subs;
+  char *text, *first, **lines;
+  const char *src;
+  char *dest;
+  guint i;
+
+  text = subtitles_to_utf8 (data, len, charset, fallback, error);
+  if (text == NULL)
+    return NULL;
+
+  /* DOS line endings */
+  for (src = dest = text; *src != '\0'; src++) {
+    if (*src != '\r')
+      *dest++ = *src;
+  }
+  *dest = '\0';
+
+  for (first = text; g_ascii_isspace (*first); first++)
+    ;
+
+  lines = g_strsplit (first, "\n", -1);
+  subs = bacon_video_subtitles_new ();
+
+  if (g_str_has_prefix (first, "WEBVTT"))
+    parse_srt (subs, lines);
+  else if (strstr (first, "[Script Info]") != NULL || strstr (first, "[Events]") != NULL)
+    parse_ssa (subs, lines);
+  else if (first[0] == '{' && g_ascii_isdigit (first[1]))
+    parse_microdvd (subs, lines, fps);
+  else if (strstr (first, "-->") != NULL)
+    parse_srt (subs, lines);
+
+  g_strfreev (lines);
+  g_free (text);
+
+  if (subs->cues->len == 0) {
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			 _("The subtitle file format is not supported."));
+    bacon_video_subtitles_unref (subs);
+    return NULL;
+  }
+
+  g_array_sort (subs->cues, compare_cues);
+
+  subs->max_end = g_new (gint64, subs->cues->len);
+  build_index (subs, 0, subs->cues->len);
+
+  subs->folded = g_new (char *, subs->cues->len + 1);
+  for (i = 0; i < subs->cues->len; i++)
+    subs->folded[i] = g_utf8_casefold (g_array_index (subs->cues, BaconVideoSubtitleCue, i).text, -1);
+  subs->folded[i] = NULL;
+
+  return subs;
+}
+
+/**
+ * bacon_video_subtitles_new_from_data:
+ * @data: the contents of a subtitle file
+ * @len: the length of @data, in bytes
+ * @encoding: (allow-none): the character set to use when the detection of
+ * the one of @data is unsure
+ * @fps: the frame rate of the video, for frame-based formats, or 0
+ * @error: a #GError, or %NULL
+ *
+ * Parses a SubRip, WebVTT, SubStation Alpha or MicroDVD subtitle file,
+ * in whichever character set bacon_video_charset_detect() finds.
+ *
+ * Return value: a new #BaconVideoSubtitles, or %NULL if the format isn't
+ * recognised or the file doesn't contain any cues
+ **/
+BaconVideoSubtitles *
+bacon_video_subtitles_new_from_data (const char  *data,
+				     gsize        len,
+				     const char  *encoding,
+				     gdouble      fps,
+				     GError     **error)
+{
+  const char *charset;
+
+  g_return_val_if_fail (data != NULL, NULL);
+
+  charset = bacon_video_charset_detect (data, len, encoding);
+  return subtitles_parse (data, len, charset, encoding, fps, error);
+}
+
+typedef struct {
+  char                *encoding;
+  gdouble              fps;
+  BaconVideoSubtitles *subs;
+} LoadData;
+
+static void
+load_data_free (LoadData *data)
+{
+  g_free (data->encoding);
+  if (data->subs != NULL)
+    bacon_video_subtitles_unref (data->subs);
+  g_slice_free (LoadData, data);
+}
+
+/* Detected character sets, keyed by URI, etag and preferred encoding,
+ * so that reloading an unchanged file doesn't scan it again */
+static GHashTable *charset_cache = NULL;
+G_LOCK_DEFINE_STATIC (charset_cache);
+
+static const char *
+load_detect_charset (GFile      *file,
+		     const char *etag,
+		     const char *contents,
+		     gsize       len,
+		     const char *encoding)
+{
+  const char *charset;
+  char *uri, *key;
+
+  if (etag == NULL)
+    return bacon_video_charset_detect (contents, len, encoding);
+
+  uri = g_file_get_uri (file);
+  key = g_strdup_printf ("%s %s %s", uri, etag, encoding ? encoding : "");
+  g_free (uri);
+
+  G_LOCK (charset_cache);
+  if (charset_cache == NULL)
+    charset_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  charset = g_hash_table_lookup (charset_cache, key);
+  G_UNLOCK (charset_cache);
+
+  if (charset != NULL) {
+    g_free (key);
+    return charset;
+  }
+
+  /* Results are static or interned, so the cache doesn't own them */
+  charset = bacon_video_charset_detect (contents, len, encoding);
+  if (charset == NULL) {
+    g_free (key);
+    return NULL;
+  }
+
+  G_LOCK (charset_cache);
+  g_hash_table_replace (charset_cache, key, (gpointer) charset);
+  G_UNLOCK (charset_cache);
+
+  return charset;
+}
+
+static void
+load_thread (GSimpleAsyncResult *result,
+	     GObject            *object,
+	     GCancellable       *cancellable)
+{
+  LoadData *data;
+  char *contents, *etag;
+  const char *charset;
+  gsize len;
+  GError *error = NULL;
+
+  data = g_simple_async_result_get_op_res_gpointer (result);
+
+  if (!g_file_load_contents (G_FILE (object), cancellable, &contents, &len, &etag, &error)) {
+    g_simple_async_result_take_error (result, error);
+    return;
+  }
+
+  charset = load_detect_charset (G_FILE (object), etag, contents, len, data->encoding);
+  g_free (etag);
+
+  data->subs = subtitles_parse (contents, len, charset, data->encoding, data->fps, &error);
+  if (data->subs == NULL)
+    g_simple_async_result_take_error (result, error);
+
+  g_free (contents);
+}
+
+/**
+ * bacon_video_subtitles_load_async:
+ * @file: a subtitle file
+ * @encoding: (allow-none): the character set to use when the detection of
+ * the one of the file is unsure
+ * @fps: the frame rate of the video, for frame-based formats, or 0
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: the function to call when the file has been parsed
+ * @user_data: data to pass to @callback
+ *
+ * Loads and parses @file in a thread, see bacon_video_subtitles_new_from_data().
+ **/
+void
+bacon_video_subtitles_load_async (GFile               *file,
+				  const char          *encoding,
+				  gdouble              fps,
+				  GCancellable        *cancellable,
+				  GAsyncReadyCallback  callback,
+				  gpointer             user_data)
+{
+  GSimpleAsyncResult *result;
+  LoadData *data;
+
+  g_return_if_fail (G_IS_FILE (file));
+
+  data = g_slice_new0 (LoadData);
+  data->encoding = g_strdup (encoding);
+  data->fps = fps;
+
+  result = g_simple_async_result_new (G_OBJECT (file), callback, user_data,
+				      bacon_video_subtitles_load_async);
+  g_simple_async_result_set_op_res_gpointer (result, data, (GDestroyNotify) load_data_free);
+  g_simple_async_result_run_in_thread (result, load_thread, G_PRIORITY_DEFAULT, cancellable);
+  g_object_unref (result);
+}
+
+/**
+ * bacon_video_subtitles_load_finish:
+ * @result: a #GAsyncResult
+ * @error: a #GError, or %NULL
+ *
+ * Finishes loading subtitles started with bacon_video_subtitles_load_async().
+ *
+ * Return value: a new #BaconVideoSubtitles, or %NULL on error
+ **/
+BaconVideoSubtitles *
+bacon_video_subtitles_load_finish (GAsyncResult  *result,
+				   GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+  LoadData *data;
+
+  g_return_val_if_fail (g_simple_async_result_get_source_tag (simple) == bacon_video_subtitles_load_async, NULL);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return NULL;
+
+  data = g_simple_async_result_get_op_res_gpointer (simple);
+  return bacon_video_subtitles_ref (data->subs);
+}
+
+/**
+ * bacon_video_subtitles_get_n_cues:
+ * @subs: a #BaconVideoSubtitles
+ *
+ * Returns the number of cues in @subs.
+ *
+ * Return value: the number of cues
+ **/
+guint
+bacon_video_subtitles_get_n_cues (BaconVideoSubtitles *subs)
+{
+  g_return_val_if_fail (subs != NULL, 0);
+
+  return subs->cues->len;
+}
+
+/**
+ * bacon_video_subtitles_get_cue:
+ * @subs: a #BaconVideoSubtitles
+ * @index: the index of a cue, in start time order
+ *
+ * Returns the cue at @index.
+ *
+ * Return value: (transfer none): the cue, owned by @subs
+ **/
+const BaconVideoSubtitleCue *
+bacon_video_subtitles_get_cue (BaconVideoSubtitles *subs,
+			       guint                index)
+{
+  g_return_val_if_fail (subs != NULL, NULL);
+  g_return_val_if_fail (index < subs->cues->len, NULL);
+
+  return &g_array_index (subs->cues, BaconVideoSubtitleCue, index);
+}
+
+/**
+ * bacon_video_subtitles_get_cues_at:
+ * @subs: a #BaconVideoSubtitles
+ * @time: a time, in milliseconds
+ * @n_cues: (out): return location for the number of cues
+ *
+ * Looks up the cues showing at @time, which can be more than one
+ * when they overlap.
+ *
+ * Return value: (array length=n_cues): the indices of the cues, in start time
+ * order, or %NULL if no cue is showing; free with g_free()
+ **/
+guint *
+bacon_video_subtitles_get_cues_at (BaconVideoSubtitles *subs,
+				   gint64               time,
+				   guint               *n_cues)
+{
+  GArray *indices;
+
+  g_return_val_if_fail (subs != NULL, NULL);
+  g_return_val_if_fail (n_cues != NULL, NULL);
+
+  indices = g_array_new (FALSE, FALSE, sizeof (guint));
+  query_index (subs, 0, subs->cues->len, time, indices);
+
+  *n_cues = indices->len;
+  return (guint *) g_array_free (indices, (indices->len == 0));
+}
+
+/**
+ * bacon_video_subtitles_get_next_cue:
+ * @subs: a #BaconVideoSubtitles
+ * @time: a time, in milliseconds
+ *
+ * Returns the first cue starting after @time, so that it can be prepared
+ * before it needs to be shown.
+ *
+ * Return value: the index of the cue, or <code class="literal">-1</code> if
+ * there are no more cues
+ **/
+gint
+bacon_video_subtitles_get_next_cue (BaconVideoSubtitles *subs,
+				    gint64               time)
+{
+  guint next;
+
+  g_return_val_if_fail (subs != NULL, -1);
+
+  next = upper_bound (subs, time);
+  return next < subs->cues->len ? (gint) next : -1;
+}
+
+/**
+ * bacon_video_subtitles_find:
+ * @subs: a #BaconVideoSubtitles
+ * @text: the text to look for
+ * @from_time: the time to start looking from, in milliseconds
+ *
+ * Looks for the first cue starting at or after @from_time
+ * which contains @text, ignoring case.
+ *
+ * Return value: the index of the cue, or <code class="literal">-1</code> if
+ * none matched
+ **/
+gint
+bacon_video_subtitles_find (BaconVideoSubtitles *subs,
+			    const char          *text,
+			    gint64               from_time)
+{
+  char *folded;
+  guint i;
+  gint ret = -1;
+
+  g_return_val_if_fail (subs != NULL, -1);
+  g_return_val_if_fail (text != NULL, -1);
+
+  folded = g_utf8_casefold (text, -1);
+
+  /* The first cue starting at or after @from_time */
+  i = from_time > 0 ? upper_bound (subs, from_time - 1) : 0;
+  for (; i < subs->cues->len; i++) {
+    if (strstr (subs->folded[i], folded) != NULL) {
+      ret = i;
+      break;
+    }
+  }
+
+  g_free (folded);
+
+  return ret;
+}
+
+/**
+ * bacon_video_subtitles_get_text_at:
+ * @subs: a #BaconVideoSubtitles
+ * @time: a time, in milliseconds
+ * @next_change: (out) (allow-none): return location for the time at which the
+ * text will next change, or <code class="literal">-1</code> if it won't
+ *
+ * Returns the text of the cues showing at @time, one after the other.
+ *
+ * Return value: the text, or %NULL if no cue is showing; free with g_free()
+ **/
+char *
+bacon_video_subtitles_get_text_at (BaconVideoSubtitles *subs,
+				   gint64               time,
+				   gint64              *next_change)
+{
+  guint *indices;
+  guint n_cues, i;
+  GString *text = NULL;
+  gint next;
+  gint64 change = -1;
+
+  g_return_val_if_fail (subs != NULL, NULL);
+
+  next = bacon_video_subtitles_get_next_cue (subs, time);
+  if (next >= 0)
+    change = g_array_index (subs->cues, BaconVideoSubtitleCue, next).start;
+
+  indices = bacon_video_subtitles_get_cues_at (subs, time, &n_cues);
+  for (i = 0; i < n_cues; i++) {
+    const BaconVideoSubtitleCue *cue;
+
+    cue = &g_array_index (subs->cues, BaconVideoSubtitleCue, indices[i]);
+    if (change < 0 || cue->end < change)
+      change = cue->end;
+
+    if (text == NULL)
+      text = g_string_new (cue->text);
+    else
+      g_string_append_printf (text, "\n%s", cue->text);
+  }
+  g_free (indices);
+
+  if (next_change != NULL)
+    *next_change = change;
+
+  return text ? g_string_free (text, FALSE) : NULL;
+}
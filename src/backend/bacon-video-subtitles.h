@@ -0,0 +1,77 @@
+/*
+ * Cue store for external text subtitles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#ifndef BACON_VIDEO_SUBTITLES_H
+#define BACON_VIDEO_SUBTITLES_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * BaconVideoSubtitleCue:
+ * @start: the time at which the cue appears, in milliseconds
+ * @end: the time at which the cue disappears, in milliseconds
+ * @text: the text of the cue, as UTF-8 without any markup
+ *
+ * A single line, or group of lines, of an external subtitle file.
+ **/
+typedef struct {
+  gint64  start;
+  gint64  end;
+  char   *text;
+} BaconVideoSubtitleCue;
+
+typedef struct BaconVideoSubtitles BaconVideoSubtitles;
+
+BaconVideoSubtitles *bacon_video_subtitles_new_from_data (const char   *data,
+							  gsize         len,
+							  const char   *encoding,
+							  gdouble       fps,
+							  GError      **error);
+void                 bacon_video_subtitles_load_async    (GFile               *file,
+							  const char          *encoding,
+							  gdouble              fps,
+							  GCancellable        *cancellable,
+							  GAsyncReadyCallback  callback,
+							  gpointer             user_data);
+BaconVideoSubtitles *bacon_video_subtitles_load_finish   (GAsyncResult        *result,
+							  GError             **error);
+
+BaconVideoSubtitles *bacon_video_subtitles_ref           (BaconVideoSubtitles *subs);
+void                 bacon_video_subtitles_unref         (BaconVideoSubtitles *subs);
+
+guint                bacon_video_subtitles_get_n_cues    (BaconVideoSubtitles *subs);
+const BaconVideoSubtitleCue *
+                     bacon_video_subtitles_get_cue       (BaconVideoSubtitles *subs,
+							  guint                index);
+guint *              bacon_video_subtitles_get_cues_at   (BaconVideoSubtitles *subs,
+							  gint64               time,
+							  guint               *n_cues);
+gint                 bacon_video_subtitles_get_next_cue  (BaconVideoSubtitles *subs,
+							  gint64               time);
+gint                 bacon_video_subtitles_find          (BaconVideoSubtitles *subs,
+							  const char          *text,
+							  gint64               from_time);
+char *               bacon_video_subtitles_get_text_at   (BaconVideoSubtitles *subs,
+							  gint64               time,
+							  gint64              *next_change);
+
+G_END_DECLS
+
+#endif /* BACON_VIDEO_SUBTITLES_H */
@@ -30,6 +30,7 @@
 #ifdef ENABLE_MISSING_PLUGIN_INSTALLATION
 
 #include "bacon-video-widget.h"
+#include "xplayer-gst-registry-cache.h"
 
 #include <gst/pbutils/pbutils.h>
 #include <gst/pbutils/install-plugins.h>
@@ -160,8 +161,10 @@ on_plugin_installation_done (GstInstallPluginsReturn res, gpointer user_data)
 				g_message ("Missing plugins installed. Updating plugin registry ...");
 
 				/* force GStreamer to re-read its plugin registry */
+				xplayer_gst_registry_cache_invalidate ();
 				if (gst_update_registry ())
 				{
+					xplayer_gst_registry_cache_update ();
 					g_message ("Plugin registry updated, trying again.");
 					bacon_video_widget_play (ctx->bvw, NULL);
 				} else {
@@ -83,27 +83,59 @@
 #endif /* GDK_WINDOWING_X11 */
 
 #include "xplayer-gst-helpers.h"
+#include "xplayer-gst-registry-cache.h"
 #include "xplayer-gst-pixbuf-helpers.h"
 #include "bacon-video-widget.h"
 #include "bacon-video-widget-gst-missing-plugins.h"
 #include "bacon-video-osd-actor.h"
+#include "bacon-video-subtitles.h"
+#include "bacon-video-loudness.h"
+#include "bacon-video-quality.h"
 #include "bacon-video-widget-enums.h"
 #include "video-utils.h"
+#include "xplayer-trace.h"
 
 #define DEFAULT_USER_AGENT "Videos/"VERSION
 
 #define OSD_SIZE 130                           /* Size of the OSD popup */
 #define OSD_MARGIN 8                           /* Pixels from the top-left */
 #define LOGO_SIZE 256                          /* Maximum size of the logo */
+#define SUBTITLE_MARGIN 24                     /* Pixels from the bottom */
+#define DEFAULT_SUBTITLE_FONT "Sans Bold 18"
 
 #define MAX_NETWORK_SPEED 10752
+/* HTTP sources read this much at a time, rather than basesrc's 4 kB */
+#define HTTP_BLOCKSIZE (64 * 1024)
+/* Seconds before giving up on an HTTP server that doesn't answer,
+ * rather than souphttpsrc's 15 */
+#define HTTP_TIMEOUT 8
+/* Minimum interval between two metadata-changed emissions, in msecs */
+#define METADATA_UPDATE_INTERVAL 500
 #define BUFFERING_LEFT_RATIO 1.1
+/* Ring buffer mode defaults */
+#define DEFAULT_RING_BUFFER_SIZE (32 * 1024 * 1024)
+#define DEFAULT_BUFFER_DURATION 2.0             /* in seconds */
+#define DEFAULT_LOW_WATERMARK 10                /* in percent */
+#define DEFAULT_HIGH_WATERMARK 99
+/* Refresh the playback statistics every n-th tick (of 200 msecs) */
+#define STATS_UPDATE_TICKS 5
+/* Download progress checks while paused, in msecs */
+#define DOWNLOAD_BUFFERING_INTERVAL 1000
 
 /* Helper constants */
 #define NANOSECS_IN_SEC 1000000000
 #define SEEK_TIMEOUT NANOSECS_IN_SEC / 10
 #define FORWARD_RATE 1.0
 #define REVERSE_RATE -1.0
+#define MIN_PLAYBACK_RATE 0.1
+#define MAX_PLAYBACK_RATE 32.0
+/* Above this rate, forwards or backwards, only decode keyframes and
+ * drop the audio, instead of decoding every frame and throwing most
+ * of them away */
+#define TRICKMODE_RATE_THRESHOLD 2.0
+#define TRICKMODE_SEEK_FLAGS (GST_SEEK_FLAG_TRICKMODE | \
+			      GST_SEEK_FLAG_TRICKMODE_KEY_UNITS | \
+			      GST_SEEK_FLAG_TRICKMODE_NO_AUDIO)
 
 #define is_error(e, d, c) \
   (e->domain == GST_##d##_ERROR && \
@@ -126,9 +158,11 @@ enum
   SIGNAL_CHANNELS_CHANGE,
   SIGNAL_TICK,
   SIGNAL_GOT_METADATA,
+  SIGNAL_METADATA_CHANGED,
   SIGNAL_BUFFERING,
   SIGNAL_MISSING_PLUGINS,
   SIGNAL_DOWNLOAD_BUFFERING,
+  SIGNAL_STATS_UPDATED,
   LAST_SIGNAL
 };
 
@@ -154,7 +188,26 @@ enum
   PROP_SATURATION,
   PROP_HUE,
   PROP_AUDIO_OUTPUT_TYPE,
-  PROP_AV_OFFSET
+  PROP_AV_OFFSET,
+  PROP_SHOW_STATS,
+  PROP_ADAPTIVE_QUALITY,
+  PROP_BUFFERING_MODE,
+  PROP_RING_BUFFER_SIZE,
+  PROP_BUFFER_DURATION,
+  PROP_LOW_WATERMARK,
+  PROP_HIGH_WATERMARK,
+  PROP_LOUDNESS_NORMALIZATION
+};
+
+/* The steps the adaptive quality controller goes through,
+ * each one including the ones before it */
+enum
+{
+  QUALITY_LEVEL_FULL,
+  QUALITY_LEVEL_CHEAP_DEINTERLACE,
+  QUALITY_LEVEL_FAST_SCALING,
+  QUALITY_LEVEL_SKIP_FRAMES,
+  QUALITY_LEVEL_LOWEST = QUALITY_LEVEL_SKIP_FRAMES
 };
 
 static const gchar *video_props_str[4] = {
@@ -173,6 +226,18 @@ struct BaconVideoWidgetPrivate
   char                        *subtitle_uri;
   BvwAspectRatio               ratio_type;
 
+  /* external text subtitles, rendered on the stage rather
+   * than by playbin, unless we can't parse them */
+  BaconVideoSubtitles         *subtitles;
+  GCancellable                *subtitles_cancellable;
+  gboolean                     subtitles_in_pipeline;
+  gboolean                     show_subtitles;
+  char                        *subtitle_font;
+  ClutterActor                *subtitle_text;
+  guint                        subtitle_update_id;
+  gint64                       subtitle_valid_from; /* the text shown is current */
+  gint64                       subtitle_valid_until; /* between these, in msecs */
+
   GstElement                  *play;
   GstNavigation               *navigation;
 
@@ -197,6 +262,11 @@ struct BaconVideoWidgetPrivate
   GAsyncQueue                 *tag_update_queue;
   guint                        tag_update_id;
 
+  /* rate-limiting of the metadata signals */
+  BvwMetadataChangeFlags       pending_metadata_changes;
+  guint                        metadata_update_id;
+  gint64                       last_metadata_update; /* monotonic, in usecs */
+
   gboolean                     got_redirect;
 
   ClutterActor                *stage;
@@ -204,15 +274,29 @@ struct BaconVideoWidgetPrivate
   ClutterActor                *frame;
   ClutterActor                *osd;
 
+  /* Only on the stage while it's shown */
   ClutterActor                *logo_frame;
   ClutterActor                *logo;
 
   GdkCursor                   *cursor;
 
   /* Visual effects */
+  GstElement                  *audio_bin;
+  GstElement                  *audio_sink;
   GstElement                  *audio_capsfilter;
   GstElement                  *audio_pitchcontrol;
 
+  /* Only created when the audio output type is passthrough */
+  GstElement                  *passthrough_bin;
+  GstElement                  *passthrough_sink;
+  GstElement                  *passthrough_capsfilter;
+
+  /* Loudness normalisation */
+  GstElement                  *audio_gain;
+  gboolean                     loudness_normalization;
+  gboolean                     has_replaygain; /* the tags set the gain */
+  GCancellable                *loudness_cancellable;
+
   /* Other stuff */
   gboolean                     logo_mode;
   gboolean                     cursor_shown;
@@ -255,11 +339,19 @@ struct BaconVideoWidgetPrivate
   gboolean                     buffering;
   gboolean                     download_buffering;
   GstElement                  *download_buffering_element;
+  gint                         download_fill; /* in per mille, or -1 */
   char                        *download_filename;
   /* used to compute when the download buffer has gone far
    * enough to start playback, not "amount of buffering time left
    * to reach 100% fill-level" */
   gint64                       buffering_left;
+  /* how network streams get buffered, applied when opening */
+  BvwBufferingMode             buffering_mode;
+  guint64                      ring_buffer_size;
+  gdouble                      buffer_duration; /* in seconds */
+  gint                         low_watermark;   /* in percent */
+  gint                         high_watermark;
+  GstElement                  *ring_buffering_element; /* has our watermarks */
 
   /* for easy codec installation */
   GList                       *missing_plugins;   /* GList of GstMessages */
@@ -277,6 +369,27 @@ struct BaconVideoWidgetPrivate
 
   /* for stepping */
   float                        rate;
+  gboolean                     trickmode; /* keyframe-only, audio muted */
+  gboolean                     trickmode_saved_mute; /* to restore after it */
+
+  /* playback statistics */
+  BvwStats                     stats;
+  gint64                       open_time; /* monotonic, in usecs */
+  gint64                       seek_start_time; /* monotonic, in usecs */
+  guint                        stats_ticks;
+  gboolean                     show_stats;
+  ClutterActor                *stats_text;
+
+  /* stage paints, since the statistics were last refreshed */
+  gint64                       paint_start; /* monotonic, in usecs */
+  gint64                       last_paint_start;
+  gint64                       paint_time_total;
+  gint64                       paint_interval_max;
+  guint                        paint_count;
+
+  /* adaptive quality */
+  gboolean                     adaptive_quality;
+  BaconVideoQuality            quality;
 };
 
 static void bacon_video_widget_set_property (GObject * object,
@@ -296,6 +409,13 @@ static GError* bvw_error_from_gst_error (BaconVideoWidget *bvw, GstMessage *m);
 static gboolean bvw_check_for_cover_pixbuf (BaconVideoWidget * bvw);
 static const GdkPixbuf * bvw_get_logo_pixbuf (BaconVideoWidget * bvw);
 static gboolean bvw_set_playback_direction (BaconVideoWidget *bvw, gboolean forward);
+static void bvw_set_trickmode (BaconVideoWidget *bvw, gboolean trickmode);
+static void bvw_reset_stats (BaconVideoWidget *bvw);
+static void bvw_update_stats (BaconVideoWidget *bvw);
+static void bvw_update_stats_text (BaconVideoWidget *bvw);
+static void bvw_set_quality_level (BaconVideoWidget *bvw, guint level);
+static void bvw_update_subtitle_text (BaconVideoWidget *bvw, gint64 time);
+static void bvw_unload_subtitles (BaconVideoWidget *bvw);
 static gboolean bacon_video_widget_seek_time_no_lock (BaconVideoWidget *bvw,
 						      gint64 _time,
 						      GstSeekFlags flag,
@@ -392,8 +512,23 @@ bvw_check_if_video_decoder_is_missing (BaconVideoWidget * bvw)
 
     if ((d = gst_missing_plugin_message_get_installer_detail (msg))) {
       if ((f = strstr (d, "|decoder-")) && strstr (f, "video")) {
+        GstCaps *caps;
         GError *err;
 
+        /* Not missing anymore if it was installed since the message */
+        caps = gst_caps_from_string (f + strlen ("|decoder-"));
+        if (caps != NULL) {
+          gboolean installed;
+
+          installed = (!gst_caps_is_empty (caps) &&
+                       xplayer_gst_registry_cache_has_decoder (caps));
+          gst_caps_unref (caps);
+          if (installed) {
+            g_free (d);
+            continue;
+          }
+        }
+
         /* create a fake GStreamer error so we get a nice warning message */
         err = g_error_new (GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN, "x");
         msg = gst_message_new_error (GST_OBJECT (bvw->priv->play), err, NULL);
@@ -667,7 +802,10 @@ set_current_actor (BaconVideoWidget *bvw)
 	g_message ("clutter_texture_set_from_rgb_data failed %s", err->message);
 	g_error_free (err);
       } else {
-	clutter_actor_show (CLUTTER_ACTOR (bvw->priv->logo_frame));
+	if (clutter_actor_get_parent (bvw->priv->logo_frame) == NULL)
+	  clutter_actor_insert_child_above (bvw->priv->stage,
+					    bvw->priv->logo_frame,
+					    bvw->priv->frame);
 	clutter_actor_hide (CLUTTER_ACTOR (bvw->priv->frame));
 	return;
       }
@@ -675,7 +813,10 @@ set_current_actor (BaconVideoWidget *bvw)
   }
 
   clutter_actor_show (CLUTTER_ACTOR (bvw->priv->frame));
-  clutter_actor_hide (CLUTTER_ACTOR (bvw->priv->logo_frame));
+  /* Taken off the stage, so that it's not even looked at when
+   * painting, picking or laying out the video */
+  if (clutter_actor_get_parent (bvw->priv->logo_frame) != NULL)
+    clutter_actor_remove_child (bvw->priv->stage, bvw->priv->logo_frame);
 }
 
 /* need to use gstnavigation interface for these vmethods, to allow for the sink
@@ -885,6 +1026,108 @@ bacon_video_widget_class_init (BaconVideoWidgetClass * klass)
                                                          G_PARAM_READWRITE |
                                                          G_PARAM_STATIC_STRINGS));
 
+  /**
+   * BaconVideoWidget:show-stats:
+   *
+   * Whether the playback statistics are overlaid on the video.
+   **/
+  g_object_class_install_property (object_class, PROP_SHOW_STATS,
+                                   g_param_spec_boolean ("show-stats", "Show statistics?",
+                                                         "Whether the playback statistics are shown.", FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
+
+  /**
+   * BaconVideoWidget:adaptive-quality:
+   *
+   * Whether to lower the video quality when frames keep being dropped.
+   **/
+  g_object_class_install_property (object_class, PROP_ADAPTIVE_QUALITY,
+                                   g_param_spec_boolean ("adaptive-quality", "Adaptive quality?",
+                                                         "Whether to lower the video quality when frames keep being dropped.", TRUE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
+
+  /**
+   * BaconVideoWidget:buffering-mode:
+   *
+   * How network streams are buffered. Changes apply to the next stream opened.
+   **/
+  g_object_class_install_property (object_class, PROP_BUFFERING_MODE,
+                                   g_param_spec_enum ("buffering-mode", "Buffering mode",
+                                                      "How network streams are buffered.", BVW_TYPE_BUFFERING_MODE,
+                                                      BVW_BUFFERING_DOWNLOAD,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+
+  /**
+   * BaconVideoWidget:ring-buffer-size:
+   *
+   * The amount of memory, in bytes, used to hold network streams in
+   * %BVW_BUFFERING_RING mode. What isn't needed for the data ahead of the
+   * playback position keeps the data behind it, so that it can be seeked
+   * back to without fetching it again.
+   **/
+  g_object_class_install_property (object_class, PROP_RING_BUFFER_SIZE,
+                                   g_param_spec_uint64 ("ring-buffer-size", "Ring buffer size",
+                                                        "The memory used for network streams in ring buffer mode, in bytes.",
+                                                        1024 * 1024, G_MAXUINT64, DEFAULT_RING_BUFFER_SIZE,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
+
+  /**
+   * BaconVideoWidget:buffer-duration:
+   *
+   * The amount of a network stream, in seconds, to keep buffered ahead of
+   * the playback position.
+   **/
+  g_object_class_install_property (object_class, PROP_BUFFER_DURATION,
+                                   g_param_spec_double ("buffer-duration", "Buffer duration",
+                                                        "The amount of network streams to buffer ahead, in seconds.",
+                                                        0.1, 3600.0, DEFAULT_BUFFER_DURATION,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
+
+  /**
+   * BaconVideoWidget:low-watermark:
+   *
+   * The fill level of the stream buffer, as a percentage of
+   * #BaconVideoWidget:buffer-duration, below which playback pauses to
+   * buffer more data, in %BVW_BUFFERING_RING mode.
+   **/
+  g_object_class_install_property (object_class, PROP_LOW_WATERMARK,
+                                   g_param_spec_int ("low-watermark", "Low watermark",
+                                                     "The buffer level below which playback pauses, in percent.",
+                                                     0, 100, DEFAULT_LOW_WATERMARK,
+                                                     G_PARAM_READWRITE |
+                                                     G_PARAM_STATIC_STRINGS));
+
+  /**
+   * BaconVideoWidget:high-watermark:
+   *
+   * The fill level of the stream buffer, as a percentage of
+   * #BaconVideoWidget:buffer-duration, at which playback starts or resumes,
+   * in %BVW_BUFFERING_RING mode.
+   **/
+  g_object_class_install_property (object_class, PROP_HIGH_WATERMARK,
+                                   g_param_spec_int ("high-watermark", "High watermark",
+                                                     "The buffer level at which playback starts, in percent.",
+                                                     1, 100, DEFAULT_HIGH_WATERMARK,
+                                                     G_PARAM_READWRITE |
+                                                     G_PARAM_STATIC_STRINGS));
+
+  /**
+   * BaconVideoWidget:loudness-normalization:
+   *
+   * Whether to bring all streams to the same loudness, from their
+   * ReplayGain tags or from earlier measurements of local files.
+   **/
+  g_object_class_install_property (object_class, PROP_LOUDNESS_NORMALIZATION,
+                                   g_param_spec_boolean ("loudness-normalization", "Loudness normalization?",
+                                                         "Whether to bring all streams to the same loudness.", FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
+
   /**
    * BaconVideoWidget:referrer:
    *
@@ -1056,6 +1299,23 @@ bacon_video_widget_class_init (BaconVideoWidgetClass * klass)
                   G_STRUCT_OFFSET (BaconVideoWidgetClass, got_metadata),
                   NULL, NULL, g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 
+  /**
+   * BaconVideoWidget::metadata-changed:
+   * @changed: the #BvwMetadataChangeFlags of the fields which changed
+   *
+   * Emitted alongside #BaconVideoWidget::got-metadata, with the set of
+   * fields which actually changed since the last emission. Tag updates
+   * are coalesced, so this is emitted at most every half second while
+   * a stream keeps sending tags.
+   **/
+  bvw_signals[SIGNAL_METADATA_CHANGED] =
+    g_signal_new (I_("metadata-changed"),
+                  G_TYPE_FROM_CLASS (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (BaconVideoWidgetClass, metadata_changed),
+                  NULL, NULL, g_cclosure_marshal_VOID__FLAGS,
+                  G_TYPE_NONE, 1, BVW_TYPE_METADATA_CHANGE_FLAGS);
+
   /**
    * BaconVideoWidget::got-redirect:
    * @new_mrl: the new MRL
@@ -1155,6 +1415,19 @@ bacon_video_widget_class_init (BaconVideoWidgetClass * klass)
                   G_STRUCT_OFFSET (BaconVideoWidgetClass, download_buffering),
                   NULL, NULL,
                   g_cclosure_marshal_VOID__DOUBLE, G_TYPE_NONE, 1, G_TYPE_DOUBLE);
+
+  /**
+   * BaconVideoWidget::stats-updated:
+   *
+   * Emitted every second during playback, once the playback statistics
+   * have been refreshed. Call bacon_video_widget_get_stats() to read them.
+   **/
+  bvw_signals[SIGNAL_STATS_UPDATED] =
+    g_signal_new (I_("stats-updated"),
+                  G_TYPE_FROM_CLASS (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (BaconVideoWidgetClass, stats_updated),
+                  NULL, NULL, g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 }
 
 static void
@@ -1186,6 +1459,16 @@ bacon_video_widget_init (BaconVideoWidget * bvw)
   priv->seek_req_time = GST_CLOCK_TIME_NONE;
   priv->seek_time = -1;
 
+  bvw_reset_stats (bvw);
+  priv->open_time = -1;
+  priv->adaptive_quality = TRUE;
+
+  priv->buffering_mode = BVW_BUFFERING_DOWNLOAD;
+  priv->ring_buffer_size = DEFAULT_RING_BUFFER_SIZE;
+  priv->buffer_duration = DEFAULT_BUFFER_DURATION;
+  priv->low_watermark = DEFAULT_LOW_WATERMARK;
+  priv->high_watermark = DEFAULT_HIGH_WATERMARK;
+
   priv->missing_plugins = NULL;
   priv->plugin_install_in_progress = FALSE;
 
@@ -1198,15 +1481,21 @@ bacon_video_widget_init (BaconVideoWidget * bvw)
 }
 
 static gboolean bvw_query_timeout (BaconVideoWidget *bvw);
-static gboolean bvw_query_buffering_timeout (BaconVideoWidget *bvw);
+static gboolean bvw_download_buffering_timeout (BaconVideoWidget *bvw);
+static void bvw_update_download_buffering (BaconVideoWidget *bvw);
+static void bvw_configure_buffering (BaconVideoWidget *bvw);
+static void bvw_lookup_loudness (BaconVideoWidget *bvw);
+static void bvw_reset_loudness (BaconVideoWidget *bvw);
 static void parse_stream_info (BaconVideoWidget *bvw);
+static void bvw_emit_metadata_changed (BaconVideoWidget *bvw, BvwMetadataChangeFlags changed);
+static void bvw_cancel_metadata_update (BaconVideoWidget *bvw);
 
 static void
 bvw_update_stream_info (BaconVideoWidget *bvw)
 {
   parse_stream_info (bvw);
 
-  g_signal_emit (bvw, bvw_signals[SIGNAL_GOT_METADATA], 0, NULL);
+  bvw_emit_metadata_changed (bvw, BVW_METADATA_CHANGED_STREAM_INFO);
   g_signal_emit (bvw, bvw_signals[SIGNAL_CHANNELS_CHANGE], 0);
 }
 
@@ -1228,7 +1517,7 @@ bvw_handle_application_message (BaconVideoWidget *bvw, GstMessage *msg)
   else if (strcmp (msg_name, "video-size") == 0) {
     int w, h;
 
-    g_signal_emit (bvw, bvw_signals[SIGNAL_GOT_METADATA], 0, NULL);
+    bvw_emit_metadata_changed (bvw, BVW_METADATA_CHANGED_STREAM_INFO);
 
     /* This is necessary for the pixel-aspect-ratio of the
      * display to be taken into account. */
@@ -1510,7 +1799,7 @@ bvw_reconfigure_fill_timeout (BaconVideoWidget *bvw, guint msecs)
   if (msecs > 0) {
     GST_DEBUG ("adding fill timeout (at %ums)", msecs);
     bvw->priv->fill_id =
-      g_timeout_add (msecs, (GSourceFunc) bvw_query_buffering_timeout, bvw);
+      g_timeout_add (msecs, (GSourceFunc) bvw_download_buffering_timeout, bvw);
   }
 }
 
@@ -1737,21 +2026,240 @@ update_orientation_from_video (BaconVideoWidget *bvw)
   xplayer_aspect_frame_set_rotation (XPLAYER_ASPECT_FRAME (bvw->priv->frame), angle);
 }
 
+static BvwMetadataChangeFlags
+bvw_metadata_flag_for_tag (const gchar *tag)
+{
+  if (g_str_equal (tag, GST_TAG_TITLE))
+    return BVW_METADATA_CHANGED_TITLE;
+  if (g_str_equal (tag, GST_TAG_ARTIST))
+    return BVW_METADATA_CHANGED_ARTIST;
+  if (g_str_equal (tag, GST_TAG_ALBUM))
+    return BVW_METADATA_CHANGED_ALBUM;
+  if (g_str_equal (tag, GST_TAG_DATE) ||
+      g_str_equal (tag, GST_TAG_DATE_TIME))
+    return BVW_METADATA_CHANGED_YEAR;
+  if (g_str_equal (tag, GST_TAG_COMMENT))
+    return BVW_METADATA_CHANGED_COMMENT;
+  if (g_str_equal (tag, GST_TAG_TRACK_NUMBER))
+    return BVW_METADATA_CHANGED_TRACK_NUMBER;
+  if (g_str_equal (tag, GST_TAG_IMAGE) ||
+      g_str_equal (tag, GST_TAG_PREVIEW_IMAGE))
+    return BVW_METADATA_CHANGED_COVER;
+  if (g_str_equal (tag, GST_TAG_IMAGE_ORIENTATION))
+    return BVW_METADATA_CHANGED_ORIENTATION;
+  if (g_str_equal (tag, GST_TAG_VIDEO_CODEC) ||
+      g_str_equal (tag, GST_TAG_AUDIO_CODEC) ||
+      g_str_equal (tag, GST_TAG_BITRATE) ||
+      g_str_equal (tag, GST_TAG_NOMINAL_BITRATE) ||
+      g_str_equal (tag, GST_TAG_CONTAINER_FORMAT))
+    return BVW_METADATA_CHANGED_STREAM_INFO;
+  return BVW_METADATA_CHANGED_OTHER;
+}
+
+static gboolean
+bvw_tag_values_equal (const GValue *a, const GValue *b)
+{
+  GstBuffer *buf_a, *buf_b;
+  GstMapInfo info;
+  gboolean ret;
+
+  if (G_VALUE_TYPE (a) != G_VALUE_TYPE (b))
+    return FALSE;
+
+  if (G_VALUE_TYPE (a) != GST_TYPE_SAMPLE)
+    return gst_value_compare (a, b) == GST_VALUE_EQUAL;
+
+  /* GstSamples aren't comparable, so compare the images themselves,
+   * to avoid decoding the same cover again */
+  buf_a = gst_sample_get_buffer (gst_value_get_sample (a));
+  buf_b = gst_sample_get_buffer (gst_value_get_sample (b));
+  if (buf_a == buf_b)
+    return TRUE;
+  if (buf_a == NULL || buf_b == NULL ||
+      gst_buffer_get_size (buf_a) != gst_buffer_get_size (buf_b))
+    return FALSE;
+  if (!gst_buffer_map (buf_b, &info, GST_MAP_READ))
+    return FALSE;
+  ret = (gst_buffer_memcmp (buf_a, 0, info.data, info.size) == 0);
+  gst_buffer_unmap (buf_b, &info);
+
+  return ret;
+}
+
+typedef struct {
+  const GstTagList *old_tags;
+  BvwMetadataChangeFlags changed;
+} TagsDiffData;
+
+static void
+bvw_diff_tag_foreach (const GstTagList *list, const gchar *tag, gpointer user_data)
+{
+  TagsDiffData *data = user_data;
+  BvwMetadataChangeFlags flag;
+  guint i, size;
+
+  flag = bvw_metadata_flag_for_tag (tag);
+  if (data->changed & flag)
+    return;
+
+  size = gst_tag_list_get_tag_size (list, tag);
+  if (data->old_tags == NULL ||
+      gst_tag_list_get_tag_size (data->old_tags, tag) != size) {
+    data->changed |= flag;
+    return;
+  }
+
+  for (i = 0; i < size; i++) {
+    if (!bvw_tag_values_equal (gst_tag_list_get_value_index (list, tag, i),
+			       gst_tag_list_get_value_index (data->old_tags, tag, i))) {
+      data->changed |= flag;
+      return;
+    }
+  }
+}
+
+/* Returns the fields in @new_tags which differ from @old_tags */
+static BvwMetadataChangeFlags
+bvw_diff_tags (const GstTagList *old_tags, const GstTagList *new_tags)
+{
+  TagsDiffData data;
+
+  if (new_tags == NULL)
+    return BVW_METADATA_CHANGED_NONE;
+
+  data.old_tags = old_tags;
+  data.changed = BVW_METADATA_CHANGED_NONE;
+  gst_tag_list_foreach (new_tags, bvw_diff_tag_foreach, &data);
+
+  return data.changed;
+}
+
+static void
+bvw_emit_metadata_changed (BaconVideoWidget *bvw, BvwMetadataChangeFlags changed)
+{
+  if (bvw->priv->metadata_update_id != 0) {
+    g_source_remove (bvw->priv->metadata_update_id);
+    bvw->priv->metadata_update_id = 0;
+  }
+
+  changed |= bvw->priv->pending_metadata_changes;
+  bvw->priv->pending_metadata_changes = BVW_METADATA_CHANGED_NONE;
+  bvw->priv->last_metadata_update = g_get_monotonic_time ();
+
+  g_signal_emit (bvw, bvw_signals[SIGNAL_GOT_METADATA], 0, NULL);
+  g_signal_emit (bvw, bvw_signals[SIGNAL_METADATA_CHANGED], 0, changed);
+}
+
+static gboolean
+bvw_metadata_update_timeout (BaconVideoWidget *bvw)
+{
+  bvw->priv->metadata_update_id = 0;
+  bvw_emit_metadata_changed (bvw, BVW_METADATA_CHANGED_NONE);
+
+  return FALSE;
+}
+
+/* Radio and HLS streams send new tags all the time, so don't
+ * signal more often than every METADATA_UPDATE_INTERVAL */
+static void
+bvw_queue_metadata_changed (BaconVideoWidget *bvw, BvwMetadataChangeFlags changed)
+{
+  gint64 elapsed;
+
+  if (changed == BVW_METADATA_CHANGED_NONE)
+    return;
+
+  bvw->priv->pending_metadata_changes |= changed;
+  if (bvw->priv->metadata_update_id != 0)
+    return;
+
+  elapsed = (g_get_monotonic_time () - bvw->priv->last_metadata_update) / 1000;
+  if (elapsed >= METADATA_UPDATE_INTERVAL || elapsed < 0) {
+    bvw_emit_metadata_changed (bvw, BVW_METADATA_CHANGED_NONE);
+    return;
+  }
+
+  bvw->priv->metadata_update_id =
+    g_timeout_add (METADATA_UPDATE_INTERVAL - elapsed,
+		   (GSourceFunc) bvw_metadata_update_timeout, bvw);
+}
+
+static void
+bvw_cancel_metadata_update (BaconVideoWidget *bvw)
+{
+  if (bvw->priv->metadata_update_id != 0) {
+    g_source_remove (bvw->priv->metadata_update_id);
+    bvw->priv->metadata_update_id = 0;
+  }
+  bvw->priv->pending_metadata_changes = BVW_METADATA_CHANGED_NONE;
+}
+
+/* ReplayGain's reference level, which is the same as -18 LUFS */
+#define REPLAYGAIN_REFERENCE 89.0
+
+static void
+bvw_set_audio_gain (BaconVideoWidget *bvw, gdouble gain)
+{
+  if (bvw->priv->audio_gain == NULL)
+    return;
+
+  GST_DEBUG ("Setting the audio gain to %.2f dB", 20.0 * log10 (gain));
+  g_object_set (bvw->priv->audio_gain, "volume", gain, NULL);
+}
+
+/* Uses the ReplayGain tags of the current audio stream, rather than the
+ * tag cache, which also has those of the other streams and files */
 static void
+bvw_update_replaygain (BaconVideoWidget *bvw)
+{
+  BaconVideoLoudness loudness;
+  GstTagList *tags = NULL;
+  gdouble gain, peak = 0.0, reference = REPLAYGAIN_REFERENCE;
+  gint stream = -1;
+
+  if (!bvw->priv->loudness_normalization)
+    return;
+
+  g_object_get (bvw->priv->play, "current-audio", &stream, NULL);
+  if (stream >= 0)
+    g_signal_emit_by_name (bvw->priv->play, "get-audio-tags", stream, &tags);
+  if (tags == NULL)
+    return;
+
+  if (!gst_tag_list_get_double (tags, GST_TAG_TRACK_GAIN, &gain) &&
+      !gst_tag_list_get_double (tags, GST_TAG_ALBUM_GAIN, &gain)) {
+    gst_tag_list_unref (tags);
+    return;
+  }
+  if (!gst_tag_list_get_double (tags, GST_TAG_TRACK_PEAK, &peak))
+    gst_tag_list_get_double (tags, GST_TAG_ALBUM_PEAK, &peak);
+  gst_tag_list_get_double (tags, GST_TAG_REFERENCE_LEVEL, &reference);
+  gst_tag_list_unref (tags);
+
+  /* The tags win over measurements, which aren't needed anymore */
+  if (bvw->priv->loudness_cancellable)
+    g_cancellable_cancel (bvw->priv->loudness_cancellable);
+  g_clear_object (&bvw->priv->loudness_cancellable);
+  bvw->priv->has_replaygain = TRUE;
+
+  loudness.loudness = BACON_VIDEO_LOUDNESS_TARGET - gain - (REPLAYGAIN_REFERENCE - reference);
+  loudness.peak = peak;
+  bvw_set_audio_gain (bvw, bacon_video_loudness_get_gain (&loudness));
+}
+
+/* Merges @tag_list into the caches, and returns which fields changed.
+ * Takes ownership of @tag_list */
+static BvwMetadataChangeFlags
 bvw_update_tags (BaconVideoWidget * bvw, GstTagList *tag_list, const gchar *type)
 {
   GstTagList **cache = NULL;
   GstTagList *result;
+  BvwMetadataChangeFlags changed;
 
   GST_DEBUG ("Tags: %" GST_PTR_FORMAT, tag_list);
 
-  /* all tags (replace previous tags, title/artist/etc. might change
-   * in the middle of a stream, e.g. with radio streams) */
-  result = gst_tag_list_merge (bvw->priv->tagcache, tag_list,
-                                   GST_TAG_MERGE_REPLACE);
-  if (bvw->priv->tagcache)
-    gst_tag_list_unref (bvw->priv->tagcache);
-  bvw->priv->tagcache = result;
+  if (strcmp (type, "audio") == 0)
+    bvw_update_replaygain (bvw);
 
   /* media-type-specific tags */
   if (!strcmp (type, "video")) {
@@ -1760,6 +2268,24 @@ bvw_update_tags (BaconVideoWidget * bvw, GstTagList *tag_list, const gchar *type
     cache = &bvw->priv->audiotags;
   }
 
+  /* Compare against the tags of the same stream type where we can,
+   * so that audio and video tags don't flip-flop the shared fields */
+  changed = bvw_diff_tags (cache ? *cache : bvw->priv->tagcache, tag_list);
+  if (changed == BVW_METADATA_CHANGED_NONE) {
+    GST_LOG ("No metadata changes");
+    if (tag_list)
+      gst_tag_list_unref (tag_list);
+    return changed;
+  }
+
+  /* all tags (replace previous tags, title/artist/etc. might change
+   * in the middle of a stream, e.g. with radio streams) */
+  result = gst_tag_list_merge (bvw->priv->tagcache, tag_list,
+                                   GST_TAG_MERGE_REPLACE);
+  if (bvw->priv->tagcache)
+    gst_tag_list_unref (bvw->priv->tagcache);
+  bvw->priv->tagcache = result;
+
   if (cache) {
     result = gst_tag_list_merge (*cache, tag_list, GST_TAG_MERGE_REPLACE);
     if (*cache)
@@ -1771,13 +2297,17 @@ bvw_update_tags (BaconVideoWidget * bvw, GstTagList *tag_list, const gchar *type
   if (tag_list)
     gst_tag_list_unref (tag_list);
 
-  bvw_check_for_cover_pixbuf (bvw);
-
-  g_signal_emit (bvw, bvw_signals[SIGNAL_GOT_METADATA], 0);
+  /* Only decode the cover again if the image actually changed */
+  if (changed & BVW_METADATA_CHANGED_COVER) {
+    g_clear_object (&bvw->priv->cover_pixbuf);
+    bvw_check_for_cover_pixbuf (bvw);
+    set_current_actor (bvw);
+  }
 
-  update_orientation_from_video (bvw);
+  if (changed & BVW_METADATA_CHANGED_ORIENTATION)
+    update_orientation_from_video (bvw);
 
-  set_current_actor (bvw);
+  return changed;
 }
 
 static void
@@ -1790,18 +2320,21 @@ static gboolean
 bvw_update_tags_dispatcher (BaconVideoWidget *self)
 {
   UpdateTagsDelayedData *data;
+  BvwMetadataChangeFlags changed = BVW_METADATA_CHANGED_NONE;
 
   /* If we take the queue's lock for the entire function call, we can use it to protect tag_update_id too */
   g_async_queue_lock (self->priv->tag_update_queue);
 
   while ((data = g_async_queue_try_pop_unlocked (self->priv->tag_update_queue)) != NULL) {
-    bvw_update_tags (self, data->tags, data->type);
+    changed |= bvw_update_tags (self, data->tags, data->type);
     update_tags_delayed_data_destroy (data);
   }
 
   self->priv->tag_update_id = 0;
   g_async_queue_unlock (self->priv->tag_update_queue);
 
+  bvw_queue_metadata_changed (self, changed);
+
   return FALSE;
 }
 
@@ -1907,6 +2440,37 @@ bvw_download_buffering_done (BaconVideoWidget *bvw)
   return FALSE;
 }
 
+/* playbin doesn't expose the watermarks of its buffering queue, so set
+ * them on the element that reports buffering. Only the ring buffer mode
+ * uses ours, the others keep the queue's defaults */
+static void
+bvw_set_buffering_watermarks (BaconVideoWidget *bvw, GstElement *element)
+{
+  GObjectClass *klass;
+  gint low, high;
+
+  high = bvw->priv->high_watermark;
+  low = MIN (bvw->priv->low_watermark, high - 1);
+
+  klass = G_OBJECT_GET_CLASS (element);
+  if (g_object_class_find_property (klass, "high-watermark") != NULL) {
+    g_object_set (element,
+		  "low-watermark", low / 100.0,
+		  "high-watermark", high / 100.0,
+		  NULL);
+  } else if (g_object_class_find_property (klass, "high-percent") != NULL) {
+    g_object_set (element,
+		  "low-percent", low,
+		  "high-percent", high,
+		  NULL);
+  } else {
+    return;
+  }
+
+  GST_DEBUG ("Set the buffering watermarks of %s to %d%%-%d%%",
+	     GST_OBJECT_NAME (element), low, high);
+}
+
 static void
 bvw_handle_buffering_message (GstMessage * message, BaconVideoWidget *bvw)
 {
@@ -1922,10 +2486,17 @@ bvw_handle_buffering_message (GstMessage * message, BaconVideoWidget *bvw)
        GST_DEBUG ("Pausing because we're not ready to play the buffer yet");
        gst_element_set_state (GST_ELEMENT (bvw->priv->play), GST_STATE_PAUSED);
 
-       bvw_reconfigure_fill_timeout (bvw, 200);
        bvw->priv->download_buffering_element = GST_ELEMENT_CAST(g_object_ref (message->src));
+       bvw->priv->download_fill = -1;
+       if (bvw->priv->update_id == 0)
+         bvw_reconfigure_fill_timeout (bvw, DOWNLOAD_BUFFERING_INTERVAL);
      }
 
+     /* The queue tells us when its level changes, which is when the
+      * download progress is worth checking */
+     if (bvw->priv->download_buffering_element != NULL)
+       bvw_update_download_buffering (bvw);
+
      return;
    }
 
@@ -1936,8 +2507,16 @@ bvw_handle_buffering_message (GstMessage * message, BaconVideoWidget *bvw)
      g_clear_pointer (&bvw->priv->download_filename, g_free);
    }
 
-   /* Live, timeshift and stream buffering modes */
+   /* Live, timeshift and stream buffering modes. The level is relative
+    * to the high watermark, so playback starts as soon as it's reached */
+  if (bvw->priv->buffering_mode == BVW_BUFFERING_RING &&
+      bvw->priv->ring_buffering_element != GST_ELEMENT_CAST (message->src)) {
+    g_clear_object (&bvw->priv->ring_buffering_element);
+    bvw->priv->ring_buffering_element = GST_ELEMENT_CAST (g_object_ref (message->src));
+    bvw_set_buffering_watermarks (bvw, bvw->priv->ring_buffering_element);
+  }
   gst_message_parse_buffering (message, &percent);
+  bvw->priv->stats.buffer_percent = percent;
   g_signal_emit (bvw, bvw_signals[SIGNAL_BUFFERING], 0, (gdouble) percent / 100.0);
 
   if (percent >= 100) {
@@ -1979,67 +2558,416 @@ bvw_get_navigation_if_available (BaconVideoWidget *bvw)
 }
 
 static void
-bvw_bus_message_cb (GstBus * bus, GstMessage * message, BaconVideoWidget *bvw)
+bvw_reset_stats (BaconVideoWidget *bvw)
+{
+  memset (&bvw->priv->stats, 0, sizeof (BvwStats));
+  bvw->priv->stats.proportion = 1.0;
+  bvw->priv->stats.buffer_percent = -1;
+  bvw->priv->stats.input_rate = -1;
+  bvw->priv->stats.seek_latency = -1;
+  bvw->priv->stats.preroll_time = -1;
+  bvw->priv->seek_start_time = -1;
+  bvw->priv->stats_ticks = 0;
+  bacon_video_quality_reset (&bvw->priv->quality, 0, 0);
+  bvw->priv->paint_time_total = 0;
+  bvw->priv->paint_interval_max = 0;
+  bvw->priv->paint_count = 0;
+}
+
+static void
+bvw_stage_paint_started_cb (ClutterActor     *stage,
+			    BaconVideoWidget *bvw)
 {
-  GstMessageType msg_type;
+  cairo_rectangle_int_t clip;
+  gfloat width, height;
+  gint64 now;
 
-  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
+  now = g_get_monotonic_time ();
+  if (bvw->priv->last_paint_start > 0)
+    bvw->priv->paint_interval_max = MAX (bvw->priv->paint_interval_max,
+					 now - bvw->priv->last_paint_start);
+  bvw->priv->last_paint_start = now;
+  bvw->priv->paint_start = now;
 
-  msg_type = GST_MESSAGE_TYPE (message);
+  bvw->priv->stats.stage_paints++;
+  clutter_stage_get_redraw_clip_bounds (CLUTTER_STAGE (stage), &clip);
+  clutter_actor_get_size (stage, &width, &height);
+  if (clip.width < width || clip.height < height)
+    bvw->priv->stats.clipped_paints++;
+}
 
-  if (msg_type != GST_MESSAGE_STATE_CHANGED) {
-    gchar *src_name = gst_object_get_name (message->src);
-    GST_LOG ("Handling %s message from element %s",
-        gst_message_type_get_name (msg_type), src_name);
-    g_free (src_name);
-  }
+static void
+bvw_stage_paint_finished_cb (ClutterActor     *stage,
+			     BaconVideoWidget *bvw)
+{
+  if (bvw->priv->paint_start == 0)
+    return;
 
-  switch (msg_type) {
-    case GST_MESSAGE_ERROR: {
-      xplayer_gst_message_print (message, bvw->priv->play, "xplayer-error");
+  bvw->priv->paint_time_total += g_get_monotonic_time () - bvw->priv->paint_start;
+  bvw->priv->paint_count++;
+  bvw->priv->paint_start = 0;
+}
 
-      if (!bvw_check_missing_plugins_error (bvw, message) &&
-	  !bvw_check_missing_auth (bvw, message)) {
-        GError *error;
+static void
+bvw_handle_qos_message (BaconVideoWidget *bvw, GstMessage *message)
+{
+  GstFormat format;
+  gint64 jitter;
+  gdouble proportion;
 
-        error = bvw_error_from_gst_error (bvw, message);
+  /* Only the video sink counts frames, decoders and the audio
+   * sink report in other formats */
+  gst_message_parse_qos_stats (message, &format, NULL, NULL);
+  if (format != GST_FORMAT_BUFFERS ||
+      !GST_IS_BASE_SINK (GST_MESSAGE_SRC (message)))
+    return;
 
-        bvw->priv->target_state = GST_STATE_NULL;
-        if (bvw->priv->play)
-          gst_element_set_state (bvw->priv->play, GST_STATE_NULL);
+  gst_message_parse_qos_values (message, &jitter, &proportion, NULL);
 
-        bvw->priv->buffering = FALSE;
+  bvw->priv->stats.jitter = jitter;
+  bvw->priv->stats.proportion = proportion;
 
-        g_signal_emit (bvw, bvw_signals[SIGNAL_ERROR], 0,
-                       error->message, TRUE);
+  GST_LOG ("QoS: jitter %" G_GINT64_FORMAT ", proportion %f",
+	   jitter, proportion);
+}
 
-        g_error_free (error);
-      }
-      break;
-    }
-    case GST_MESSAGE_WARNING: {
-      GST_WARNING ("Warning message: %" GST_PTR_FORMAT, message);
-      break;
-    }
-    case GST_MESSAGE_TAG: 
-      /* Ignore TAG messages, we get updated tags from the
-       * {audio,video,text}-tags-changed signals of playbin2
-       */
-      break;
-    case GST_MESSAGE_EOS:
-      GST_DEBUG ("EOS message");
-      /* update slider one last time */
-      bvw_query_timeout (bvw);
-      if (bvw->priv->eos_id == 0)
-        bvw->priv->eos_id = g_idle_add (bvw_signal_eos_delayed, bvw);
-      break;
-    case GST_MESSAGE_BUFFERING:
-      bvw_handle_buffering_message (message, bvw);
-      break;
+/* The sink only posts QoS messages when it drops a frame, so read the
+ * frame counters from it rather than wait for one */
+static void
+bvw_update_frame_counters (BaconVideoWidget *bvw)
+{
+  GstElement *sink = NULL;
+  GstStructure *stats = NULL;
+  guint64 rendered, dropped;
+
+  g_object_get (bvw->priv->play, "video-sink", &sink, NULL);
+  if (sink == NULL)
+    return;
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (sink), "stats") != NULL)
+    g_object_get (sink, "stats", &stats, NULL);
+  gst_object_unref (sink);
+  if (stats == NULL)
+    return;
+
+  if (gst_structure_get_uint64 (stats, "rendered", &rendered))
+    bvw->priv->stats.rendered_frames = rendered;
+  if (gst_structure_get_uint64 (stats, "dropped", &dropped))
+    bvw->priv->stats.dropped_frames = dropped;
+  gst_structure_free (stats);
+}
+
+static guint
+bvw_get_tags_bitrate (GstTagList *tags)
+{
+  guint bitrate = 0;
+
+  if (tags == NULL)
+    return 0;
+  if (!gst_tag_list_get_uint (tags, GST_TAG_BITRATE, &bitrate))
+    gst_tag_list_get_uint (tags, GST_TAG_NOMINAL_BITRATE, &bitrate);
+
+  return bitrate;
+}
+
+static void
+bvw_update_stats_text (BaconVideoWidget *bvw)
+{
+  BvwStats *stats = &bvw->priv->stats;
+  GString *str;
+
+  str = g_string_new (NULL);
+  g_string_append_printf (str, "Frames: %" G_GUINT64_FORMAT " rendered, %" G_GUINT64_FORMAT " dropped\n",
+			  stats->rendered_frames, stats->dropped_frames);
+  g_string_append_printf (str, "QoS: proportion %.2f, jitter %.1f ms\n",
+			  stats->proportion, (gdouble) stats->jitter / GST_MSECOND);
+  g_string_append_printf (str, "Latency: %.1f ms\n",
+			  (gdouble) stats->latency / GST_MSECOND);
+  g_string_append_printf (str, "Buffer: %d%%, input %" G_GINT64_FORMAT " kB/s\n",
+			  stats->buffer_percent, stats->input_rate >= 0 ? stats->input_rate / 1024 : -1);
+  g_string_append_printf (str, "Bitrate: %u kbit/s\n", stats->bitrate / 1000);
+  g_string_append_printf (str, "Seek: %" G_GINT64_FORMAT " ms, preroll: %" G_GINT64_FORMAT " ms\n",
+			  stats->seek_latency, stats->preroll_time);
+  g_string_append_printf (str, "Paints: %" G_GUINT64_FORMAT " (%" G_GUINT64_FORMAT " clipped), %.2f ms, max interval %" G_GINT64_FORMAT " ms\n",
+			  stats->stage_paints, stats->clipped_paints,
+			  (gdouble) stats->paint_time / 1000, stats->paint_interval);
+  g_string_append_printf (str, "Quality: %s%u",
+			  bvw->priv->adaptive_quality ? "" : "fixed, ", stats->quality_level);
+
+  clutter_text_set_text (CLUTTER_TEXT (bvw->priv->stats_text), str->str);
+  g_string_free (str, TRUE);
+}
+
+/* The frame counters are always refreshed, as the adaptive quality
+ * uses them, the rest needs querying the pipeline, so only do that
+ * when somebody is looking */
+static void
+bvw_update_stats (BaconVideoWidget *bvw)
+{
+  GstQuery *query;
+
+  bvw_update_frame_counters (bvw);
+
+  /* The paints since the last refresh */
+  if (bvw->priv->paint_count > 0) {
+    bvw->priv->stats.paint_time = bvw->priv->paint_time_total / bvw->priv->paint_count;
+    bvw->priv->stats.paint_interval = bvw->priv->paint_interval_max / 1000;
+  } else {
+    /* Paused, don't count that as a late paint, nor show the
+     * figures of the last paints as current */
+    bvw->priv->stats.paint_time = 0;
+    bvw->priv->stats.paint_interval = 0;
+    bvw->priv->last_paint_start = 0;
+  }
+  bvw->priv->paint_time_total = 0;
+  bvw->priv->paint_interval_max = 0;
+  bvw->priv->paint_count = 0;
+
+  if (bvw->priv->show_stats == FALSE &&
+      !g_signal_has_handler_pending (bvw, bvw_signals[SIGNAL_STATS_UPDATED], 0, TRUE))
+    return;
+
+  query = gst_query_new_latency ();
+  if (gst_element_query (bvw->priv->play, query)) {
+    GstClockTime min_latency;
+
+    gst_query_parse_latency (query, NULL, &min_latency, NULL);
+    bvw->priv->stats.latency = min_latency;
+  }
+  gst_query_unref (query);
+
+  query = gst_query_new_buffering (GST_FORMAT_PERCENT);
+  if (gst_element_query (bvw->priv->play, query)) {
+    gint percent, avg_in;
+
+    gst_query_parse_buffering_percent (query, NULL, &percent);
+    gst_query_parse_buffering_stats (query, NULL, &avg_in, NULL, NULL);
+    bvw->priv->stats.buffer_percent = percent;
+    bvw->priv->stats.input_rate = avg_in;
+  }
+  gst_query_unref (query);
+
+  bvw->priv->stats.bitrate = bvw_get_tags_bitrate (bvw->priv->videotags) +
+    bvw_get_tags_bitrate (bvw->priv->audiotags);
+
+  if (bvw->priv->show_stats)
+    bvw_update_stats_text (bvw);
+
+  g_signal_emit (bvw, bvw_signals[SIGNAL_STATS_UPDATED], 0);
+}
+
+static void
+bvw_set_object_arg_or_default (GObject *object, const char *name, gboolean use_value, const char *value)
+{
+  GParamSpec *pspec;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (object), name);
+  if (pspec == NULL)
+    return;
+
+  if (use_value) {
+    gst_util_set_object_arg (object, name, value);
+  } else {
+    GValue default_value = G_VALUE_INIT;
+
+    g_value_init (&default_value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+    g_param_value_set_default (pspec, &default_value);
+    g_object_set_property (object, name, &default_value);
+    g_value_unset (&default_value);
+  }
+}
+
+static void
+bvw_apply_quality_level_to_element (const GValue *item, gpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  guint level = GPOINTER_TO_UINT (user_data);
+  GstElementFactory *factory;
+  const char *name;
+
+  /* Decoders which can skip non-reference frames (avdec_*) */
+  bvw_set_object_arg_or_default (G_OBJECT (element), "skip-frame",
+				 level >= QUALITY_LEVEL_SKIP_FRAMES, "1");
+
+  factory = gst_element_get_factory (element);
+  if (factory == NULL)
+    return;
+  name = gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory));
+
+  if (g_str_equal (name, "deinterlace")) {
+    bvw_set_object_arg_or_default (G_OBJECT (element), "method",
+				   level >= QUALITY_LEVEL_CHEAP_DEINTERLACE, "linear");
+  } else if (g_str_equal (name, "videoscale")) {
+    bvw_set_object_arg_or_default (G_OBJECT (element), "method",
+				   level >= QUALITY_LEVEL_FAST_SCALING, "nearest-neighbour");
+  }
+}
+
+static void
+bvw_set_quality_level (BaconVideoWidget *bvw, guint level)
+{
+  GstIterator *it;
+
+  if (bvw->priv->stats.quality_level == level)
+    return;
+
+  GST_DEBUG ("Changing quality level from %u to %u",
+	     bvw->priv->stats.quality_level, level);
+  bvw->priv->stats.quality_level = level;
+
+  it = gst_bin_iterate_recurse (GST_BIN (bvw->priv->play));
+  while (gst_iterator_foreach (it, bvw_apply_quality_level_to_element,
+			       GUINT_TO_POINTER (level)) == GST_ITERATOR_RESYNC)
+    gst_iterator_resync (it);
+  gst_iterator_free (it);
+}
+
+static void bvw_watch_element (BaconVideoWidget *bvw, GstElement *element);
+
+static void
+bvw_element_added_cb (GstBin           *bin,
+		      GstElement       *element,
+		      BaconVideoWidget *bvw)
+{
+  bvw_watch_element (bvw, element);
+}
+
+/* Applies the current quality level to @element, and to the elements
+ * added to it later on if it's a bin, as playbin creates its decoders
+ * and sinks as it goes. Called from the streaming threads, and done by
+ * hand as deep-element-added needs GStreamer 1.10 */
+static void
+bvw_watch_element (BaconVideoWidget *bvw, GstElement *element)
+{
+  guint level = bvw->priv->stats.quality_level;
+
+  if (level != QUALITY_LEVEL_FULL) {
+    GValue item = G_VALUE_INIT;
+
+    g_value_init (&item, GST_TYPE_ELEMENT);
+    g_value_set_object (&item, element);
+    bvw_apply_quality_level_to_element (&item, GUINT_TO_POINTER (level));
+    g_value_unset (&item);
+  }
+
+  if (GST_IS_BIN (element)) {
+    GstIterator *it;
+    GValue item = G_VALUE_INIT;
+    gboolean done = FALSE;
+
+    /* Once, even if the iterator below gets resynced */
+    if (g_signal_handler_find (element, G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
+			       0, 0, NULL, bvw_element_added_cb, bvw) == 0)
+      g_signal_connect_object (element, "element-added",
+			       G_CALLBACK (bvw_element_added_cb), bvw, 0);
+
+    it = gst_bin_iterate_elements (GST_BIN (element));
+    while (!done) {
+      switch (gst_iterator_next (it, &item)) {
+	case GST_ITERATOR_OK:
+	  bvw_watch_element (bvw, g_value_get_object (&item));
+	  g_value_reset (&item);
+	  break;
+	case GST_ITERATOR_RESYNC:
+	  gst_iterator_resync (it);
+	  break;
+	default:
+	  done = TRUE;
+	  break;
+      }
+    }
+    g_value_unset (&item);
+    gst_iterator_free (it);
+  }
+}
+
+/* Called every second during playback, steps the quality down when
+ * frames are dropped consistently, and back up once there's headroom */
+static void
+bvw_update_quality (BaconVideoWidget *bvw)
+{
+  guint level;
+
+  /* Frames are skipped on purpose in trick mode */
+  if (!bvw->priv->adaptive_quality || bvw->priv->trickmode) {
+    bacon_video_quality_reset (&bvw->priv->quality,
+			       bvw->priv->stats.rendered_frames,
+			       bvw->priv->stats.dropped_frames);
+    return;
+  }
+
+  level = bacon_video_quality_update (&bvw->priv->quality,
+				      bvw->priv->stats.rendered_frames,
+				      bvw->priv->stats.dropped_frames,
+				      bvw->priv->stats.quality_level,
+				      QUALITY_LEVEL_LOWEST);
+  bvw_set_quality_level (bvw, level);
+}
+
+static void
+bvw_bus_message_cb (GstBus * bus, GstMessage * message, BaconVideoWidget *bvw)
+{
+  GstMessageType msg_type;
+
+  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
+
+  msg_type = GST_MESSAGE_TYPE (message);
+
+  if (msg_type != GST_MESSAGE_STATE_CHANGED) {
+    gchar *src_name = gst_object_get_name (message->src);
+    GST_LOG ("Handling %s message from element %s",
+        gst_message_type_get_name (msg_type), src_name);
+    g_free (src_name);
+  }
+
+  switch (msg_type) {
+    case GST_MESSAGE_ERROR: {
+      xplayer_gst_message_print (message, bvw->priv->play, "xplayer-error");
+
+      if (!bvw_check_missing_plugins_error (bvw, message) &&
+	  !bvw_check_missing_auth (bvw, message)) {
+        GError *error;
+
+        error = bvw_error_from_gst_error (bvw, message);
+
+        bvw->priv->target_state = GST_STATE_NULL;
+        if (bvw->priv->play)
+          gst_element_set_state (bvw->priv->play, GST_STATE_NULL);
+
+        bvw->priv->buffering = FALSE;
+
+        g_signal_emit (bvw, bvw_signals[SIGNAL_ERROR], 0,
+                       error->message, TRUE);
+
+        g_error_free (error);
+      }
+      break;
+    }
+    case GST_MESSAGE_WARNING: {
+      GST_WARNING ("Warning message: %" GST_PTR_FORMAT, message);
+      break;
+    }
+    case GST_MESSAGE_TAG: 
+      /* Ignore TAG messages, we get updated tags from the
+       * {audio,video,text}-tags-changed signals of playbin2
+       */
+      break;
+    case GST_MESSAGE_EOS:
+      GST_DEBUG ("EOS message");
+      /* update slider one last time */
+      bvw_query_timeout (bvw);
+      if (bvw->priv->eos_id == 0)
+        bvw->priv->eos_id = g_idle_add (bvw_signal_eos_delayed, bvw);
+      break;
+    case GST_MESSAGE_BUFFERING:
+      bvw_handle_buffering_message (message, bvw);
+      break;
     case GST_MESSAGE_APPLICATION: {
       bvw_handle_application_message (bvw, message);
       break;
     }
+    case GST_MESSAGE_QOS:
+      bvw_handle_qos_message (bvw, message);
+      break;
     case GST_MESSAGE_STATE_CHANGED: {
       GstState old_state, new_state;
       gchar *src_name;
@@ -2068,14 +2996,23 @@ bvw_bus_message_cb (GstBus * bus, GstMessage * message, BaconVideoWidget *bvw)
       if (new_state <= GST_STATE_PAUSED) {
         bvw_query_timeout (bvw);
         bvw_reconfigure_tick_timeout (bvw, 0);
+        /* Keep following the download while the ticks are stopped */
+        if (new_state == GST_STATE_PAUSED && bvw->priv->download_buffering_element != NULL)
+          bvw_reconfigure_fill_timeout (bvw, DOWNLOAD_BUFFERING_INTERVAL);
       } else if (new_state > GST_STATE_PAUSED) {
         bvw_reconfigure_tick_timeout (bvw, 200);
+        bvw_reconfigure_fill_timeout (bvw, 0);
       }
 
       if (old_state == GST_STATE_READY && new_state == GST_STATE_PAUSED) {
         GST_DEBUG_BIN_TO_DOT_FILE (GST_BIN_CAST (bvw->priv->play),
             GST_DEBUG_GRAPH_SHOW_ALL ^ GST_DEBUG_GRAPH_SHOW_NON_DEFAULT_PARAMS,
             "xplayer-prerolled");
+        if (bvw->priv->open_time >= 0) {
+          bvw->priv->stats.preroll_time = (g_get_monotonic_time () - bvw->priv->open_time) / 1000;
+          bvw->priv->open_time = -1;
+          GST_DEBUG ("Prerolled %" G_GINT64_FORMAT " ms after opening", bvw->priv->stats.preroll_time);
+        }
 	bacon_video_widget_get_stream_length (bvw);
         bvw_update_stream_info (bvw);
         if (!bvw_check_missing_plugins_on_preroll (bvw)) {
@@ -2091,6 +3028,7 @@ bvw_bus_message_cb (GstBus * bus, GstMessage * message, BaconVideoWidget *bvw)
         bvw->priv->media_has_audio = FALSE;
 
         /* clean metadata cache */
+	bvw_cancel_metadata_update (bvw);
 	g_clear_pointer (&bvw->priv->tagcache, gst_tag_list_unref);
 	g_clear_pointer (&bvw->priv->audiotags, gst_tag_list_unref);
 	g_clear_pointer (&bvw->priv->videotags, gst_tag_list_unref);
@@ -2125,6 +3063,15 @@ bvw_bus_message_cb (GstBus * bus, GstMessage * message, BaconVideoWidget *bvw)
 
 	g_mutex_unlock (&bvw->priv->seek_mutex);
 
+	if (bvw->priv->seek_start_time >= 0) {
+	  if (xplayer_trace_is_enabled ())
+	    xplayer_trace_add ("seek", bvw->priv->seek_start_time, g_get_monotonic_time (), "%s", "");
+	  bvw->priv->stats.seek_latency = (g_get_monotonic_time () - bvw->priv->seek_start_time) / 1000;
+	  bvw->priv->seek_start_time = -1;
+	  GST_DEBUG ("Seek done in %" G_GINT64_FORMAT " ms", bvw->priv->stats.seek_latency);
+	  bvw_update_stats (bvw);
+	}
+
 	if (_time >= 0) {
 	  GST_DEBUG ("Have an old seek to schedule, doing it now");
 	  bacon_video_widget_seek_time_no_lock (bvw, _time, 0, NULL);
@@ -2159,7 +3106,6 @@ bvw_bus_message_cb (GstBus * bus, GstMessage * message, BaconVideoWidget *bvw)
     case GST_MESSAGE_ASYNC_START:
     case GST_MESSAGE_REQUEST_STATE:
     case GST_MESSAGE_STEP_START:
-    case GST_MESSAGE_QOS:
     case GST_MESSAGE_PROGRESS:
     case GST_MESSAGE_ANY:
     case GST_MESSAGE_RESET_TIME:
@@ -2196,6 +3142,9 @@ got_time_tick (GstElement * play, gint64 time_nanos, BaconVideoWidget * bvw)
 
   bvw->priv->is_live = (bvw->priv->stream_length == 0);
 
+  if (bvw->priv->subtitles != NULL)
+    bvw_update_subtitle_text (bvw, bvw->priv->current_time);
+
 /*
   GST_DEBUG ("current time: %" GST_TIME_FORMAT ", stream length: %" GST_TIME_FORMAT ", seekable: %s",
       GST_TIME_ARGS (bvw->priv->current_time * GST_MSECOND),
@@ -2355,6 +3304,43 @@ bvw_set_referrer_on_element (BaconVideoWidget * bvw, GstElement * element)
   gst_structure_free (extra_headers);
 }
 
+static void
+bvw_set_http_options_on_element (BaconVideoWidget * bvw, GstElement * element)
+{
+  GstElementFactory *factory;
+  gchar *proxy = NULL;
+  gboolean shared_session;
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (element), "keep-alive") == NULL)
+    return;
+
+  /* Keep the connections open, so that the next item from the same
+   * server doesn't need a new one */
+  g_object_set (element,
+		"keep-alive", TRUE,
+		"blocksize", HTTP_BLOCKSIZE,
+		NULL);
+
+  /* From 1.14, souphttpsrc shares its session, and so its open
+   * connections, through the pipeline's context, which playbin keeps
+   * from one stream to the next. It only does so when the timeout and
+   * the proxy are left alone, so the shorter timeout is only worth it
+   * when the session wouldn't be shared anyway. */
+  factory = gst_element_get_factory (element);
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (element), "proxy") != NULL)
+    g_object_get (element, "proxy", &proxy, NULL);
+  shared_session = (proxy == NULL &&
+		    factory != NULL &&
+		    g_str_equal (GST_OBJECT_NAME (factory), "souphttpsrc") &&
+		    gst_plugin_feature_check_version (GST_PLUGIN_FEATURE (factory), 1, 14, 0));
+  g_free (proxy);
+
+  GST_DEBUG ("%s the HTTP session", shared_session ? "Sharing" : "Not sharing");
+  if (!shared_session &&
+      g_object_class_find_property (G_OBJECT_GET_CLASS (element), "timeout") != NULL)
+    g_object_set (element, "timeout", HTTP_TIMEOUT, NULL);
+}
+
 static void
 playbin_source_setup_cb (GstElement       *playbin,
 			 GstElement       *source,
@@ -2365,6 +3351,8 @@ playbin_source_setup_cb (GstElement       *playbin,
   bvw_set_referrer_on_element (bvw, source);
   bvw_set_auth_on_element (bvw, source);
   bvw_set_proxy_on_element (bvw, source);
+  /* After the proxy, which stops the session from being shared */
+  bvw_set_http_options_on_element (bvw, source);
 }
 
 static void
@@ -2396,82 +3384,87 @@ bvw_query_timeout (BaconVideoWidget *bvw)
     GST_DEBUG ("could not get position");
   }
 
+  if (++bvw->priv->stats_ticks >= STATS_UPDATE_TICKS) {
+    bvw->priv->stats_ticks = 0;
+    if (bvw->priv->download_buffering_element != NULL)
+      bvw_update_download_buffering (bvw);
+    bvw_update_stats (bvw);
+    bvw_update_quality (bvw);
+  }
+
   return TRUE;
 }
 
-static gboolean
-bvw_query_buffering_timeout (BaconVideoWidget *bvw)
+/* Queries how much of the stream has been downloaded, tells the front-end
+ * when that changed, and starts playback once there's enough */
+static void
+bvw_update_download_buffering (BaconVideoWidget *bvw)
 {
   GstQuery *query;
-  GstElement *element;
-
-  element = bvw->priv->download_buffering_element;
-  if (element == NULL)
-    element = bvw->priv->play;
+  gint64 start, stop;
+  GstFormat format;
+  gdouble fill;
+  gint download_fill;
 
   query = gst_query_new_buffering (GST_FORMAT_PERCENT);
-  if (gst_element_query (element, query)) {
-    gint64 start, stop;
-    GstFormat format;
-    gdouble fill;
-    gboolean busy;
-    gint percent;
-
-    gst_query_parse_buffering_stats (query, NULL, NULL, NULL, &bvw->priv->buffering_left);
-    gst_query_parse_buffering_percent (query, &busy, &percent);
-    gst_query_parse_buffering_range (query, &format, &start, &stop, NULL);
-
-    GST_DEBUG ("start %" G_GINT64_FORMAT ", stop %" G_GINT64_FORMAT
-	       ", buffering left %" G_GINT64_FORMAT ", percent %d%%",
-	       start, stop, bvw->priv->buffering_left, percent);
-
-#if 0
-    guint i;
-    for (i = 0; i < n_ranges; i++) {
-      gint64 n_start, n_stop;
-      gst_query_parse_nth_buffering_range (query, i, &n_start, &n_stop);
-      GST_DEBUG ("%s range %d: start %" G_GINT64_FORMAT " stop %" G_GINT64_FORMAT,
-		 n_stop == stop ? "*" : " ",
-		 i, n_start, n_stop);
-    }
-#endif
+  if (!gst_element_query (bvw->priv->download_buffering_element, query)) {
+    GST_DEBUG ("Failed to query the source element for buffering info in percent");
+    gst_query_unref (query);
+    return;
+  }
 
-    if (stop != -1)
-      fill = (gdouble) stop / GST_FORMAT_PERCENT_MAX;
-    else
-      fill = -1.0;
+  gst_query_parse_buffering_stats (query, NULL, NULL, NULL, &bvw->priv->buffering_left);
+  gst_query_parse_buffering_range (query, &format, &start, &stop, NULL);
+  gst_query_unref (query);
 
-    GST_DEBUG ("download buffer filled up to %f%% (element: %s)", fill * 100.0,
-	       G_OBJECT_TYPE_NAME (element));
+  GST_LOG ("start %" G_GINT64_FORMAT ", stop %" G_GINT64_FORMAT
+	   ", buffering left %" G_GINT64_FORMAT,
+	   start, stop, bvw->priv->buffering_left);
+
+  if (stop != -1)
+    fill = (gdouble) stop / GST_FORMAT_PERCENT_MAX;
+  else
+    fill = -1.0;
 
+  /* Only bother the front-end when the fill level visibly changed */
+  download_fill = fill < 0.0 ? -1 : (gint) (fill * 1000.0);
+  if (download_fill != bvw->priv->download_fill) {
+    bvw->priv->download_fill = download_fill;
+    GST_DEBUG ("download buffer filled up to %f%%", fill * 100.0);
     g_signal_emit (bvw, bvw_signals[SIGNAL_DOWNLOAD_BUFFERING], 0, fill);
+  }
 
-    /* Nothing left to buffer when fill is 100% */
-    if (fill == 1.0)
-      bvw->priv->buffering_left = 0;
+  /* Nothing left to buffer when fill is 100% */
+  if (fill == 1.0)
+    bvw->priv->buffering_left = 0;
 
-    /* Start playing when we've downloaded enough */
-    if (bvw_download_buffering_done (bvw) != FALSE &&
-	bvw->priv->target_state == GST_STATE_PLAYING) {
-      GST_DEBUG ("Starting playback because the download buffer is filled enough");
-      bacon_video_widget_play (bvw, NULL);
-    }
+  /* Start playing when we've downloaded enough */
+  if (bvw_download_buffering_done (bvw) != FALSE &&
+      bvw->priv->target_state == GST_STATE_PLAYING) {
+    GST_DEBUG ("Starting playback because the download buffer is filled enough");
+    bacon_video_widget_play (bvw, NULL);
+  }
 
-    /* Finished buffering, so don't run the timeout anymore */
-    if (fill == 1.0) {
-      bvw->priv->fill_id = 0;
-      gst_query_unref (query);
-      g_clear_object (&bvw->priv->download_buffering_element);
+  /* Finished buffering, so stop following the download */
+  if (fill == 1.0) {
+    bvw_reconfigure_fill_timeout (bvw, 0);
+    g_clear_object (&bvw->priv->download_buffering_element);
 
-      /* Tell the front-end about the downloaded file */
-      g_object_notify (G_OBJECT (bvw), "download-filename");
+    /* Tell the front-end about the downloaded file */
+    g_object_notify (G_OBJECT (bvw), "download-filename");
+  }
+}
 
-      return FALSE;
-    }
-  } else {
-    g_debug ("Failed to query the source element for buffering info in percent");
+/* Only runs while paused, as the ticks check the download otherwise */
+static gboolean
+bvw_download_buffering_timeout (BaconVideoWidget *bvw)
+{
+  bvw_update_download_buffering (bvw);
+
+  if (bvw->priv->download_buffering_element == NULL) {
+    bvw->priv->fill_id = 0;
+    return FALSE;
   }
-  gst_query_unref (query);
 
   return TRUE;
 }
@@ -2605,14 +3598,39 @@ bacon_video_widget_finalize (GObject * object)
   g_clear_pointer (&bvw->priv->referrer, g_free);
   g_clear_pointer (&bvw->priv->mrl, g_free);
   g_clear_pointer (&bvw->priv->subtitle_uri, g_free);
+  g_clear_pointer (&bvw->priv->subtitle_font, g_free);
+
+  if (bvw->priv->subtitles_cancellable)
+    g_cancellable_cancel (bvw->priv->subtitles_cancellable);
+  g_clear_object (&bvw->priv->subtitles_cancellable);
+  g_clear_pointer (&bvw->priv->subtitles, bacon_video_subtitles_unref);
+
+  if (bvw->priv->subtitle_update_id != 0) {
+    g_source_remove (bvw->priv->subtitle_update_id);
+    bvw->priv->subtitle_update_id = 0;
+  }
+
+  if (bvw->priv->loudness_cancellable)
+    g_cancellable_cancel (bvw->priv->loudness_cancellable);
+  g_clear_object (&bvw->priv->loudness_cancellable);
 
   g_clear_object (&bvw->priv->clock);
+  g_clear_object (&bvw->priv->logo_frame);
 
   if (bvw->priv->play != NULL)
     gst_element_set_state (bvw->priv->play, GST_STATE_NULL);
 
   g_clear_object (&bvw->priv->play);
 
+  /* Not in playbin anymore, or never were */
+  if (bvw->priv->passthrough_bin != NULL)
+    gst_element_set_state (bvw->priv->passthrough_bin, GST_STATE_NULL);
+  g_clear_pointer (&bvw->priv->passthrough_bin, gst_object_unref);
+  if (bvw->priv->audio_bin != NULL)
+    gst_element_set_state (bvw->priv->audio_bin, GST_STATE_NULL);
+  g_clear_pointer (&bvw->priv->audio_bin, gst_object_unref);
+  g_clear_pointer (&bvw->priv->audio_pitchcontrol, gst_object_unref);
+
   if (bvw->priv->update_id) {
     g_source_remove (bvw->priv->update_id);
     bvw->priv->update_id = 0;
@@ -2626,6 +3644,8 @@ bacon_video_widget_finalize (GObject * object)
     g_source_remove (bvw->priv->tag_update_id);
   g_async_queue_unref (bvw->priv->tag_update_queue);
 
+  bvw_cancel_metadata_update (bvw);
+
   if (bvw->priv->eos_id != 0) {
     g_source_remove (bvw->priv->eos_id);
     bvw->priv->eos_id = 0;
@@ -2660,6 +3680,36 @@ bacon_video_widget_set_property (GObject * object, guint property_id,
     case PROP_SHOW_CURSOR:
       bacon_video_widget_set_show_cursor (bvw, g_value_get_boolean (value));
       break;
+    case PROP_SHOW_STATS:
+      bacon_video_widget_set_show_stats (bvw, g_value_get_boolean (value));
+      break;
+    case PROP_ADAPTIVE_QUALITY:
+      bacon_video_widget_set_adaptive_quality (bvw, g_value_get_boolean (value));
+      break;
+    case PROP_BUFFERING_MODE:
+      bacon_video_widget_set_buffering_mode (bvw, g_value_get_enum (value));
+      break;
+    case PROP_RING_BUFFER_SIZE:
+      bvw->priv->ring_buffer_size = g_value_get_uint64 (value);
+      bvw_configure_buffering (bvw);
+      break;
+    case PROP_BUFFER_DURATION:
+      bvw->priv->buffer_duration = g_value_get_double (value);
+      bvw_configure_buffering (bvw);
+      break;
+    case PROP_LOW_WATERMARK:
+      bvw->priv->low_watermark = g_value_get_int (value);
+      if (bvw->priv->ring_buffering_element != NULL)
+        bvw_set_buffering_watermarks (bvw, bvw->priv->ring_buffering_element);
+      break;
+    case PROP_HIGH_WATERMARK:
+      bvw->priv->high_watermark = g_value_get_int (value);
+      if (bvw->priv->ring_buffering_element != NULL)
+        bvw_set_buffering_watermarks (bvw, bvw->priv->ring_buffering_element);
+      break;
+    case PROP_LOUDNESS_NORMALIZATION:
+      bacon_video_widget_set_loudness_normalization (bvw, g_value_get_boolean (value));
+      break;
     case PROP_USER_AGENT:
       bacon_video_widget_set_user_agent (bvw, g_value_get_string (value));
       break;
@@ -2726,6 +3776,30 @@ bacon_video_widget_get_property (GObject * object, guint property_id,
     case PROP_SHOW_CURSOR:
       g_value_set_boolean (value, bacon_video_widget_get_show_cursor (bvw));
       break;
+    case PROP_SHOW_STATS:
+      g_value_set_boolean (value, bvw->priv->show_stats);
+      break;
+    case PROP_ADAPTIVE_QUALITY:
+      g_value_set_boolean (value, bvw->priv->adaptive_quality);
+      break;
+    case PROP_BUFFERING_MODE:
+      g_value_set_enum (value, bvw->priv->buffering_mode);
+      break;
+    case PROP_RING_BUFFER_SIZE:
+      g_value_set_uint64 (value, bvw->priv->ring_buffer_size);
+      break;
+    case PROP_BUFFER_DURATION:
+      g_value_set_double (value, bvw->priv->buffer_duration);
+      break;
+    case PROP_LOW_WATERMARK:
+      g_value_set_int (value, bvw->priv->low_watermark);
+      break;
+    case PROP_HIGH_WATERMARK:
+      g_value_set_int (value, bvw->priv->high_watermark);
+      break;
+    case PROP_LOUDNESS_NORMALIZATION:
+      g_value_set_boolean (value, bvw->priv->loudness_normalization);
+      break;
     case PROP_USER_AGENT:
       g_value_set_string (value, bvw->priv->user_agent);
       break;
@@ -2780,6 +3854,9 @@ bacon_video_widget_get_property (GObject * object, guint property_id,
  * If the widget is not playing, <code class="literal">-2</code> will be returned. If no subtitles are
  * being used, <code class="literal">-1</code> is returned.
  *
+ * The external subtitles set with bacon_video_widget_set_text_subtitle()
+ * come after the subtitles embedded in the stream.
+ *
  * Return value: the subtitle index
  **/
 int
@@ -2791,6 +3868,11 @@ bacon_video_widget_get_subtitle (BaconVideoWidget * bvw)
   g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), -2);
   g_return_val_if_fail (bvw->priv->play != NULL, -2);
 
+  if (bvw->priv->subtitles != NULL && bvw->priv->show_subtitles) {
+    g_object_get (bvw->priv->play, "n-text", &subtitle, NULL);
+    return subtitle;
+  }
+
   g_object_get (bvw->priv->play, "flags", &flags, NULL);
 
   if ((flags & GST_PLAY_FLAG_TEXT) == 0)
@@ -2813,12 +3895,22 @@ void
 bacon_video_widget_set_subtitle (BaconVideoWidget * bvw, int subtitle)
 {
   GstTagList *tags;
-  gint flags;
+  gint flags, n_text;
 
   g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
   g_return_if_fail (bvw->priv->play != NULL);
 
-  g_object_get (bvw->priv->play, "flags", &flags, NULL);
+  g_object_get (bvw->priv->play, "flags", &flags, "n-text", &n_text, NULL);
+
+  /* The external subtitles are drawn by us, without any pipeline change */
+  bvw->priv->show_subtitles = (bvw->priv->subtitles != NULL && subtitle == n_text);
+  bvw_update_subtitle_text (bvw, bvw->priv->current_time);
+
+  if (bvw->priv->show_subtitles) {
+    flags &= ~GST_PLAY_FLAG_TEXT;
+    g_object_set (bvw->priv->play, "flags", flags, NULL);
+    return;
+  }
 
   if (subtitle == -1) {
     flags &= ~GST_PLAY_FLAG_TEXT;
@@ -2832,7 +3924,7 @@ bacon_video_widget_set_subtitle (BaconVideoWidget * bvw, int subtitle)
     g_object_get (bvw->priv->play, "current-text", &subtitle, NULL);
 
     g_signal_emit_by_name (G_OBJECT (bvw->priv->play), "get-text-tags", subtitle, &tags);
-    bvw_update_tags (bvw, tags, "text");
+    bvw_queue_metadata_changed (bvw, bvw_update_tags (bvw, tags, "text"));
   }
 }
 
@@ -2968,6 +4060,17 @@ bacon_video_widget_get_subtitles (BaconVideoWidget * bvw)
 
   list = get_lang_list_for_type (bvw, "TEXT");
 
+  if (bvw->priv->subtitles != NULL) {
+    GFile *file;
+    char *basename;
+
+    file = g_file_new_for_uri (bvw->priv->subtitle_uri);
+    basename = g_file_get_basename (file);
+    list = g_list_append (list, g_filename_display_name (basename));
+    g_free (basename);
+    g_object_unref (file);
+  }
+
   return list;
 }
 
@@ -3028,6 +4131,8 @@ void
 bacon_video_widget_set_language (BaconVideoWidget * bvw, int language)
 {
   GstTagList *tags;
+  BvwMetadataChangeFlags changed;
+  gboolean had_replaygain;
 
   g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
   g_return_if_fail (bvw->priv->play != NULL);
@@ -3039,11 +4144,20 @@ bacon_video_widget_set_language (BaconVideoWidget * bvw, int language)
   g_object_get (bvw->priv->play, "current-audio", &language, NULL);
   GST_DEBUG ("current-audio now: %d", language);
 
+  /* The gain from the previous stream's ReplayGain tags doesn't apply
+   * to this one, fall back to measuring the file if it has none */
+  had_replaygain = bvw->priv->has_replaygain;
+  if (had_replaygain)
+    bvw_reset_loudness (bvw);
+
   g_signal_emit_by_name (G_OBJECT (bvw->priv->play), "get-audio-tags", language, &tags);
-  bvw_update_tags (bvw, tags, "audio");
+  changed = bvw_update_tags (bvw, tags, "audio");
+
+  if (had_replaygain && !bvw->priv->has_replaygain)
+    bvw_lookup_loudness (bvw);
 
   /* so it updates its metadata for the newly-selected stream */
-  g_signal_emit (bvw, bvw_signals[SIGNAL_GOT_METADATA], 0, NULL);
+  bvw_emit_metadata_changed (bvw, changed | BVW_METADATA_CHANGED_STREAM_INFO);
   g_signal_emit (bvw, bvw_signals[SIGNAL_CHANNELS_CHANGE], 0);
 }
 
@@ -3094,33 +4208,382 @@ bacon_video_widget_get_deinterlacing (BaconVideoWidget * bvw)
   return !!(flags & GST_PLAY_FLAG_DEINTERLACE);
 }
 
-static gint
-get_num_audio_channels (BaconVideoWidget * bvw)
+/**
+ * bacon_video_widget_set_adaptive_quality:
+ * @bvw: a #BaconVideoWidget
+ * @adaptive_quality: %TRUE to lower the quality when frames keep being dropped
+ *
+ * Sets whether @bvw should degrade the video quality when the machine cannot
+ * keep up with decoding and rendering the stream. It will successively switch
+ * to a cheaper deinterlacing method and a cheaper scaling method, and skip
+ * non-reference frames, and go back to full quality once frames stop being
+ * dropped.
+ **/
+void
+bacon_video_widget_set_adaptive_quality (BaconVideoWidget *bvw,
+					 gboolean          adaptive_quality)
 {
-  gint channels;
+  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
 
-  switch (bvw->priv->speakersetup) {
-    case BVW_AUDIO_SOUND_STEREO:
-      channels = 2;
-      break;
-    case BVW_AUDIO_SOUND_4CHANNEL:
-      channels = 4;
-      break;
-    case BVW_AUDIO_SOUND_5CHANNEL:
-      channels = 5;
-      break;
-    case BVW_AUDIO_SOUND_41CHANNEL:
-      /* so alsa has this as 5.1, but empty center speaker. We don't really
-       * do that yet. ;-). So we'll take the placebo approach. */
-    case BVW_AUDIO_SOUND_51CHANNEL:
-      channels = 6;
-      break;
-    case BVW_AUDIO_SOUND_AC3PASSTHRU:
-    default:
-      g_return_val_if_reached (-1);
-  }
+  adaptive_quality = (adaptive_quality != FALSE);
+  if (bvw->priv->adaptive_quality == adaptive_quality)
+    return;
 
-  return channels;
+  bvw->priv->adaptive_quality = adaptive_quality;
+  if (adaptive_quality == FALSE)
+    bvw_set_quality_level (bvw, QUALITY_LEVEL_FULL);
+
+  g_object_notify (G_OBJECT (bvw), "adaptive-quality");
+}
+
+/**
+ * bacon_video_widget_get_adaptive_quality:
+ * @bvw: a #BaconVideoWidget
+ *
+ * Returns whether @bvw lowers the video quality when frames keep being dropped.
+ *
+ * Return value: %TRUE if adaptive quality is enabled, %FALSE otherwise
+ **/
+gboolean
+bacon_video_widget_get_adaptive_quality (BaconVideoWidget *bvw)
+{
+  g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), FALSE);
+
+  return bvw->priv->adaptive_quality;
+}
+
+static void
+bvw_configure_buffering (BaconVideoWidget *bvw)
+{
+  gint flags;
+
+  if (bvw->priv->play == NULL)
+    return;
+
+  g_object_get (bvw->priv->play, "flags", &flags, NULL);
+  if (bvw->priv->buffering_mode == BVW_BUFFERING_RING) {
+    /* Without the download flag, the buffering queue keeps the stream
+     * in a ring buffer in memory, rather than in a temporary file */
+    flags &= ~GST_PLAY_FLAG_DOWNLOAD;
+    g_object_set (bvw->priv->play, "ring-buffer-max-size", bvw->priv->ring_buffer_size, NULL);
+  } else {
+    flags |= GST_PLAY_FLAG_DOWNLOAD;
+    g_object_set (bvw->priv->play, "ring-buffer-max-size", (guint64) 0, NULL);
+  }
+  g_object_set (bvw->priv->play,
+		"flags", flags,
+		"buffer-duration", (gint64) (bvw->priv->buffer_duration * GST_SECOND),
+		NULL);
+}
+
+/**
+ * bacon_video_widget_set_buffering_mode:
+ * @bvw: a #BaconVideoWidget
+ * @mode: a #BvwBufferingMode
+ *
+ * Sets how network streams are buffered. %BVW_BUFFERING_DOWNLOAD downloads
+ * streams that can be downloaded to a temporary file, and waits until the
+ * download is expected to stay ahead of playback before starting it.
+ * %BVW_BUFFERING_RING keeps streams in a ring buffer of
+ * #BaconVideoWidget:ring-buffer-size bytes of memory, and starts playback
+ * as soon as #BaconVideoWidget:high-watermark is reached, which suits long
+ * or endless streams.
+ *
+ * The mode is used for the streams opened after the call.
+ **/
+void
+bacon_video_widget_set_buffering_mode (BaconVideoWidget *bvw,
+				       BvwBufferingMode  mode)
+{
+  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
+
+  if (bvw->priv->buffering_mode == mode)
+    return;
+
+  bvw->priv->buffering_mode = mode;
+  bvw_configure_buffering (bvw);
+
+  g_object_notify (G_OBJECT (bvw), "buffering-mode");
+}
+
+/**
+ * bacon_video_widget_get_buffering_mode:
+ * @bvw: a #BaconVideoWidget
+ *
+ * Returns how network streams are buffered.
+ *
+ * Return value: the buffering mode
+ **/
+BvwBufferingMode
+bacon_video_widget_get_buffering_mode (BaconVideoWidget *bvw)
+{
+  g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), BVW_BUFFERING_DOWNLOAD);
+
+  return bvw->priv->buffering_mode;
+}
+
+static void
+bvw_loudness_analyzed_cb (GObject      *source_object,
+			  GAsyncResult *result,
+			  gpointer      user_data)
+{
+  BaconVideoLoudness loudness;
+  GError *error = NULL;
+
+  /* The gain is only used the next time the file is opened, rather than
+   * jumping in the middle of playback, so the widget isn't needed */
+  if (!bacon_video_loudness_analyze_finish (result, &loudness, &error)) {
+    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      GST_DEBUG ("Couldn't measure the loudness: %s", error->message);
+    g_error_free (error);
+    return;
+  }
+
+  GST_DEBUG ("Measured a loudness of %.1f LUFS, with a peak of %.3f",
+	     loudness.loudness, loudness.peak);
+}
+
+static void
+bvw_loudness_lookup_cb (GObject          *source_object,
+			GAsyncResult     *result,
+			BaconVideoWidget *bvw)
+{
+  BaconVideoLoudness loudness;
+  GError *error = NULL;
+
+  if (!bacon_video_loudness_lookup_finish (result, &loudness, &error)) {
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      /* The widget might be gone already */
+      g_error_free (error);
+      return;
+    }
+
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+	!bvw->priv->has_replaygain) {
+      GST_DEBUG ("Measuring the loudness of '%s' in the background", bvw->priv->mrl);
+      bacon_video_loudness_analyze_async (G_FILE (source_object),
+					  bvw->priv->loudness_cancellable,
+					  bvw_loudness_analyzed_cb, NULL);
+    } else {
+      GST_DEBUG ("Couldn't look up the loudness: %s", error->message);
+    }
+    g_error_free (error);
+    return;
+  }
+
+  if (bvw->priv->has_replaygain == FALSE)
+    bvw_set_audio_gain (bvw, bacon_video_loudness_get_gain (&loudness));
+}
+
+static void
+bvw_lookup_loudness (BaconVideoWidget *bvw)
+{
+  GFile *file;
+
+  if (!bvw->priv->loudness_normalization || bvw->priv->mrl == NULL)
+    return;
+
+  /* Measuring network streams would mean downloading them twice */
+  file = g_file_new_for_uri (bvw->priv->mrl);
+  if (g_file_is_native (file)) {
+    bvw->priv->loudness_cancellable = g_cancellable_new ();
+    bacon_video_loudness_lookup_async (file, bvw->priv->loudness_cancellable,
+				       (GAsyncReadyCallback) bvw_loudness_lookup_cb, bvw);
+  }
+  g_object_unref (file);
+}
+
+static void
+bvw_reset_loudness (BaconVideoWidget *bvw)
+{
+  if (bvw->priv->loudness_cancellable)
+    g_cancellable_cancel (bvw->priv->loudness_cancellable);
+  g_clear_object (&bvw->priv->loudness_cancellable);
+  bvw->priv->has_replaygain = FALSE;
+  bvw_set_audio_gain (bvw, 1.0);
+}
+
+/**
+ * bacon_video_widget_set_loudness_normalization:
+ * @bvw: a #BaconVideoWidget
+ * @normalize: %TRUE to bring all streams to the same loudness
+ *
+ * Sets whether @bvw adjusts the volume of each stream so that they all
+ * sound as loud. The gain comes from the ReplayGain tags of the stream if
+ * it has some. Otherwise, local files get their loudness measured in the
+ * background the first time they're opened, and the measurement is
+ * used, without any delay, the next times.
+ **/
+void
+bacon_video_widget_set_loudness_normalization (BaconVideoWidget *bvw,
+					       gboolean          normalize)
+{
+  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
+
+  normalize = (normalize != FALSE);
+  if (bvw->priv->loudness_normalization == normalize)
+    return;
+
+  bvw->priv->loudness_normalization = normalize;
+  bvw_reset_loudness (bvw);
+  if (normalize) {
+    bvw_update_replaygain (bvw);
+    if (bvw->priv->has_replaygain == FALSE)
+      bvw_lookup_loudness (bvw);
+  }
+
+  g_object_notify (G_OBJECT (bvw), "loudness-normalization");
+}
+
+/**
+ * bacon_video_widget_get_loudness_normalization:
+ * @bvw: a #BaconVideoWidget
+ *
+ * Returns whether @bvw brings all streams to the same loudness.
+ *
+ * Return value: %TRUE if loudness normalisation is enabled, %FALSE otherwise
+ **/
+gboolean
+bacon_video_widget_get_loudness_normalization (BaconVideoWidget *bvw)
+{
+  g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), FALSE);
+
+  return bvw->priv->loudness_normalization;
+}
+
+/* What each audio device accepts, keyed by sink and device, so that
+ * devices are only probed once */
+static GHashTable *audio_profiles = NULL;
+G_LOCK_DEFINE_STATIC (audio_profiles);
+
+static GstElement *
+bvw_get_actual_audio_sink (GstElement *sink)
+{
+  GstIterator *iter;
+  GValue item = G_VALUE_INIT;
+  GstElement *child = NULL;
+
+  /* autoaudiosink only picks the actual sink in READY */
+  if (!GST_IS_BIN (sink))
+    return gst_object_ref (sink);
+
+  iter = gst_bin_iterate_sinks (GST_BIN (sink));
+  if (gst_iterator_next (iter, &item) == GST_ITERATOR_OK) {
+    child = g_value_dup_object (&item);
+    g_value_unset (&item);
+  }
+  gst_iterator_free (iter);
+
+  return child;
+}
+
+static GstCaps *
+bvw_get_audio_profile (GstElement *sink)
+{
+  GstElement *actual_sink;
+  GstElementFactory *factory;
+  GstCaps *caps;
+  GstPad *pad;
+  char *device = NULL, *key;
+
+  if (GST_STATE (sink) < GST_STATE_READY &&
+      gst_element_set_state (sink, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+    return NULL;
+
+  actual_sink = bvw_get_actual_audio_sink (sink);
+  if (actual_sink == NULL)
+    return NULL;
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (actual_sink), "device"))
+    g_object_get (actual_sink, "device", &device, NULL);
+  factory = gst_element_get_factory (actual_sink);
+  key = g_strdup_printf ("%s:%s",
+			 factory ? GST_OBJECT_NAME (factory) : G_OBJECT_TYPE_NAME (actual_sink),
+			 device ? device : "");
+  g_free (device);
+
+  /* Also probed from the thread of bacon_video_widget_preload() */
+  G_LOCK (audio_profiles);
+  if (audio_profiles == NULL)
+    audio_profiles = g_hash_table_new_full (g_str_hash, g_str_equal,
+					    g_free, (GDestroyNotify) gst_caps_unref);
+
+  caps = g_hash_table_lookup (audio_profiles, key);
+  if (caps != NULL) {
+    gst_caps_ref (caps);
+    G_UNLOCK (audio_profiles);
+    g_free (key);
+    gst_object_unref (actual_sink);
+    return caps;
+  }
+  G_UNLOCK (audio_profiles);
+
+  pad = gst_element_get_static_pad (actual_sink, "sink");
+  caps = gst_pad_query_caps (pad, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (actual_sink);
+
+  GST_DEBUG ("Audio device '%s' accepts %" GST_PTR_FORMAT, key, caps);
+
+  /* A sink that couldn't probe its device tells us nothing worth keeping */
+  if (gst_caps_is_any (caps) == FALSE) {
+    G_LOCK (audio_profiles);
+    g_hash_table_insert (audio_profiles, key, gst_caps_ref (caps));
+    G_UNLOCK (audio_profiles);
+  } else {
+    g_free (key);
+  }
+
+  return caps;
+}
+
+static gboolean
+get_audio_layout (BvwAudioOutputType type, gint *channels, guint64 *mask)
+{
+  switch (type) {
+    case BVW_AUDIO_SOUND_STEREO:
+      *channels = 2;
+      *mask = GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_RIGHT);
+      break;
+    case BVW_AUDIO_SOUND_4CHANNEL:
+      *channels = 4;
+      *mask = GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_RIGHT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_RIGHT);
+      break;
+    case BVW_AUDIO_SOUND_41CHANNEL:
+      *channels = 5;
+      *mask = GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_RIGHT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (LFE1) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_RIGHT);
+      break;
+    case BVW_AUDIO_SOUND_5CHANNEL:
+      *channels = 5;
+      *mask = GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_RIGHT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_CENTER) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_RIGHT);
+      break;
+    case BVW_AUDIO_SOUND_51CHANNEL:
+      *channels = 6;
+      *mask = GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_RIGHT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (FRONT_CENTER) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (LFE1) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_LEFT) |
+	      GST_AUDIO_CHANNEL_POSITION_MASK (REAR_RIGHT);
+      break;
+    case BVW_AUDIO_SOUND_AC3PASSTHRU:
+    default:
+      return FALSE;
+  }
+
+  return TRUE;
 }
 
 static GstCaps *
@@ -3142,52 +4605,174 @@ fixate_to_num (const GstCaps * in_caps, gint channels)
 
     /* get channel count (or list of ~) */
     gst_structure_fixate_field_nearest_int (s, "channels", channels);
+    /* whatever the layout was for, it's not for that many channels */
+    gst_structure_remove_field (s, "channel-mask");
   }
 
   return out_caps;
 }
 
-static void
-set_audio_filter (BaconVideoWidget *bvw)
+/* The raw audio caps to use for @type on a device accepting @profile */
+static GstCaps *
+get_pcm_caps (GstCaps *profile, BvwAudioOutputType type)
 {
+  GstCaps *wanted, *raw, *res;
+  guint64 mask;
   gint channels;
-  GstCaps *caps, *res;
-  GstPad *pad, *peer_pad;
 
-  /* reset old */
-  g_object_set (bvw->priv->audio_capsfilter, "caps", NULL, NULL);
+  if (get_audio_layout (type, &channels, &mask) == FALSE)
+    return NULL;
+
+  wanted = gst_caps_new_simple ("audio/x-raw",
+				"channels", G_TYPE_INT, channels,
+				"channel-mask", GST_TYPE_BITMASK, mask,
+				NULL);
+  if (profile == NULL)
+    return wanted;
+
+  res = gst_caps_intersect (profile, wanted);
+  gst_caps_unref (wanted);
+  if (gst_caps_is_empty (res) == FALSE)
+    return res;
+  gst_caps_unref (res);
+
+  /* The device can't do that layout, get as close as it goes */
+  wanted = gst_caps_new_empty_simple ("audio/x-raw");
+  raw = gst_caps_intersect (profile, wanted);
+  gst_caps_unref (wanted);
+  res = fixate_to_num (raw, channels);
+  gst_caps_unref (raw);
+
+  if (gst_caps_is_empty (res)) {
+    gst_caps_unref (res);
+    return NULL;
+  }
 
-  /* construct possible caps to filter down to our chosen caps */
-  /* Start with what the audio sink supports, but limit the allowed
-   * channel count to our speaker output configuration */
-  pad = gst_element_get_static_pad (bvw->priv->audio_capsfilter, "src");
-  peer_pad = gst_pad_get_peer (pad);
-  gst_object_unref (pad);
+  return res;
+}
 
-  caps = gst_pad_get_current_caps (peer_pad);
-  gst_object_unref (peer_pad);
+/* The compressed formats the device accepts, followed by stereo for
+ * the streams in other formats, or %NULL if it can't do passthrough */
+static GstCaps *
+get_passthrough_caps (GstCaps *profile)
+{
+  GstCaps *wanted, *res, *pcm;
 
-  if ((channels = get_num_audio_channels (bvw)) == -1)
-    return;
+  if (profile == NULL)
+    return NULL;
 
-  res = fixate_to_num (caps, channels);
-  gst_caps_unref (caps);
+  wanted = gst_caps_from_string ("audio/x-ac3; audio/x-eac3; audio/x-dts");
+  res = gst_caps_intersect (profile, wanted);
+  gst_caps_unref (wanted);
 
-  /* set */
-  if (res && gst_caps_is_empty (res)) {
+  if (gst_caps_is_empty (res)) {
     gst_caps_unref (res);
-    res = NULL;
+    return NULL;
   }
-  g_object_set (bvw->priv->audio_capsfilter, "caps", res, NULL);
 
-  if (res) {
-    gst_caps_unref (res);
-  }
+  pcm = get_pcm_caps (profile, BVW_AUDIO_SOUND_STEREO);
+  if (pcm != NULL)
+    gst_caps_append (res, pcm);
 
-  /* reset */
-  pad = gst_element_get_static_pad (bvw->priv->audio_capsfilter, "src");
-  gst_pad_set_caps (pad, NULL);
+  return res;
+}
+
+static GstElement *
+bvw_get_passthrough_bin (BaconVideoWidget *bvw)
+{
+  GstElement *sink;
+  GstPad *pad;
+
+  if (bvw->priv->passthrough_bin != NULL)
+    return bvw->priv->passthrough_bin;
+
+  sink = gst_element_factory_make ("autoaudiosink", "passthrough-sink");
+  if (sink == NULL)
+    return NULL;
+
+  /* No pitch control or gain, which need raw audio */
+  bvw->priv->passthrough_capsfilter =
+    gst_element_factory_make ("capsfilter", "passthroughfilter");
+  bvw->priv->passthrough_bin = gst_bin_new ("passthroughsinkbin");
+  gst_object_ref_sink (bvw->priv->passthrough_bin);
+  gst_bin_add_many (GST_BIN (bvw->priv->passthrough_bin),
+		    bvw->priv->passthrough_capsfilter,
+		    sink, NULL);
+  gst_element_link (bvw->priv->passthrough_capsfilter, sink);
+
+  pad = gst_element_get_static_pad (bvw->priv->passthrough_capsfilter, "sink");
+  gst_element_add_pad (bvw->priv->passthrough_bin, gst_ghost_pad_new ("sink", pad));
   gst_object_unref (pad);
+
+  bvw->priv->passthrough_sink = sink;
+
+  return bvw->priv->passthrough_bin;
+}
+
+/* Sets the caps of the audio filter from the speaker setup and what the
+ * device accepts. Channel layout changes apply to the current stream, the
+ * filter making its upstream renegotiate, whereas switching to or from
+ * passthrough applies to the next stream opened. */
+static void
+bvw_configure_audio_output (BaconVideoWidget *bvw)
+{
+  GstElement *bin, *filter, *capsfilter, *current_bin, *unused_bin, *unused_sink;
+  GstCaps *profile, *caps = NULL;
+
+  if (bvw->priv->speakersetup == BVW_AUDIO_SOUND_AC3PASSTHRU &&
+      bvw_get_passthrough_bin (bvw) != NULL) {
+    profile = bvw_get_audio_profile (bvw->priv->passthrough_sink);
+    caps = get_passthrough_caps (profile);
+    if (profile)
+      gst_caps_unref (profile);
+    if (caps == NULL)
+      GST_DEBUG ("The audio device can't do passthrough, using stereo");
+  }
+
+  if (caps != NULL) {
+    bin = bvw->priv->passthrough_bin;
+    capsfilter = bvw->priv->passthrough_capsfilter;
+    filter = NULL;
+  } else {
+    bin = bvw->priv->audio_bin;
+    capsfilter = bvw->priv->audio_capsfilter;
+    filter = bvw->priv->audio_pitchcontrol;
+
+    profile = bvw_get_audio_profile (bvw->priv->audio_sink);
+    caps = get_pcm_caps (profile,
+			 bvw->priv->speakersetup == BVW_AUDIO_SOUND_AC3PASSTHRU ?
+			 BVW_AUDIO_SOUND_STEREO : bvw->priv->speakersetup);
+    if (profile)
+      gst_caps_unref (profile);
+  }
+
+  GST_DEBUG ("Setting audio output caps to %" GST_PTR_FORMAT, caps);
+  g_object_set (capsfilter, "caps", caps, NULL);
+  if (caps)
+    gst_caps_unref (caps);
+
+  g_object_get (bvw->priv->play, "audio-sink", &current_bin, NULL);
+  if (current_bin != bin) {
+    g_object_set (bvw->priv->play,
+		  "audio-sink", bin,
+		  "audio-filter", filter,
+		  NULL);
+  }
+
+  /* Probing leaves the sinks in READY, with their device open. Close the
+   * one we didn't pick, unless the current stream is still playing to it */
+  if (bin == bvw->priv->audio_bin) {
+    unused_bin = bvw->priv->passthrough_bin;
+    unused_sink = bvw->priv->passthrough_sink;
+  } else {
+    unused_bin = bvw->priv->audio_bin;
+    unused_sink = bvw->priv->audio_sink;
+  }
+  if (unused_bin != NULL && unused_bin != current_bin)
+    gst_element_set_state (unused_sink, GST_STATE_NULL);
+
+  if (current_bin)
+    gst_object_unref (current_bin);
 }
 
 /**
@@ -3213,6 +4798,11 @@ bacon_video_widget_get_audio_output_type (BaconVideoWidget *bvw)
  * @type: the new audio output type
  *
  * Sets the audio output type (number of speaker channels) in the video widget.
+ *
+ * Speaker setups apply to the current stream straight away. With
+ * %BVW_AUDIO_SOUND_AC3PASSTHRU, AC3 and DTS streams are sent undecoded to
+ * audio devices that accept them, starting with the next stream opened,
+ * and other streams are played in stereo.
  **/
 void
 bacon_video_widget_set_audio_output_type (BaconVideoWidget *bvw,
@@ -3222,13 +4812,13 @@ bacon_video_widget_set_audio_output_type (BaconVideoWidget *bvw,
 
   if (type == bvw->priv->speakersetup)
     return;
-  else if (type == BVW_AUDIO_SOUND_AC3PASSTHRU)
-    return;
 
   bvw->priv->speakersetup = type;
   g_object_notify (G_OBJECT (bvw), "audio-output-type");
 
-  set_audio_filter (bvw);
+  /* Otherwise, it's done before the next stream prerolls */
+  if (bvw->priv->mrl != NULL)
+    bvw_configure_audio_output (bvw);
 }
 
 void
@@ -3430,6 +5020,7 @@ bacon_video_widget_open (BaconVideoWidget *bvw,
                          const char       *mrl)
 {
   GFile *file;
+  gint64 trace_start;
 
   g_return_if_fail (mrl != NULL);
   g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
@@ -3441,6 +5032,7 @@ bacon_video_widget_open (BaconVideoWidget *bvw,
   }
   
   GST_DEBUG ("mrl = %s", GST_STR_NULL (mrl));
+  trace_start = xplayer_trace_begin ();
 
   /* this allows non-URI type of files in the thumbnailer and so on */
   file = g_file_new_for_commandline_arg (mrl);
@@ -3460,6 +5052,13 @@ bacon_video_widget_open (BaconVideoWidget *bvw,
   bvw->priv->media_has_video = FALSE;
   bvw->priv->media_has_audio = FALSE;
 
+  bvw_set_quality_level (bvw, QUALITY_LEVEL_FULL);
+  bvw_reset_stats (bvw);
+  bvw->priv->open_time = g_get_monotonic_time ();
+
+  /* Usually known before the pipeline is prerolled */
+  bvw_lookup_loudness (bvw);
+
   /* Flush the bus to make sure we don't get any messages
    * from the previous URI, see bug #607224.
    */
@@ -3470,6 +5069,9 @@ bacon_video_widget_open (BaconVideoWidget *bvw,
 
   g_object_set (bvw->priv->play, "uri", bvw->priv->mrl, NULL);
 
+  /* So that the first buffers already have the right layout */
+  bvw_configure_audio_output (bvw);
+
   bvw->priv->seekable = -1;
   bvw->priv->target_state = GST_STATE_PAUSED;
   bvw_clear_missing_plugins_messages (bvw);
@@ -3477,6 +5079,8 @@ bacon_video_widget_open (BaconVideoWidget *bvw,
   gst_element_set_state (bvw->priv->play, GST_STATE_PAUSED);
 
   g_signal_emit (bvw, bvw_signals[SIGNAL_CHANNELS_CHANGE], 0);
+
+  xplayer_trace_end_with_detail ("bacon_video_widget_open", trace_start, "%s", bvw->priv->mrl);
 }
 
 /**
@@ -3586,9 +5190,13 @@ bacon_video_widget_seek_time_no_lock (BaconVideoWidget *bvw,
     return FALSE;
 
   bvw->priv->seek_time = -1;
+  bvw->priv->seek_start_time = g_get_monotonic_time ();
 
   gst_element_set_state (bvw->priv->play, GST_STATE_PAUSED);
 
+  if (bvw->priv->trickmode)
+    flag |= TRICKMODE_SEEK_FLAGS;
+
   gst_element_seek (bvw->priv->play, bvw->priv->rate,
 		    GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH | flag,
 		    GST_SEEK_TYPE_SET, _time * GST_MSECOND,
@@ -3743,6 +5351,7 @@ bvw_stop_play_pipeline (BaconVideoWidget * bvw)
   g_clear_pointer (&bvw->priv->download_filename, g_free);
   bvw->priv->buffering_left = -1;
   g_clear_object (&bvw->priv->download_buffering_element);
+  g_clear_object (&bvw->priv->ring_buffering_element);
   bvw_reconfigure_fill_timeout (bvw, 0);
   bvw->priv->movie_par_n = bvw->priv->movie_par_d = 1;
   g_clear_object (&bvw->priv->cover_pixbuf);
@@ -3765,60 +5374,231 @@ bacon_video_widget_stop (BaconVideoWidget * bvw)
   GST_LOG ("Stopping");
   bvw_stop_play_pipeline (bvw);
 
-  /* Reset position to 0 when stopping */
-  got_time_tick (GST_ELEMENT (bvw->priv->play), 0, bvw);
+  /* Reset position to 0 when stopping */
+  got_time_tick (GST_ELEMENT (bvw->priv->play), 0, bvw);
+}
+
+/**
+ * bacon_video_widget_close:
+ * @bvw: a #BaconVideoWidget
+ *
+ * Closes the current stream and frees the resources associated with it.
+ **/
+void
+bacon_video_widget_close (BaconVideoWidget * bvw)
+{
+  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
+  g_return_if_fail (GST_IS_ELEMENT (bvw->priv->play));
+  
+  GST_LOG ("Closing");
+  bvw_stop_play_pipeline (bvw);
+
+  g_clear_pointer (&bvw->priv->mrl, g_free);
+  g_clear_pointer (&bvw->priv->subtitle_uri, g_free);
+  g_object_set (G_OBJECT (bvw->priv->play), "suburi", NULL, NULL);
+  bvw->priv->subtitles_in_pipeline = FALSE;
+  if (bvw->priv->subtitles_cancellable)
+    g_cancellable_cancel (bvw->priv->subtitles_cancellable);
+  g_clear_object (&bvw->priv->subtitles_cancellable);
+  bvw_unload_subtitles (bvw);
+  bvw_reset_loudness (bvw);
+  g_clear_pointer (&bvw->priv->user_id, g_free);
+  g_clear_pointer (&bvw->priv->user_pw, g_free);
+
+  bvw->priv->is_live = FALSE;
+  bvw->priv->is_menu = FALSE;
+  bvw->priv->has_angles = FALSE;
+  bvw->priv->window_resized = FALSE;
+  bvw->priv->rate = FORWARD_RATE;
+  bvw_set_trickmode (bvw, FALSE);
+
+  bvw->priv->current_time = 0;
+  bvw->priv->seek_req_time = GST_CLOCK_TIME_NONE;
+  bvw->priv->seek_time = -1;
+  bvw->priv->stream_length = 0;
+
+  if (bvw->priv->eos_id != 0)
+    g_source_remove (bvw->priv->eos_id);
+
+  bvw_cancel_metadata_update (bvw);
+  g_clear_pointer (&bvw->priv->tagcache, gst_tag_list_unref);
+  g_clear_pointer (&bvw->priv->audiotags, gst_tag_list_unref);
+  g_clear_pointer (&bvw->priv->videotags, gst_tag_list_unref);
+
+  bvw_set_quality_level (bvw, QUALITY_LEVEL_FULL);
+  bvw_reset_stats (bvw);
+  bvw->priv->open_time = -1;
+
+  g_object_notify (G_OBJECT (bvw), "seekable");
+  g_signal_emit (bvw, bvw_signals[SIGNAL_CHANNELS_CHANGE], 0);
+  got_time_tick (GST_ELEMENT (bvw->priv->play), 0, bvw);
+}
+
+static void
+bvw_do_navigation_command (BaconVideoWidget * bvw, GstNavigationCommand command)
+{
+  if (bvw->priv->navigation)
+    gst_navigation_send_command (bvw->priv->navigation, command);
+}
+
+static gboolean
+bvw_subtitle_update_timeout (BaconVideoWidget *bvw)
+{
+  gint64 pos;
+
+  bvw->priv->subtitle_update_id = 0;
+
+  if (gst_element_query_position (bvw->priv->play, GST_FORMAT_TIME, &pos))
+    bvw_update_subtitle_text (bvw, pos / GST_MSECOND);
+
+  return FALSE;
+}
+
+/* Shows the external subtitles' cues for @time, and wakes up
+ * when they change rather than waiting for the next tick */
+static void
+bvw_update_subtitle_text (BaconVideoWidget *bvw, gint64 time)
+{
+  char *text;
+  gint64 next_change;
+
+  if (bvw->priv->subtitle_update_id != 0) {
+    g_source_remove (bvw->priv->subtitle_update_id);
+    bvw->priv->subtitle_update_id = 0;
+  }
+
+  if (bvw->priv->subtitles == NULL || !bvw->priv->show_subtitles) {
+    bvw->priv->subtitle_valid_until = -1;
+    if (bvw->priv->subtitle_text != NULL)
+      clutter_actor_hide (bvw->priv->subtitle_text);
+    return;
+  }
+
+  /* Most ticks fall within the current cues, we already
+   * know when the next one is due */
+  if (time >= bvw->priv->subtitle_valid_from &&
+      time < bvw->priv->subtitle_valid_until)
+    goto schedule;
+
+  if (bvw->priv->subtitle_text == NULL) {
+    ClutterColor bg = { 0x00, 0x00, 0x00, 0x80 };
+    const char *font;
+
+    font = bvw->priv->subtitle_font ? bvw->priv->subtitle_font : DEFAULT_SUBTITLE_FONT;
+    bvw->priv->subtitle_text = clutter_text_new_full (font, "", CLUTTER_COLOR_White);
+    clutter_actor_set_name (bvw->priv->subtitle_text, "subtitles");
+    clutter_text_set_line_alignment (CLUTTER_TEXT (bvw->priv->subtitle_text), PANGO_ALIGN_CENTER);
+    clutter_actor_set_background_color (bvw->priv->subtitle_text, &bg);
+    clutter_actor_set_x_align (bvw->priv->subtitle_text, CLUTTER_ACTOR_ALIGN_CENTER);
+    clutter_actor_set_y_align (bvw->priv->subtitle_text, CLUTTER_ACTOR_ALIGN_END);
+    clutter_actor_set_margin_bottom (bvw->priv->subtitle_text, SUBTITLE_MARGIN);
+    clutter_actor_add_child (bvw->priv->stage, bvw->priv->subtitle_text);
+    clutter_actor_set_child_above_sibling (bvw->priv->stage,
+					   bvw->priv->subtitle_text,
+					   bvw->priv->frame);
+  }
+
+  text = bacon_video_subtitles_get_text_at (bvw->priv->subtitles, time, &next_change);
+  if (text != NULL) {
+    if (g_strcmp0 (clutter_text_get_text (CLUTTER_TEXT (bvw->priv->subtitle_text)), text) != 0)
+      clutter_text_set_text (CLUTTER_TEXT (bvw->priv->subtitle_text), text);
+    clutter_actor_show (bvw->priv->subtitle_text);
+    g_free (text);
+  } else {
+    clutter_actor_hide (bvw->priv->subtitle_text);
+  }
+
+  bvw->priv->subtitle_valid_from = time;
+  bvw->priv->subtitle_valid_until = next_change >= 0 ? next_change : G_MAXINT64;
+
+schedule:
+  if (bvw->priv->subtitle_valid_until != G_MAXINT64 &&
+      bvw->priv->target_state == GST_STATE_PLAYING &&
+      bvw->priv->rate > 0.0) {
+    bvw->priv->subtitle_update_id =
+      g_timeout_add ((bvw->priv->subtitle_valid_until - time) / bvw->priv->rate,
+		     (GSourceFunc) bvw_subtitle_update_timeout, bvw);
+  }
+}
+
+static void
+bvw_unload_subtitles (BaconVideoWidget *bvw)
+{
+  g_clear_pointer (&bvw->priv->subtitles, bacon_video_subtitles_unref);
+  bvw_update_subtitle_text (bvw, bvw->priv->current_time);
+}
+
+/* Fallback for the subtitle files we can't parse ourselves,
+ * which requires taking the pipeline down to READY */
+static void
+bvw_set_suburi (BaconVideoWidget *bvw, const char *subtitle_uri)
+{
+  GstState cur_state;
+
+  /* Wait for the previous state change to finish */
+  gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  /* -> READY */
+  gst_element_get_state (bvw->priv->play, &cur_state, NULL, 0);
+  if (cur_state > GST_STATE_READY) {
+    gst_element_set_state (bvw->priv->play, GST_STATE_READY);
+    /* Block for new state */
+    gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
+  }
+
+  g_object_set (G_OBJECT (bvw->priv->play), "suburi", subtitle_uri, NULL);
+  bvw->priv->subtitles_in_pipeline = (subtitle_uri != NULL);
+
+  /* And back to the original state */
+  if (cur_state > GST_STATE_READY) {
+    gst_element_set_state (bvw->priv->play, cur_state);
+    /* Block for new state */
+    gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
+  }
+
+  if (bvw->priv->current_time > 0)
+    bacon_video_widget_seek_time_no_lock (bvw, bvw->priv->current_time,
+					  GST_SEEK_FLAG_ACCURATE, NULL);
 }
 
-/**
- * bacon_video_widget_close:
- * @bvw: a #BaconVideoWidget
- *
- * Closes the current stream and frees the resources associated with it.
- **/
-void
-bacon_video_widget_close (BaconVideoWidget * bvw)
+static void
+bvw_subtitles_loaded_cb (GObject          *source_object,
+			 GAsyncResult     *result,
+			 BaconVideoWidget *bvw)
 {
-  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
-  g_return_if_fail (GST_IS_ELEMENT (bvw->priv->play));
-  
-  GST_LOG ("Closing");
-  bvw_stop_play_pipeline (bvw);
+  BaconVideoSubtitles *subs;
+  GError *error = NULL;
 
-  g_clear_pointer (&bvw->priv->mrl, g_free);
-  g_clear_pointer (&bvw->priv->subtitle_uri, g_free);
-  g_object_set (G_OBJECT (bvw->priv->play), "suburi", NULL, NULL);
-  g_clear_pointer (&bvw->priv->subtitle_uri, g_free);
-  g_clear_pointer (&bvw->priv->user_id, g_free);
-  g_clear_pointer (&bvw->priv->user_pw, g_free);
+  subs = bacon_video_subtitles_load_finish (result, &error);
+  if (subs == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    /* The widget might be gone already */
+    g_error_free (error);
+    return;
+  }
 
-  bvw->priv->is_live = FALSE;
-  bvw->priv->is_menu = FALSE;
-  bvw->priv->has_angles = FALSE;
-  bvw->priv->window_resized = FALSE;
-  bvw->priv->rate = FORWARD_RATE;
+  g_clear_object (&bvw->priv->subtitles_cancellable);
 
-  bvw->priv->current_time = 0;
-  bvw->priv->seek_req_time = GST_CLOCK_TIME_NONE;
-  bvw->priv->seek_time = -1;
-  bvw->priv->stream_length = 0;
+  if (subs == NULL) {
+    GST_DEBUG ("Letting playbin handle subtitles '%s': %s",
+	       bvw->priv->subtitle_uri, error->message);
+    g_error_free (error);
 
-  if (bvw->priv->eos_id != 0)
-    g_source_remove (bvw->priv->eos_id);
+    bvw_set_suburi (bvw, bvw->priv->subtitle_uri);
+    if (bvw->priv->show_subtitles)
+      bacon_video_widget_set_subtitle (bvw, 0);
+    return;
+  }
 
-  g_clear_pointer (&bvw->priv->tagcache, gst_tag_list_unref);
-  g_clear_pointer (&bvw->priv->audiotags, gst_tag_list_unref);
-  g_clear_pointer (&bvw->priv->videotags, gst_tag_list_unref);
+  GST_DEBUG ("Loaded %u cues from subtitles '%s'",
+	     bacon_video_subtitles_get_n_cues (subs), bvw->priv->subtitle_uri);
 
-  g_object_notify (G_OBJECT (bvw), "seekable");
-  g_signal_emit (bvw, bvw_signals[SIGNAL_CHANNELS_CHANGE], 0);
-  got_time_tick (GST_ELEMENT (bvw->priv->play), 0, bvw);
-}
+  if (bvw->priv->subtitles_in_pipeline)
+    bvw_set_suburi (bvw, NULL);
 
-static void
-bvw_do_navigation_command (BaconVideoWidget * bvw, GstNavigationCommand command)
-{
-  if (bvw->priv->navigation)
-    gst_navigation_send_command (bvw->priv->navigation, command);
+  bvw->priv->subtitles = subs;
+  bvw_update_subtitle_text (bvw, bvw->priv->current_time);
+
+  g_signal_emit (bvw, bvw_signals[SIGNAL_CHANNELS_CHANGE], 0);
 }
 
 /**
@@ -3829,12 +5609,20 @@ bvw_do_navigation_command (BaconVideoWidget * bvw, GstNavigationCommand command)
  * Sets the URI for the text subtitle file to be displayed alongside
  * the current video. Use %NULL if you want to unload the current text subtitle
  * file being used.
+ *
+ * SubRip, WebVTT, SubStation Alpha and MicroDVD files are loaded in the
+ * background and drawn on top of the video, so that playback isn't interrupted.
+ * #BaconVideoWidget::channels-change is emitted once they're loaded, after
+ * which bacon_video_widget_find_subtitle() and friends can be used.
  */
 void
 bacon_video_widget_set_text_subtitle (BaconVideoWidget * bvw,
 				      const gchar * subtitle_uri)
 {
-  GstState cur_state;
+  GFile *file;
+  char *encoding = NULL;
+  gdouble fps = 0.0;
+  gint flags;
 
   g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
   g_return_if_fail (GST_IS_ELEMENT (bvw->priv->play));
@@ -3842,39 +5630,124 @@ bacon_video_widget_set_text_subtitle (BaconVideoWidget * bvw,
 
   GST_LOG ("Setting subtitle as %s\n", GST_STR_NULL (subtitle_uri));
 
-  bacon_video_widget_set_subtitle(bvw, 0);
+  if (bvw->priv->subtitles_cancellable)
+    g_cancellable_cancel (bvw->priv->subtitles_cancellable);
+  g_clear_object (&bvw->priv->subtitles_cancellable);
+  bvw_unload_subtitles (bvw);
 
-  if (subtitle_uri == NULL &&
-      bvw->priv->subtitle_uri == NULL)
+  g_free (bvw->priv->subtitle_uri);
+  bvw->priv->subtitle_uri = g_strdup (subtitle_uri);
+
+  if (subtitle_uri == NULL) {
+    if (bvw->priv->subtitles_in_pipeline)
+      bvw_set_suburi (bvw, NULL);
+    bacon_video_widget_set_subtitle (bvw, 0);
     return;
+  }
 
-  /* Wait for the previous state change to finish */
-  gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
+  /* Don't show the stream's own subtitles on top of the external ones */
+  bvw->priv->show_subtitles = TRUE;
+  g_object_get (bvw->priv->play, "flags", &flags, NULL);
+  g_object_set (bvw->priv->play, "flags", flags & ~GST_PLAY_FLAG_TEXT, NULL);
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (bvw->priv->play), "subtitle-encoding"))
+    g_object_get (bvw->priv->play, "subtitle-encoding", &encoding, NULL);
+  if (bvw->priv->video_fps_d > 0)
+    fps = (gdouble) bvw->priv->video_fps_n / bvw->priv->video_fps_d;
+
+  file = g_file_new_for_uri (subtitle_uri);
+  bvw->priv->subtitles_cancellable = g_cancellable_new ();
+  bacon_video_subtitles_load_async (file, encoding, fps,
+				    bvw->priv->subtitles_cancellable,
+				    (GAsyncReadyCallback) bvw_subtitles_loaded_cb, bvw);
+  g_object_unref (file);
+  g_free (encoding);
+}
 
-  /* -> READY */
-  gst_element_get_state (bvw->priv->play, &cur_state, NULL, 0);
-  if (cur_state > GST_STATE_READY) {
-    gst_element_set_state (bvw->priv->play, GST_STATE_READY);
-    /* Block for new state */
-    gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
-  }
+/**
+ * bacon_video_widget_get_subtitle_text_at:
+ * @bvw: a #BaconVideoWidget
+ * @_time: a time, in milliseconds
+ *
+ * Returns the lines of the external subtitles, set with
+ * bacon_video_widget_set_text_subtitle(), showing at @_time.
+ *
+ * Return value: the text, or %NULL if none is showing or the subtitles
+ * aren't loaded yet; free with g_free()
+ **/
+char *
+bacon_video_widget_get_subtitle_text_at (BaconVideoWidget *bvw,
+					 gint64            _time)
+{
+  g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), NULL);
 
-  g_free (bvw->priv->subtitle_uri);
-  bvw->priv->subtitle_uri = g_strdup (subtitle_uri);
-  g_object_set (G_OBJECT (bvw->priv->play), "suburi", subtitle_uri, NULL);
+  if (bvw->priv->subtitles == NULL)
+    return NULL;
 
-  /* And back to the original state */
-  if (cur_state > GST_STATE_READY) {
-    gst_element_set_state (bvw->priv->play, cur_state);
-    /* Block for new state */
-    gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
-  }
+  return bacon_video_subtitles_get_text_at (bvw->priv->subtitles, _time, NULL);
+}
 
-  if (bvw->priv->current_time > 0)
-    bacon_video_widget_seek_time_no_lock (bvw, bvw->priv->current_time,
-					  GST_SEEK_FLAG_ACCURATE, NULL);
+/**
+ * bacon_video_widget_get_next_subtitle_time:
+ * @bvw: a #BaconVideoWidget
+ * @_time: a time, in milliseconds
+ *
+ * Returns the time at which the next line of the external subtitles
+ * after @_time starts.
+ *
+ * Return value: the time in milliseconds, or <code class="literal">-1</code>
+ * if there are no more lines
+ **/
+gint64
+bacon_video_widget_get_next_subtitle_time (BaconVideoWidget *bvw,
+					   gint64            _time)
+{
+  gint cue;
+
+  g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), -1);
+
+  if (bvw->priv->subtitles == NULL)
+    return -1;
+
+  cue = bacon_video_subtitles_get_next_cue (bvw->priv->subtitles, _time);
+  if (cue < 0)
+    return -1;
+
+  return bacon_video_subtitles_get_cue (bvw->priv->subtitles, cue)->start;
 }
 
+/**
+ * bacon_video_widget_find_subtitle:
+ * @bvw: a #BaconVideoWidget
+ * @text: the text to look for
+ * @from_time: the time to start looking from, in milliseconds
+ *
+ * Looks for the first line of the external subtitles starting at or
+ * after @from_time which contains @text, ignoring case. The subtitles
+ * are only parsed once, when loaded.
+ *
+ * Return value: the time at which the line starts, in milliseconds, or
+ * <code class="literal">-1</code> if none matched
+ **/
+gint64
+bacon_video_widget_find_subtitle (BaconVideoWidget *bvw,
+				  const char       *text,
+				  gint64            from_time)
+{
+  gint cue;
+
+  g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), -1);
+  g_return_val_if_fail (text != NULL, -1);
+
+  if (bvw->priv->subtitles == NULL)
+    return -1;
+
+  cue = bacon_video_subtitles_find (bvw->priv->subtitles, text, from_time);
+  if (cue < 0)
+    return -1;
+
+  return bacon_video_subtitles_get_cue (bvw->priv->subtitles, cue)->start;
+}
 
 /**
  * bacon_video_widget_dvd_event:
@@ -3958,6 +5831,7 @@ bacon_video_widget_dvd_event (BaconVideoWidget * bvw,
         gst_element_seek (bvw->priv->play, FORWARD_RATE, fmt, GST_SEEK_FLAG_FLUSH,
             GST_SEEK_TYPE_SET, val, GST_SEEK_TYPE_NONE, G_GINT64_CONSTANT (0));
 	bvw->priv->rate = FORWARD_RATE;
+	bvw_set_trickmode (bvw, FALSE);
       } else {
         GST_DEBUG ("failed to query position (%s)", fmt_name);
       }
@@ -4129,6 +6003,11 @@ bacon_video_widget_set_subtitle_font (BaconVideoWidget * bvw,
   g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
   g_return_if_fail (GST_IS_ELEMENT (bvw->priv->play));
 
+  g_free (bvw->priv->subtitle_font);
+  bvw->priv->subtitle_font = g_strdup (font);
+  if (bvw->priv->subtitle_text != NULL)
+    clutter_text_set_font_name (CLUTTER_TEXT (bvw->priv->subtitle_text), font);
+
   if (!g_object_class_find_property (G_OBJECT_GET_CLASS (bvw->priv->play), "subtitle-font-desc"))
     return;
   g_object_set (bvw->priv->play, "subtitle-font-desc", font, NULL);
@@ -5463,6 +7342,26 @@ bacon_video_widget_error_quark (void)
   return q;
 }
 
+static void
+bvw_set_trickmode (BaconVideoWidget *bvw, gboolean trickmode)
+{
+  if (bvw->priv->trickmode == trickmode)
+    return;
+
+  GST_DEBUG ("%s keyframe-only trick mode", trickmode ? "Enabling" : "Disabling");
+
+  /* Not all demuxers honour GST_SEEK_FLAG_TRICKMODE_NO_AUDIO,
+   * so make sure we don't play garbled audio either way, and put
+   * back whatever mute state the user had afterwards */
+  if (trickmode) {
+    g_object_get (bvw->priv->play, "mute", &bvw->priv->trickmode_saved_mute, NULL);
+    g_object_set (bvw->priv->play, "mute", TRUE, NULL);
+  } else {
+    g_object_set (bvw->priv->play, "mute", bvw->priv->trickmode_saved_mute, NULL);
+  }
+  bvw->priv->trickmode = trickmode;
+}
+
 static gboolean
 bvw_set_playback_direction (BaconVideoWidget *bvw, gboolean forward)
 {
@@ -5490,6 +7389,7 @@ bvw_set_playback_direction (BaconVideoWidget *bvw, gboolean forward)
       } else {
 	gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
 	bvw->priv->rate = REVERSE_RATE;
+	bvw_set_trickmode (bvw, FALSE);
 	retval = TRUE;
       }
     } else {
@@ -5511,6 +7411,7 @@ bvw_set_playback_direction (BaconVideoWidget *bvw, gboolean forward)
       } else {
 	gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
 	bvw->priv->rate = FORWARD_RATE;
+	bvw_set_trickmode (bvw, FALSE);
 	retval = TRUE;
       }
     } else {
@@ -5532,6 +7433,127 @@ element_make_or_warn (const char *plugin,
   return element;
 }
 
+/* The elements of a pipeline, which don't need the main thread to be
+ * built, unlike the video sink */
+typedef struct {
+  GstElement *play;
+  GstElement *audio_pitchcontrol;
+  GstElement *audio_sink;
+} BvwPipelineElements;
+
+static GThread *preload_thread = NULL;
+
+static BvwPipelineElements *
+bvw_make_pipeline_elements (void)
+{
+  BvwPipelineElements *elements;
+  gchar *version_str;
+  GstCaps *caps;
+
+#ifndef GST_DISABLE_GST_DEBUG
+  if (_xplayer_gst_debug_cat == NULL) {
+    GST_DEBUG_CATEGORY_INIT (_xplayer_gst_debug_cat, "xplayer", 0,
+        "Xplayer GStreamer Backend");
+  }
+#endif
+
+  version_str = gst_version_string ();
+  GST_DEBUG ("Initialised %s", version_str);
+  g_free (version_str);
+
+  gst_pb_utils_init ();
+
+  elements = g_new0 (BvwPipelineElements, 1);
+  elements->play = element_make_or_warn ("playbin", "play");
+  elements->audio_pitchcontrol = element_make_or_warn ("scaletempo", "scaletempo");
+  elements->audio_sink = element_make_or_warn ("autoaudiosink", "audio-sink");
+
+  /* Connecting to the sound server, which the first open would
+   * otherwise wait for */
+  if (elements->audio_sink != NULL) {
+    caps = bvw_get_audio_profile (elements->audio_sink);
+    if (caps != NULL)
+      gst_caps_unref (caps);
+  }
+
+  return elements;
+}
+
+static gpointer
+bvw_preload_thread (gpointer data)
+{
+  BvwPipelineElements *elements;
+  GError *error = NULL;
+  gint64 trace_start;
+
+  trace_start = xplayer_trace_begin ();
+
+  /* Loads the plugin registry, which is the slowest part of starting up */
+  if (gst_init_check (NULL, NULL, &error) == FALSE) {
+    g_warning ("Failed to initialise GStreamer: %s", error->message);
+    g_error_free (error);
+    return NULL;
+  }
+  xplayer_trace_end ("gst_init", trace_start);
+
+  trace_start = xplayer_trace_begin ();
+  elements = bvw_make_pipeline_elements ();
+  xplayer_trace_end ("bvw_make_pipeline_elements", trace_start);
+
+  return elements;
+}
+
+/**
+ * bacon_video_widget_preload:
+ *
+ * Initialises GStreamer, if it isn't yet, and builds the pipeline of the
+ * next #BaconVideoWidget in a thread, so that it gets done while the rest
+ * of the interface is being loaded. bacon_video_widget_new() waits for the
+ * thread to finish.
+ *
+ * GStreamer's command-line options mustn't be parsed, through
+ * bacon_video_widget_get_option_group(), until gst_is_initialized()
+ * returns %TRUE.
+ **/
+void
+bacon_video_widget_preload (void)
+{
+  if (preload_thread != NULL)
+    return;
+
+  /* Before the thread starts, as it might change the environment */
+  if (!gst_is_initialized ())
+    xplayer_gst_registry_cache_init ();
+
+  preload_thread = g_thread_new ("bvw-preload", bvw_preload_thread, NULL);
+}
+
+static BvwPipelineElements *
+bvw_get_pipeline_elements (void)
+{
+  BvwPipelineElements *elements = NULL;
+  gint64 trace_start;
+
+  if (preload_thread != NULL) {
+    trace_start = xplayer_trace_begin ();
+    elements = g_thread_join (preload_thread);
+    preload_thread = NULL;
+    xplayer_trace_end ("bacon_video_widget_preload_join", trace_start);
+
+    /* Here rather than in the thread, as it changes the environment
+     * back from what bacon_video_widget_preload() set */
+    if (gst_is_initialized ())
+      XPLAYER_TRACE ("gst_registry_cache_update", xplayer_gst_registry_cache_update ());
+  }
+
+  /* Not if the thread failed to initialise GStreamer, which
+   * nothing else did either */
+  if (elements == NULL && gst_is_initialized ())
+    elements = bvw_make_pipeline_elements ();
+
+  return elements;
+}
+
 static gboolean
 bacon_video_widget_initable_init (GInitable     *initable,
 				  GCancellable  *cancellable,
@@ -5544,35 +7566,28 @@ bacon_video_widget_initable_init (GInitable     *initable,
 #else
   GstElement *audio_sink = NULL, *video_sink = NULL;
 #endif
-  gchar *version_str;
   GstPlayFlags flags;
   GstElement *audio_bin;
   GstPad *audio_pad;
+  BvwPipelineElements *elements;
 
   bvw = BACON_VIDEO_WIDGET (initable);
 
-#ifndef GST_DISABLE_GST_DEBUG
-  if (_xplayer_gst_debug_cat == NULL) {
-    GST_DEBUG_CATEGORY_INIT (_xplayer_gst_debug_cat, "xplayer", 0,
-        "Xplayer GStreamer Backend");
+  /* Instantiate all the fallible plugins, the ones that were
+   * possibly built ahead by bacon_video_widget_preload() */
+  elements = bvw_get_pipeline_elements ();
+  if (elements != NULL) {
+    bvw->priv->play = elements->play;
+    bvw->priv->audio_pitchcontrol = elements->audio_pitchcontrol;
+    audio_sink = elements->audio_sink;
+    g_free (elements);
   }
-#endif
-
-  version_str = gst_version_string ();
-  GST_DEBUG ("Initialised %s", version_str);
-  g_free (version_str);
-
-  gst_pb_utils_init ();
 
-  /* Instantiate all the fallible plugins */
-  bvw->priv->play = element_make_or_warn ("playbin", "play");
-  bvw->priv->audio_pitchcontrol = element_make_or_warn ("scaletempo", "scaletempo");
 #ifdef HAVE_CLUTTER_GST_3
   video_sink = clutter_gst_video_sink_new ();
 #else
   video_sink = element_make_or_warn ("cluttersink", "video-sink");
 #endif
-  audio_sink = element_make_or_warn ("autoaudiosink", "audio-sink");
 
   if (!bvw->priv->play ||
       !bvw->priv->audio_pitchcontrol ||
@@ -5590,11 +7605,15 @@ bacon_video_widget_initable_init (GInitable     *initable,
 
   bvw->priv->bus = gst_element_get_bus (bvw->priv->play);
 
-  /* Add the download flag, for streaming buffering,
-   * and the deinterlace flag, for video only */
+  /* So that the decoders and sinks created later get the quality level */
+  bvw_watch_element (bvw, bvw->priv->play);
+
+  /* Add the deinterlace flag, for video only, and the download flag or
+   * the ring buffer, for streaming buffering */
   g_object_get (bvw->priv->play, "flags", &flags, NULL);
-  flags |= GST_PLAY_FLAG_DOWNLOAD | GST_PLAY_FLAG_DEINTERLACE;
+  flags |= GST_PLAY_FLAG_DEINTERLACE;
   g_object_set (bvw->priv->play, "flags", flags, NULL);
+  bvw_configure_buffering (bvw);
 
   gst_bus_add_signal_watch (bvw->priv->bus);
 
@@ -5624,13 +7643,11 @@ bacon_video_widget_initable_init (GInitable     *initable,
   g_object_set (G_OBJECT (video_sink), "texture", bvw->priv->texture, NULL);
 #endif
 
-  /* The logo */
-  bvw->priv->logo_frame = xplayer_aspect_frame_new ();
+  /* The logo, added above the video by set_current_actor() */
+  bvw->priv->logo_frame = g_object_ref_sink (xplayer_aspect_frame_new ());
   clutter_actor_set_name (bvw->priv->logo_frame, "logo-frame");
   bvw->priv->logo = clutter_texture_new ();
   xplayer_aspect_frame_set_child (XPLAYER_ASPECT_FRAME (bvw->priv->logo_frame), bvw->priv->logo);
-  clutter_actor_add_child (CLUTTER_ACTOR (bvw->priv->stage), bvw->priv->logo_frame);
-  clutter_actor_hide (CLUTTER_ACTOR (bvw->priv->logo_frame));
 
   /* The video */
   bvw->priv->frame = xplayer_aspect_frame_new ();
@@ -5639,9 +7656,11 @@ bacon_video_widget_initable_init (GInitable     *initable,
 
   clutter_actor_add_child (CLUTTER_ACTOR (bvw->priv->stage), bvw->priv->frame);
 
-  clutter_actor_set_child_above_sibling (CLUTTER_ACTOR (bvw->priv->stage),
-					 CLUTTER_ACTOR (bvw->priv->logo_frame),
-					 CLUTTER_ACTOR (bvw->priv->frame));
+  /* Frame pacing and paint cost, for the statistics */
+  g_signal_connect (bvw->priv->stage, "paint",
+		    G_CALLBACK (bvw_stage_paint_started_cb), bvw);
+  g_signal_connect_after (bvw->priv->stage, "paint",
+			  G_CALLBACK (bvw_stage_paint_finished_cb), bvw);
 
   /* The OSD */
   bvw->priv->osd = bacon_video_osd_actor_new ();
@@ -5655,14 +7674,19 @@ bacon_video_widget_initable_init (GInitable     *initable,
   /* And tell playbin */
   g_object_set (bvw->priv->play, "video-sink", video_sink, NULL);
 
-  /* Link the audiopitch element */
+  /* Link the audiopitch element, and the loudness normalisation gain,
+   * which passes buffers through untouched until it's set */
   bvw->priv->audio_capsfilter =
     gst_element_factory_make ("capsfilter", "audiofilter");
+  bvw->priv->audio_gain =
+    gst_element_factory_make ("volume", "audiogain");
   audio_bin = gst_bin_new ("audiosinkbin");
   gst_bin_add_many (GST_BIN (audio_bin),
                     bvw->priv->audio_capsfilter,
+                    bvw->priv->audio_gain,
 		    audio_sink, NULL);
   gst_element_link_many (bvw->priv->audio_capsfilter,
+			 bvw->priv->audio_gain,
 			 audio_sink,
 			 NULL);
 
@@ -5670,6 +7694,11 @@ bacon_video_widget_initable_init (GInitable     *initable,
   gst_element_add_pad (audio_bin, gst_ghost_pad_new ("sink", audio_pad));
   gst_object_unref (audio_pad);
 
+  /* Keep them around, playbin drops them when switching to passthrough */
+  bvw->priv->audio_bin = gst_object_ref_sink (audio_bin);
+  bvw->priv->audio_sink = audio_sink;
+  gst_object_ref_sink (bvw->priv->audio_pitchcontrol);
+
   /* And tell playbin */
   g_object_set (bvw->priv->play, "audio-sink", audio_bin, NULL);
   g_object_set (bvw->priv->play, "audio-filter", bvw->priv->audio_pitchcontrol, NULL);
@@ -5741,7 +7770,12 @@ bacon_video_widget_get_rate (BaconVideoWidget *bvw)
  * @bvw: a #BaconVideoWidget
  * @new_rate: the new playback rate
  *
- * Sets the current playback rate.
+ * Sets the current playback rate. Negative rates play the stream
+ * backwards.
+ *
+ * Above 2x, in either direction, only keyframes are decoded and
+ * the audio is dropped, so that fast shuttling through a stream is
+ * cheaper than playing it back at normal speed.
  *
  * Returns: %TRUE on success, %FALSE on failure.
  **/
@@ -5750,29 +7784,47 @@ bacon_video_widget_set_rate (BaconVideoWidget *bvw,
 			     gfloat            new_rate)
 {
   GstEvent *event;
+  GstSeekFlags flags;
   gboolean retval = FALSE;
+  gboolean trickmode;
   gint64 cur;
 
   g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), FALSE);
   g_return_val_if_fail (GST_IS_ELEMENT (bvw->priv->play), FALSE);
 
   /* set upper and lower limit for rate */
-  if (new_rate <= 0.1)
+  if (fabs (new_rate) <= MIN_PLAYBACK_RATE)
 	return TRUE;
-  if (new_rate >= 10.0)
+  if (fabs (new_rate) > MAX_PLAYBACK_RATE)
 	return TRUE;
 
+  trickmode = (fabs (new_rate) > TRICKMODE_RATE_THRESHOLD);
+
+  flags = GST_SEEK_FLAG_FLUSH;
+  if (trickmode)
+    flags |= TRICKMODE_SEEK_FLAGS;
+  else
+    flags |= GST_SEEK_FLAG_ACCURATE;
+
   if (gst_element_query_position (bvw->priv->play, GST_FORMAT_TIME, &cur)) {
-    GST_DEBUG ("Setting new rate at %"G_GINT64_FORMAT"", cur);
-    event = gst_event_new_seek (new_rate,
-				GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
-				GST_SEEK_TYPE_SET, cur,
-				GST_SEEK_TYPE_SET, GST_CLOCK_TIME_NONE);
+    GST_DEBUG ("Setting new rate %f at %"G_GINT64_FORMAT"", new_rate, cur);
+    if (new_rate > 0.0) {
+      event = gst_event_new_seek (new_rate,
+				  GST_FORMAT_TIME, flags,
+				  GST_SEEK_TYPE_SET, cur,
+				  GST_SEEK_TYPE_SET, GST_CLOCK_TIME_NONE);
+    } else {
+      event = gst_event_new_seek (new_rate,
+				  GST_FORMAT_TIME, flags,
+				  GST_SEEK_TYPE_SET, G_GINT64_CONSTANT (0),
+				  GST_SEEK_TYPE_SET, cur);
+    }
     if (gst_element_send_event (bvw->priv->play, event) == FALSE) {
       GST_DEBUG ("Failed to change rate");
     } else {
       gst_element_get_state (bvw->priv->play, NULL, NULL, GST_CLOCK_TIME_NONE);
       bvw->priv->rate = new_rate;
+      bvw_set_trickmode (bvw, trickmode);
       retval = TRUE;
     }
   } else {
@@ -5782,6 +7834,89 @@ bacon_video_widget_set_rate (BaconVideoWidget *bvw,
   return retval;
 }
 
+/**
+ * bacon_video_widget_get_stats:
+ * @bvw: a #BaconVideoWidget
+ * @stats: (out caller-allocates): a #BvwStats to fill in
+ *
+ * Gets the latest playback statistics for the current stream. The frame
+ * counters are always kept up-to-date, the other values are refreshed once
+ * a second during playback if the statistics are shown, or something is
+ * connected to #BaconVideoWidget::stats-updated.
+ **/
+void
+bacon_video_widget_get_stats (BaconVideoWidget *bvw,
+			      BvwStats         *stats)
+{
+  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
+  g_return_if_fail (stats != NULL);
+
+  *stats = bvw->priv->stats;
+}
+
+/**
+ * bacon_video_widget_set_show_stats:
+ * @bvw: a #BaconVideoWidget
+ * @show_stats: %TRUE to overlay the playback statistics on the video
+ *
+ * Sets whether the playback statistics should be shown on top of the video,
+ * to help diagnosing stuttering playback.
+ **/
+void
+bacon_video_widget_set_show_stats (BaconVideoWidget *bvw,
+				   gboolean          show_stats)
+{
+  g_return_if_fail (BACON_IS_VIDEO_WIDGET (bvw));
+
+  show_stats = (show_stats != FALSE);
+  if (bvw->priv->show_stats == show_stats)
+    return;
+
+  bvw->priv->show_stats = show_stats;
+
+  if (show_stats && bvw->priv->stats_text == NULL) {
+    ClutterColor bg = { 0x00, 0x00, 0x00, 0xa0 };
+
+    bvw->priv->stats_text = clutter_text_new_full ("Monospace 9", "", CLUTTER_COLOR_White);
+    clutter_actor_set_name (bvw->priv->stats_text, "stats");
+    clutter_actor_set_background_color (bvw->priv->stats_text, &bg);
+    clutter_actor_set_x_align (bvw->priv->stats_text, CLUTTER_ACTOR_ALIGN_END);
+    clutter_actor_set_y_align (bvw->priv->stats_text, CLUTTER_ACTOR_ALIGN_START);
+    clutter_actor_set_margin_top (bvw->priv->stats_text, OSD_MARGIN);
+    clutter_actor_set_margin_right (bvw->priv->stats_text, OSD_MARGIN);
+    clutter_actor_add_child (bvw->priv->stage, bvw->priv->stats_text);
+    clutter_actor_set_child_above_sibling (bvw->priv->stage,
+					   bvw->priv->stats_text,
+					   NULL);
+  }
+
+  if (show_stats) {
+    bvw_update_stats (bvw);
+    bvw_update_stats_text (bvw);
+    clutter_actor_show (bvw->priv->stats_text);
+  } else if (bvw->priv->stats_text != NULL) {
+    clutter_actor_hide (bvw->priv->stats_text);
+  }
+
+  g_object_notify (G_OBJECT (bvw), "show-stats");
+}
+
+/**
+ * bacon_video_widget_get_show_stats:
+ * @bvw: a #BaconVideoWidget
+ *
+ * Returns whether the playback statistics are shown on top of the video.
+ *
+ * Returns: %TRUE if the statistics are shown
+ **/
+gboolean
+bacon_video_widget_get_show_stats (BaconVideoWidget *bvw)
+{
+  g_return_val_if_fail (BACON_IS_VIDEO_WIDGET (bvw), FALSE);
+
+  return bvw->priv->show_stats;
+}
+
 /*
  * vim: sw=2 ts=8 cindent noai bs=2
  */
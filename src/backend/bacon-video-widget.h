@@ -65,12 +65,14 @@ typedef struct {
 	void (*error) (GtkWidget *bvw, const char *message, gboolean playback_stopped);
 	void (*eos) (GtkWidget *bvw);
 	void (*got_metadata) (GtkWidget *bvw);
+	void (*metadata_changed) (GtkWidget *bvw, guint changed);
 	void (*got_redirect) (GtkWidget *bvw, const char *mrl);
 	void (*channels_change) (GtkWidget *bvw);
 	void (*tick) (GtkWidget *bvw, gint64 current_time, gint64 stream_length,
 			double current_position, gboolean seekable);
 	void (*buffering) (GtkWidget *bvw, gdouble percentage);
 	void (*download_buffering) (GtkWidget *bvw, gdouble percentage);
+	void (*stats_updated) (GtkWidget *bvw);
 } BaconVideoWidgetClass;
 
 /**
@@ -125,6 +127,7 @@ typedef enum {
 GQuark bacon_video_widget_error_quark		 (void) G_GNUC_CONST;
 GType bacon_video_widget_get_type                (void);
 GOptionGroup* bacon_video_widget_get_option_group (void);
+void bacon_video_widget_preload			 (void);
 
 GtkWidget *bacon_video_widget_new		 (GError **error);
 
@@ -165,6 +168,13 @@ double bacon_video_widget_get_volume             (BaconVideoWidget *bvw);
 /* Properties */
 void bacon_video_widget_set_text_subtitle	(BaconVideoWidget * bvw,
 						 const gchar * subtitle_uri);
+char *bacon_video_widget_get_subtitle_text_at	 (BaconVideoWidget *bvw,
+						  gint64 _time);
+gint64 bacon_video_widget_get_next_subtitle_time (BaconVideoWidget *bvw,
+						  gint64 _time);
+gint64 bacon_video_widget_find_subtitle		 (BaconVideoWidget *bvw,
+						  const char *text,
+						  gint64 from_time);
 void bacon_video_widget_set_logo		 (BaconVideoWidget *bvw,
 						  const char *name);
 void  bacon_video_widget_set_logo_mode		 (BaconVideoWidget *bvw,
@@ -193,6 +203,23 @@ void bacon_video_widget_set_user_agent           (BaconVideoWidget *bvw,
 void bacon_video_widget_set_referrer             (BaconVideoWidget *bvw,
                                                   const char *referrer);
 
+/**
+ * BvwBufferingMode:
+ * @BVW_BUFFERING_DOWNLOAD: download streams to a temporary file
+ * @BVW_BUFFERING_RING: keep streams in a ring buffer in memory
+ *
+ * How network streams are buffered, see bacon_video_widget_set_buffering_mode().
+ **/
+typedef enum {
+	BVW_BUFFERING_DOWNLOAD,
+	BVW_BUFFERING_RING
+} BvwBufferingMode;
+
+void bacon_video_widget_set_buffering_mode       (BaconVideoWidget *bvw,
+                                                  BvwBufferingMode mode);
+BvwBufferingMode bacon_video_widget_get_buffering_mode
+                                                 (BaconVideoWidget *bvw);
+
 gboolean bacon_video_widget_set_rate		 (BaconVideoWidget *bvw,
 						  gfloat new_rate);
 gfloat bacon_video_widget_get_rate		 (BaconVideoWidget *bvw);
@@ -253,6 +280,38 @@ void bacon_video_widget_get_metadata		 (BaconVideoWidget *bvw,
 						  BvwMetadataType type,
 						  GValue *value);
 
+/**
+ * BvwMetadataChangeFlags:
+ * @BVW_METADATA_CHANGED_NONE: nothing changed
+ * @BVW_METADATA_CHANGED_TITLE: the stream's title changed
+ * @BVW_METADATA_CHANGED_ARTIST: the artist changed
+ * @BVW_METADATA_CHANGED_ALBUM: the album changed
+ * @BVW_METADATA_CHANGED_YEAR: the date of the work changed
+ * @BVW_METADATA_CHANGED_COMMENT: the comment changed
+ * @BVW_METADATA_CHANGED_TRACK_NUMBER: the track number changed
+ * @BVW_METADATA_CHANGED_COVER: the cover artwork changed
+ * @BVW_METADATA_CHANGED_ORIENTATION: the video orientation changed
+ * @BVW_METADATA_CHANGED_STREAM_INFO: codecs, bitrates, container or stream
+ * layout changed
+ * @BVW_METADATA_CHANGED_OTHER: any other tag changed
+ *
+ * The metadata fields which changed, as passed to the
+ * #BaconVideoWidget::metadata-changed signal.
+ **/
+typedef enum {
+	BVW_METADATA_CHANGED_NONE         = 0,
+	BVW_METADATA_CHANGED_TITLE        = 1 << 0,
+	BVW_METADATA_CHANGED_ARTIST       = 1 << 1,
+	BVW_METADATA_CHANGED_ALBUM        = 1 << 2,
+	BVW_METADATA_CHANGED_YEAR         = 1 << 3,
+	BVW_METADATA_CHANGED_COMMENT      = 1 << 4,
+	BVW_METADATA_CHANGED_TRACK_NUMBER = 1 << 5,
+	BVW_METADATA_CHANGED_COVER        = 1 << 6,
+	BVW_METADATA_CHANGED_ORIENTATION  = 1 << 7,
+	BVW_METADATA_CHANGED_STREAM_INFO  = 1 << 8,
+	BVW_METADATA_CHANGED_OTHER        = 1 << 9
+} BvwMetadataChangeFlags;
+
 /* Picture settings */
 /**
  * BvwVideoProperty:
@@ -324,6 +383,14 @@ void bacon_video_widget_set_deinterlacing        (BaconVideoWidget *bvw,
 						  gboolean deinterlace);
 gboolean bacon_video_widget_get_deinterlacing    (BaconVideoWidget *bvw);
 
+void bacon_video_widget_set_adaptive_quality     (BaconVideoWidget *bvw,
+						  gboolean adaptive_quality);
+gboolean bacon_video_widget_get_adaptive_quality (BaconVideoWidget *bvw);
+
+void bacon_video_widget_set_loudness_normalization (BaconVideoWidget *bvw,
+						    gboolean normalize);
+gboolean bacon_video_widget_get_loudness_normalization (BaconVideoWidget *bvw);
+
 void bacon_video_widget_set_aspect_ratio         (BaconVideoWidget *bvw,
 						  BvwAspectRatio ratio);
 BvwAspectRatio bacon_video_widget_get_aspect_ratio
@@ -440,6 +507,52 @@ void bacon_video_widget_set_audio_output_type    (BaconVideoWidget *bvw,
 /* OSD */
 void bacon_video_widget_show_osd (BaconVideoWidget *bvw, const char *icon_name, const char *message);
 
+/* Statistics */
+/**
+ * BvwStats:
+ * @rendered_frames: the number of video frames rendered, as reported by the video sink
+ * @dropped_frames: the number of video frames dropped because they were late
+ * @proportion: the last QoS proportion, above 1.0 the machine can't keep up
+ * @jitter: how late the last rendered frame was, in nanoseconds (negative when early)
+ * @latency: the minimum latency of the pipeline, in nanoseconds
+ * @buffer_percent: the fill level of the playback queues, in percent, or -1
+ * @input_rate: the rate at which data comes into the buffering queue, in bytes per second, or -1
+ * @bitrate: the bitrate of the current streams, in bits per second, or 0 if unknown
+ * @seek_latency: the time between the last seek and its first frame, in milliseconds, or -1
+ * @preroll_time: the time between opening the stream and its first frame, in milliseconds, or -1
+ * @quality_level: how many steps the adaptive quality controller has degraded playback, 0 for full quality
+ * @stage_paints: the number of times the stage was painted, for the video or anything else on it, such as the OSD
+ * @clipped_paints: how many of those paints only covered part of the stage, such as the video or the OSD alone
+ * @paint_time: the average time spent painting, since the last refresh, in microseconds
+ * @paint_interval: the longest time between two paints, since the last refresh, in milliseconds
+ *
+ * Live statistics about the playback pipeline, as returned by
+ * bacon_video_widget_get_stats().
+ **/
+typedef struct {
+	guint64 rendered_frames;
+	guint64 dropped_frames;
+	gdouble proportion;
+	gint64  jitter;
+	gint64  latency;
+	gint    buffer_percent;
+	gint64  input_rate;
+	guint   bitrate;
+	gint64  seek_latency;
+	gint64  preroll_time;
+	guint   quality_level;
+	guint64 stage_paints;
+	guint64 clipped_paints;
+	gint64  paint_time;
+	gint64  paint_interval;
+} BvwStats;
+
+void bacon_video_widget_get_stats		 (BaconVideoWidget *bvw,
+						  BvwStats *stats);
+void bacon_video_widget_set_show_stats		 (BaconVideoWidget *bvw,
+						  gboolean show_stats);
+gboolean bacon_video_widget_get_show_stats	 (BaconVideoWidget *bvw);
+
 G_END_DECLS
 
 #endif				/* HAVE_BACON_VIDEO_WIDGET_H */
@@ -0,0 +1,474 @@
+/*
+ * Benchmark for the playback hot paths of the backend
+ *
+ * Opens files in a BaconVideoWidget and drives it through its public API,
+ * the way the front-end does, timing opening, seeking, frame stepping and
+ * rate changes, and prints the latency percentiles of each scenario as JSON.
+ * The widget needs a display, Xvfb will do on machines without one.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <gtk/gtk.h>
+#include "bacon-video-widget.h"
+#ifdef GDK_WINDOWING_X11
+#include <X11/Xlib.h>
+#endif
+
+/* How long to wait for any single operation to finish, in seconds */
+#define OPERATION_TIMEOUT 30
+
+/* The widget queues up non-accurate seeks closer than this together */
+#define SEEK_SETTLE_TIME 150
+
+static char **filenames = NULL;
+static int n_seeks = 20;
+static int n_steps = 50;
+static int n_runs = 1;
+static char *output = NULL;
+
+static const gfloat rates[] = { 0.5, 2.0, 4.0, 8.0, 16.0, -4.0, 1.0 };
+
+typedef struct {
+	const char *name;
+	GArray *samples; /* gdouble, in milliseconds */
+	guint failures;
+} Scenario;
+
+enum {
+	SCENARIO_OPEN,
+	SCENARIO_SEEK_ACCURATE,
+	SCENARIO_SEEK_KEYFRAME,
+	SCENARIO_STEP,
+	SCENARIO_RATE,
+	SCENARIO_NEXT,
+	N_SCENARIOS
+};
+
+static Scenario scenarios[N_SCENARIOS] = {
+	{ "cold-open", NULL, 0 },
+	{ "seek-accurate", NULL, 0 },
+	{ "seek-keyframe", NULL, 0 },
+	{ "frame-step", NULL, 0 },
+	{ "rate-change", NULL, 0 },
+	{ "playlist-next", NULL, 0 }
+};
+
+/* What the main loop is currently waiting for */
+typedef enum {
+	WAIT_NONE,
+	WAIT_PREROLL,
+	WAIT_SEEK
+} WaitType;
+
+static GMainLoop *loop = NULL;
+static WaitType waiting = WAIT_NONE;
+static gboolean failed = FALSE;
+static guint timeout_id = 0;
+
+static void
+scenario_add (guint id, gdouble msecs)
+{
+	g_array_append_val (scenarios[id].samples, msecs);
+}
+
+static void
+scenario_add_since (guint id, gint64 start)
+{
+	scenario_add (id, (g_get_monotonic_time () - start) / 1000.0);
+}
+
+static void
+stop_waiting (void)
+{
+	waiting = WAIT_NONE;
+	if (g_main_loop_is_running (loop))
+		g_main_loop_quit (loop);
+}
+
+static void
+tick_cb (BaconVideoWidget *bvw,
+	 gint64 current_time,
+	 gint64 stream_length,
+	 double current_position,
+	 gboolean seekable,
+	 gpointer user_data)
+{
+	BvwStats stats;
+
+	if (waiting != WAIT_PREROLL)
+		return;
+
+	/* The widget queries the position as soon as it has prerolled */
+	bacon_video_widget_get_stats (bvw, &stats);
+	if (stats.preroll_time >= 0)
+		stop_waiting ();
+}
+
+static void
+stats_updated_cb (BaconVideoWidget *bvw,
+		  gpointer user_data)
+{
+	/* Only sent outside of playback once a seek is done */
+	if (waiting == WAIT_SEEK)
+		stop_waiting ();
+}
+
+static void
+error_cb (BaconVideoWidget *bvw,
+	  const char *message,
+	  gboolean playback_stopped,
+	  gboolean fatal,
+	  gpointer user_data)
+{
+	g_printerr ("Error: %s\n", message);
+	if (waiting != WAIT_NONE) {
+		failed = TRUE;
+		stop_waiting ();
+	}
+}
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+	g_printerr ("Timed out\n");
+	timeout_id = 0;
+	failed = TRUE;
+	stop_waiting ();
+
+	return FALSE;
+}
+
+/* Runs the main loop until the operation started after setting @waiting
+ * is done, returns FALSE on errors and timeouts */
+static gboolean
+wait_for_operation (void)
+{
+	if (waiting != WAIT_NONE) {
+		timeout_id = g_timeout_add_seconds (OPERATION_TIMEOUT, timeout_cb, NULL);
+		g_main_loop_run (loop);
+		if (timeout_id != 0) {
+			g_source_remove (timeout_id);
+			timeout_id = 0;
+		}
+	}
+
+	if (failed) {
+		failed = FALSE;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+quit_cb (gpointer user_data)
+{
+	g_main_loop_quit (loop);
+	return FALSE;
+}
+
+/* Keeps the main loop running for @msecs, without measuring anything */
+static void
+idle_for (guint msecs)
+{
+	g_timeout_add (msecs, quit_cb, NULL);
+	g_main_loop_run (loop);
+}
+
+static char *
+filename_to_uri (const char *filename)
+{
+	GFile *file;
+	char *uri;
+
+	file = g_file_new_for_commandline_arg (filename);
+	uri = g_file_get_uri (file);
+	g_object_unref (file);
+
+	return uri;
+}
+
+static gboolean
+open_uri (BaconVideoWidget *bvw, const char *filename, guint id)
+{
+	BvwStats stats;
+	char *uri;
+
+	bacon_video_widget_close (bvw);
+
+	uri = filename_to_uri (filename);
+	waiting = WAIT_PREROLL;
+	bacon_video_widget_open (bvw, uri);
+	g_free (uri);
+
+	if (!wait_for_operation ()) {
+		scenarios[id].failures++;
+		return FALSE;
+	}
+
+	bacon_video_widget_get_stats (bvw, &stats);
+	scenario_add (id, stats.preroll_time);
+
+	return TRUE;
+}
+
+static void
+run_seeks (BaconVideoWidget *bvw, GRand *rand, guint id, gboolean accurate)
+{
+	gint64 duration;
+	int i;
+
+	duration = bacon_video_widget_get_stream_length (bvw);
+	if (duration <= 0)
+		return;
+
+	for (i = 0; i < n_seeks; i++) {
+		BvwStats stats;
+		gint64 pos;
+
+		if (!accurate)
+			idle_for (SEEK_SETTLE_TIME);
+
+		pos = (gint64) (g_rand_double (rand) * duration);
+		waiting = WAIT_SEEK;
+		if (!bacon_video_widget_seek_time (bvw, pos, accurate, NULL)) {
+			waiting = WAIT_NONE;
+			scenarios[id].failures++;
+			continue;
+		}
+		if (!wait_for_operation ()) {
+			scenarios[id].failures++;
+			continue;
+		}
+
+		bacon_video_widget_get_stats (bvw, &stats);
+		scenario_add (id, stats.seek_latency);
+	}
+}
+
+/* Frame steps don't go through a state change, so this measures how long
+ * the widget takes to handle the request */
+static void
+run_steps (BaconVideoWidget *bvw)
+{
+	int i;
+
+	waiting = WAIT_SEEK;
+	bacon_video_widget_seek_time (bvw, 0, TRUE, NULL);
+	wait_for_operation ();
+
+	for (i = 0; i < n_steps; i++) {
+		gint64 start;
+
+		start = g_get_monotonic_time ();
+		if (!bacon_video_widget_step (bvw, TRUE, NULL)) {
+			scenarios[SCENARIO_STEP].failures++;
+			break;
+		}
+		scenario_add_since (SCENARIO_STEP, start);
+
+		while (g_main_context_pending (NULL))
+			g_main_context_iteration (NULL, FALSE);
+	}
+}
+
+/* Rate changes wait for the pipeline to settle before returning */
+static void
+run_rates (BaconVideoWidget *bvw)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (rates); i++) {
+		gint64 start;
+
+		start = g_get_monotonic_time ();
+		if (!bacon_video_widget_set_rate (bvw, rates[i])) {
+			scenarios[SCENARIO_RATE].failures++;
+			continue;
+		}
+		scenario_add_since (SCENARIO_RATE, start);
+	}
+}
+
+static gdouble
+percentile (GArray *samples, gdouble p)
+{
+	guint idx;
+
+	idx = (guint) ceil (p / 100.0 * samples->len);
+	if (idx > 0)
+		idx--;
+
+	return g_array_index (samples, gdouble, MIN (idx, samples->len - 1));
+}
+
+static int
+compare_doubles (gconstpointer a, gconstpointer b)
+{
+	gdouble da = *(const gdouble *) a;
+	gdouble db = *(const gdouble *) b;
+
+	return (da > db) - (da < db);
+}
+
+static char *
+scenarios_to_json (void)
+{
+	GString *str;
+	guint i;
+
+	str = g_string_new ("{\n  \"scenarios\": {\n");
+	for (i = 0; i < N_SCENARIOS; i++) {
+		Scenario *sc = &scenarios[i];
+		char buf[5][G_ASCII_DTOSTR_BUF_SIZE];
+
+		g_string_append_printf (str, "    \"%s\": { \"count\": %u, \"failures\": %u",
+					sc->name, sc->samples->len, sc->failures);
+		if (sc->samples->len > 0) {
+			g_array_sort (sc->samples, compare_doubles);
+			/* Don't let the locale put commas in our numbers */
+			g_ascii_formatd (buf[0], sizeof (buf[0]), "%.3f", g_array_index (sc->samples, gdouble, 0));
+			g_ascii_formatd (buf[1], sizeof (buf[1]), "%.3f", percentile (sc->samples, 50));
+			g_ascii_formatd (buf[2], sizeof (buf[2]), "%.3f", percentile (sc->samples, 90));
+			g_ascii_formatd (buf[3], sizeof (buf[3]), "%.3f", percentile (sc->samples, 99));
+			g_ascii_formatd (buf[4], sizeof (buf[4]), "%.3f", g_array_index (sc->samples, gdouble, sc->samples->len - 1));
+			g_string_append_printf (str, ", \"min_ms\": %s, \"p50_ms\": %s, \"p90_ms\": %s, \"p99_ms\": %s, \"max_ms\": %s",
+						buf[0], buf[1], buf[2], buf[3], buf[4]);
+		}
+		g_string_append_printf (str, " }%s\n", i + 1 < N_SCENARIOS ? "," : "");
+	}
+	g_string_append (str, "  }\n}\n");
+
+	return g_string_free (str, FALSE);
+}
+
+static GOptionEntry option_entries [] = {
+	{ "seeks", 0, 0, G_OPTION_ARG_INT, &n_seeks, "Number of random seeks of each kind per file", "N" },
+	{ "steps", 0, 0, G_OPTION_ARG_INT, &n_steps, "Number of frame steps per file", "N" },
+	{ "runs", 0, 0, G_OPTION_ARG_INT, &n_runs, "Number of times to go through the files", "N" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the JSON results to FILE instead of stdout", "FILE" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames, NULL, "FILE..." },
+	{ NULL }
+};
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GtkWidget *win, *bvw;
+	GRand *rand;
+	char *json;
+	guint i, n_files;
+	int run, ret;
+
+#ifdef GDK_WINDOWING_X11
+	XInitThreads ();
+#endif
+
+	if (gtk_clutter_init (NULL, NULL) != CLUTTER_INIT_SUCCESS) {
+		g_printerr ("Failed to initialise Clutter, is there a display?\n");
+		return 1;
+	}
+
+	context = g_option_context_new ("- Benchmark opening, seeking and stepping through files");
+	g_option_context_add_main_entries (context, option_entries, NULL);
+	g_option_context_add_group (context, bacon_video_widget_get_option_group ());
+	g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+	if (g_option_context_parse (context, &argc, &argv, &error) == FALSE) {
+		g_printerr ("Failed to parse options: %s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+	if (filenames == NULL || filenames[0] == NULL) {
+		char *help;
+		help = g_option_context_get_help (context, TRUE, NULL);
+		g_printerr ("%s", help);
+		g_free (help);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	for (i = 0; i < N_SCENARIOS; i++)
+		scenarios[i].samples = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+	loop = g_main_loop_new (NULL, FALSE);
+	/* Fixed seed, so that runs can be compared */
+	rand = g_rand_new_with_seed (0x78706c79);
+	n_files = g_strv_length (filenames);
+	ret = 0;
+
+	for (run = 0; run < n_runs; run++) {
+		/* A fresh widget for each run, so the first open is cold */
+		bvw = bacon_video_widget_new (&error);
+		if (bvw == NULL) {
+			g_printerr ("Failed to create the video widget: %s\n", error->message);
+			g_error_free (error);
+			ret = 1;
+			break;
+		}
+
+		g_signal_connect (G_OBJECT (bvw), "tick", G_CALLBACK (tick_cb), NULL);
+		g_signal_connect (G_OBJECT (bvw), "stats-updated", G_CALLBACK (stats_updated_cb), NULL);
+		g_signal_connect (G_OBJECT (bvw), "error", G_CALLBACK (error_cb), NULL);
+
+		win = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+		gtk_window_set_default_size (GTK_WINDOW (win), 640, 360);
+		gtk_container_add (GTK_CONTAINER (win), bvw);
+		gtk_widget_show_all (win);
+
+		for (i = 0; i < n_files; i++) {
+			if (!open_uri (BACON_VIDEO_WIDGET (bvw), filenames[i], i == 0 ? SCENARIO_OPEN : SCENARIO_NEXT))
+				continue;
+
+			run_seeks (BACON_VIDEO_WIDGET (bvw), rand, SCENARIO_SEEK_ACCURATE, TRUE);
+			run_seeks (BACON_VIDEO_WIDGET (bvw), rand, SCENARIO_SEEK_KEYFRAME, FALSE);
+			run_steps (BACON_VIDEO_WIDGET (bvw));
+			run_rates (BACON_VIDEO_WIDGET (bvw));
+		}
+
+		bacon_video_widget_close (BACON_VIDEO_WIDGET (bvw));
+		gtk_widget_destroy (win);
+	}
+
+	if (ret == 0) {
+		json = scenarios_to_json ();
+		if (output != NULL) {
+			if (!g_file_set_contents (output, json, -1, &error)) {
+				g_printerr ("Failed to write %s: %s\n", output, error->message);
+				g_error_free (error);
+				ret = 1;
+			}
+		} else {
+			g_print ("%s", json);
+		}
+		g_free (json);
+	}
+
+	g_rand_free (rand);
+	g_main_loop_unref (loop);
+	for (i = 0; i < N_SCENARIOS; i++)
+		g_array_free (scenarios[i].samples, TRUE);
+
+	return ret;
+}
@@ -58,6 +58,9 @@ typedef struct {
         GtkIconTheme       *theme;
         const char         *icon_name;
         const char         *message;
+
+        /* icon names to rendered icons, or %NULL not to cache them */
+        GHashTable         *icons;
 } GsdOsdDrawContext;
 
 void gsd_osd_window_draw (GsdOsdDrawContext *ctx, cairo_t *cr);
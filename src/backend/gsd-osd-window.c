@@ -209,6 +209,29 @@ load_pixbuf (GsdOsdDrawContext *ctx,
         return pixbuf;
 }
 
+/* Looks the icon up in the context's cache first, so that the theme
+ * lookup and the recolouring of symbolic icons only happen once */
+static GdkPixbuf *
+lookup_pixbuf (GsdOsdDrawContext *ctx,
+               const char        *name,
+               int                icon_size)
+{
+        GdkPixbuf *pixbuf;
+
+        if (ctx->icons == NULL)
+                return load_pixbuf (ctx, name, icon_size);
+
+        if (g_hash_table_lookup_extended (ctx->icons, name, NULL, (gpointer *) &pixbuf))
+                return pixbuf ? g_object_ref (pixbuf) : NULL;
+
+        /* Failures are cached too, so as not to warn every time */
+        pixbuf = load_pixbuf (ctx, name, icon_size);
+        g_hash_table_insert (ctx->icons, g_strdup (name),
+                             pixbuf ? g_object_ref (pixbuf) : NULL);
+
+        return pixbuf;
+}
+
 static void
 draw_action_custom (GsdOsdDrawContext  *ctx,
                     cairo_t            *cr)
@@ -234,7 +257,7 @@ draw_action_custom (GsdOsdDrawContext  *ctx,
 
         if (ctx->icon_name)
         {
-            pixbuf = load_pixbuf (ctx, ctx->icon_name, icon_size);
+            pixbuf = lookup_pixbuf (ctx, ctx->icon_name, icon_size);
             if (pixbuf == NULL)
             {
                 char *name;
@@ -246,7 +269,7 @@ draw_action_custom (GsdOsdDrawContext  *ctx,
                 {
                     name = g_strdup_printf ("%s-ltr", ctx->icon_name);
                 }
-                pixbuf = load_pixbuf (ctx, name, icon_size);
+                pixbuf = lookup_pixbuf (ctx, name, icon_size);
                 g_free (name);
                 if (pixbuf == NULL)
                 {
@@ -320,6 +343,7 @@ gsd_osd_window_obj_draw (GtkWidget *widget,
         ctx.height = height;
         ctx.style = context;
         ctx.icon_name = window->priv->icon_name;
+        ctx.icons = NULL;
         ctx.direction = gtk_widget_get_direction (GTK_WIDGET (window));
         if (window != NULL && gtk_widget_has_screen (GTK_WIDGET (window))) {
                 ctx.theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (window)));
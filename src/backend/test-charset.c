@@ -0,0 +1,227 @@
+/*
+ * Checks the character set detection of subtitle files on subtitles
+ * converted to each family of encodings it tells apart
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "bacon-video-charset.h"
+
+#define N_LINES 3
+
+typedef struct {
+	const char *lines[N_LINES];
+} Text;
+
+typedef struct {
+	const Text *text;
+	const char *encoding;  /* what the text is converted to */
+	const char *preferred; /* the user's choice */
+	const char *expected;
+} Case;
+
+static const Text french = { {
+	"Où est la boîte à café ?",
+	"Très bien, merci. C'est déjà l'été !",
+	"Il a répondu à ça ? Français, élève, garçon."
+} };
+
+static const Text turkish = { {
+	"Günaydın, nasılsın?",
+	"Şu anda çok meşgulüm.",
+	"Teşekkür ederim, görüşürüz."
+} };
+
+static const Text russian = { {
+	"Привет, как дела?",
+	"Я не знаю, что сказать.",
+	"Это очень хорошо, спасибо."
+} };
+
+static const Text greek = { {
+	"Καλημέρα, τι κάνεις;",
+	"Δεν ξέρω τι να πω.",
+	"Είναι πολύ καλό, ευχαριστώ."
+} };
+
+static const Text japanese = { {
+	"今日は本当にありがとうございました。",
+	"明日また会いましょう。",
+	"私は学生です。"
+} };
+
+static const Text simplified_chinese = { {
+	"我们今天去哪里吃饭？",
+	"他说他不知道这个问题。",
+	"谢谢你的帮助，再见。"
+} };
+
+static const Text traditional_chinese = { {
+	"我們今天去哪裡吃飯？",
+	"他說他不知道這個問題。",
+	"謝謝你的幫助，再見。"
+} };
+
+static const Text korean = { {
+	"안녕하세요, 만나서 반갑습니다.",
+	"오늘 날씨가 정말 좋네요.",
+	"감사합니다, 다음에 또 봐요."
+} };
+
+static const Text english = { {
+	"Where are you going?",
+	"I don't know, somewhere else.",
+	"Thanks, see you tomorrow."
+} };
+
+/* A SubRip file of @text, in @encoding */
+static char *
+make_subtitles (const Text *text,
+		const char *encoding,
+		gsize      *len)
+{
+	GString *str;
+	GError *error = NULL;
+	char *data;
+	guint i;
+
+	str = g_string_new (NULL);
+	for (i = 0; i < N_LINES; i++) {
+		g_string_append_printf (str, "%u\n00:00:%02u,000 --> 00:00:%02u,500\n%s\n\n",
+					i + 1, i, i, text->lines[i]);
+	}
+
+	data = g_convert (str->str, str->len, encoding, "UTF-8", NULL, len, &error);
+	g_assert_no_error (error);
+	g_string_free (str, TRUE);
+
+	return data;
+}
+
+static void
+check_cases (const Case *cases,
+	     guint       n_cases)
+{
+	guint i;
+
+	for (i = 0; i < n_cases; i++) {
+		char *data;
+		gsize len;
+
+		data = make_subtitles (cases[i].text, cases[i].encoding, &len);
+		g_assert_cmpstr (bacon_video_charset_detect (data, len, cases[i].preferred), ==, cases[i].expected);
+		g_free (data);
+	}
+}
+
+static void
+test_unicode (void)
+{
+	static const Case cases[] = {
+		{ &english, "UTF-8", "ISO-8859-15", "UTF-8" },
+		{ &french, "UTF-8", "ISO-8859-15", "UTF-8" },
+		{ &russian, "UTF-8", "WINDOWS-1251", "UTF-8" },
+		/* Without byte order marks */
+		{ &english, "UTF-16LE", NULL, "UTF-16LE" },
+		{ &english, "UTF-16BE", NULL, "UTF-16BE" }
+	};
+
+	check_cases (cases, G_N_ELEMENTS (cases));
+}
+
+static void
+test_byte_order_marks (void)
+{
+	static const struct {
+		const char *data;
+		gsize       len;
+		const char *expected;
+	} cases[] = {
+		{ "\xef\xbb\xbf" "1\n", 5, "UTF-8" },
+		{ "\xff\xfe" "1\0\n\0", 6, "UTF-16LE" },
+		{ "\xfe\xff" "\0" "1\0\n", 6, "UTF-16BE" },
+		{ "\xff\xfe\0\0" "1\0\0\0", 8, "UTF-32LE" },
+		{ "\0\0\xfe\xff" "\0\0\0" "1", 8, "UTF-32BE" }
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (cases); i++)
+		g_assert_cmpstr (bacon_video_charset_detect (cases[i].data, cases[i].len, "ISO-8859-15"), ==, cases[i].expected);
+}
+
+static void
+test_single_byte (void)
+{
+	static const Case cases[] = {
+		{ &french, "WINDOWS-1252", NULL, "WINDOWS-1252" },
+		{ &turkish, "WINDOWS-1254", NULL, "WINDOWS-1254" },
+		{ &russian, "WINDOWS-1251", NULL, "WINDOWS-1251" },
+		{ &russian, "KOI8-R", NULL, "KOI8-R" },
+		{ &russian, "ISO-8859-5", NULL, "ISO-8859-5" },
+		{ &russian, "CP866", NULL, "CP866" },
+		{ &greek, "WINDOWS-1253", NULL, "WINDOWS-1253" }
+	};
+
+	check_cases (cases, G_N_ELEMENTS (cases));
+}
+
+/* The user's choice breaks ties between encodings that are the same
+ * for those letters, but doesn't override a clear winner */
+static void
+test_preferred (void)
+{
+	static const Case cases[] = {
+		{ &french, "WINDOWS-1252", "ISO-8859-15", "ISO-8859-15" },
+		{ &greek, "ISO-8859-7", "ISO-8859-7", "ISO-8859-7" },
+		{ &russian, "KOI8-R", "WINDOWS-1251", "KOI8-R" },
+		{ &english, "ASCII", "WINDOWS-1251", "UTF-8" }
+	};
+
+	check_cases (cases, G_N_ELEMENTS (cases));
+}
+
+static void
+test_multi_byte (void)
+{
+	static const Case cases[] = {
+		{ &japanese, "SHIFT-JIS", NULL, "SHIFT-JIS" },
+		{ &japanese, "EUC-JP", NULL, "EUC-JP" },
+		{ &japanese, "ISO-2022-JP", NULL, "ISO-2022-JP" },
+		{ &simplified_chinese, "GB18030", NULL, "GB18030" },
+		{ &traditional_chinese, "BIG5", NULL, "BIG5" },
+		{ &korean, "EUC-KR", NULL, "EUC-KR" }
+	};
+
+	check_cases (cases, G_N_ELEMENTS (cases));
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/charset/unicode", test_unicode);
+	g_test_add_func ("/charset/byte-order-marks", test_byte_order_marks);
+	g_test_add_func ("/charset/single-byte", test_single_byte);
+	g_test_add_func ("/charset/preferred", test_preferred);
+	g_test_add_func ("/charset/multi-byte", test_multi_byte);
+
+	return g_test_run ();
+}
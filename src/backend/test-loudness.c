@@ -0,0 +1,166 @@
+/*
+ * Checks the loudness measurement and the gain computed from it against
+ * signals whose EBU R 128 loudness is known
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+/* Built with the measurement code, to reach its static functions */
+#include "bacon-video-loudness.c"
+
+#define TONE_FREQUENCY 997.0
+
+static void
+analysis_init (Analysis *analysis)
+{
+	GstCaps *caps;
+
+	memset (analysis, 0, sizeof (*analysis));
+	analysis->blocks = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+	caps = gst_caps_new_simple ("audio/x-raw",
+				    "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
+				    "layout", G_TYPE_STRING, "interleaved",
+				    "rate", G_TYPE_INT, ANALYSIS_RATE,
+				    "channels", G_TYPE_INT, 2,
+				    "channel-mask", GST_TYPE_BITMASK, (guint64) 0x3,
+				    NULL);
+	analysis_configure (analysis, caps);
+	gst_caps_unref (caps);
+
+	g_assert_cmpuint (analysis->channels, ==, 2);
+}
+
+static void
+analysis_clear (Analysis *analysis)
+{
+	gst_caps_replace (&analysis->caps, NULL);
+	g_array_free (analysis->blocks, TRUE);
+}
+
+/* Feeds @seconds of a stereo tone at @level dBFS, or of silence if
+ * @level is 0, continuing from @frame */
+static void
+feed_tone (Analysis *analysis, gdouble level, guint seconds, guint64 *frame)
+{
+	gfloat samples[2 * SUB_BLOCK_FRAMES];
+	gdouble amplitude;
+	guint i, j;
+
+	amplitude = (level < 0.0) ? pow (10.0, level / 20.0) : 0.0;
+
+	for (i = 0; i < seconds * 10; i++) {
+		for (j = 0; j < SUB_BLOCK_FRAMES; j++) {
+			gfloat sample;
+
+			sample = amplitude * sin (2.0 * G_PI * TONE_FREQUENCY * (*frame)++ / ANALYSIS_RATE);
+			samples[2 * j] = samples[2 * j + 1] = sample;
+		}
+		analysis_process (analysis, samples, SUB_BLOCK_FRAMES);
+	}
+}
+
+static void
+test_loudness_tone (void)
+{
+	Analysis analysis;
+	guint64 frame = 0;
+	gdouble loudness;
+
+	/* A stereo tone at -23 dBFS measures -23 LUFS */
+	analysis_init (&analysis);
+	feed_tone (&analysis, -23.0, 5, &frame);
+
+	g_assert (analysis_get_loudness (&analysis, &loudness));
+	g_assert_cmpfloat (fabs (loudness - -23.0), <, 0.05);
+	g_assert_cmpfloat (fabs (analysis.peak - pow (10.0, -23.0 / 20.0)), <, 0.001);
+
+	analysis_clear (&analysis);
+}
+
+static void
+test_loudness_gating (void)
+{
+	Analysis analysis;
+	guint64 frame = 0;
+	gdouble loudness;
+
+	/* The quiet parts are 23 LU below the rest, so the relative gate
+	 * leaves them out, and the silence is under the absolute gate */
+	analysis_init (&analysis);
+	feed_tone (&analysis, 0.0, 2, &frame);
+	feed_tone (&analysis, -46.0, 2, &frame);
+	feed_tone (&analysis, -23.0, 20, &frame);
+	feed_tone (&analysis, -46.0, 2, &frame);
+
+	g_assert (analysis_get_loudness (&analysis, &loudness));
+	g_assert_cmpfloat (fabs (loudness - -23.0), <, 0.1);
+
+	analysis_clear (&analysis);
+}
+
+static void
+test_loudness_silence (void)
+{
+	Analysis analysis;
+	guint64 frame = 0;
+	gdouble loudness;
+
+	analysis_init (&analysis);
+	feed_tone (&analysis, 0.0, 2, &frame);
+
+	g_assert (analysis_get_loudness (&analysis, &loudness) == FALSE);
+
+	analysis_clear (&analysis);
+}
+
+static void
+test_loudness_gain (void)
+{
+	BaconVideoLoudness loudness;
+
+	/* 10 LU too quiet */
+	loudness.loudness = -28.0;
+	loudness.peak = 0.0;
+	g_assert_cmpfloat (fabs (bacon_video_loudness_get_gain (&loudness) - pow (10.0, 0.5)), <, 0.0001);
+
+	/* ...but the peak would clip above twice the volume */
+	loudness.peak = 0.5;
+	g_assert_cmpfloat (fabs (bacon_video_loudness_get_gain (&loudness) - 2.0), <, 0.0001);
+
+	/* 10 LU too loud */
+	loudness.loudness = -8.0;
+	loudness.peak = 1.0;
+	g_assert_cmpfloat (fabs (bacon_video_loudness_get_gain (&loudness) - pow (10.0, -0.5)), <, 0.0001);
+
+	/* Never more than the volume element allows */
+	loudness.loudness = -70.0;
+	loudness.peak = 0.0;
+	g_assert_cmpfloat (bacon_video_loudness_get_gain (&loudness), ==, MAX_GAIN);
+}
+
+int
+main (int argc, char **argv)
+{
+	gst_init (&argc, &argv);
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/loudness/tone", test_loudness_tone);
+	g_test_add_func ("/loudness/gating", test_loudness_gating);
+	g_test_add_func ("/loudness/silence", test_loudness_silence);
+	g_test_add_func ("/loudness/gain", test_loudness_gain);
+
+	return g_test_run ();
+}
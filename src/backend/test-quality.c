@@ -0,0 +1,151 @@
+/*
+ * Checks that the adaptive quality controller steps the quality down when
+ * frames keep being dropped, and back up once they are not
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "bacon-video-quality.h"
+
+#define LOWEST_LEVEL 3
+/* Frames rendered in each one-second interval */
+#define FRAMES_PER_INTERVAL 25
+
+typedef struct {
+	BaconVideoQuality quality;
+	guint64 rendered;
+	guint64 dropped;
+	guint level;
+} Fixture;
+
+static void
+fixture_init (Fixture *fixture)
+{
+	fixture->rendered = fixture->dropped = 0;
+	fixture->level = 0;
+	bacon_video_quality_reset (&fixture->quality, 0, 0);
+}
+
+/* Runs @n intervals, each adding @rendered and @dropped frames to the
+ * sink's counters, and returns the level after them */
+static guint
+run_intervals (Fixture *fixture, guint n, guint64 rendered, guint64 dropped)
+{
+	guint i;
+
+	for (i = 0; i < n; i++) {
+		fixture->rendered += rendered;
+		fixture->dropped += dropped;
+		fixture->level = bacon_video_quality_update (&fixture->quality,
+							     fixture->rendered,
+							     fixture->dropped,
+							     fixture->level,
+							     LOWEST_LEVEL);
+	}
+
+	return fixture->level;
+}
+
+static void
+test_quality_step_down_and_up (void)
+{
+	Fixture fixture;
+
+	fixture_init (&fixture);
+
+	/* A fifth of the frames dropped, three intervals in a row */
+	g_assert_cmpuint (run_intervals (&fixture, 2, 20, 5), ==, 0);
+	g_assert_cmpuint (run_intervals (&fixture, 1, 20, 5), ==, 1);
+	g_assert_cmpuint (run_intervals (&fixture, 3, 20, 5), ==, 2);
+
+	/* Frames rendered and none dropped is headroom */
+	g_assert_cmpuint (run_intervals (&fixture, 9, FRAMES_PER_INTERVAL, 0), ==, 2);
+	g_assert_cmpuint (run_intervals (&fixture, 1, FRAMES_PER_INTERVAL, 0), ==, 1);
+	g_assert_cmpuint (run_intervals (&fixture, 10, FRAMES_PER_INTERVAL, 0), ==, 0);
+
+	/* Never above full quality */
+	g_assert_cmpuint (run_intervals (&fixture, 20, FRAMES_PER_INTERVAL, 0), ==, 0);
+}
+
+static void
+test_quality_lowest (void)
+{
+	Fixture fixture;
+
+	fixture_init (&fixture);
+
+	g_assert_cmpuint (run_intervals (&fixture, 3 * LOWEST_LEVEL, 10, 10), ==, LOWEST_LEVEL);
+	g_assert_cmpuint (run_intervals (&fixture, 10, 10, 10), ==, LOWEST_LEVEL);
+}
+
+static void
+test_quality_streaks (void)
+{
+	Fixture fixture;
+
+	fixture_init (&fixture);
+
+	/* A good interval breaks a bad streak */
+	run_intervals (&fixture, 2, 20, 5);
+	run_intervals (&fixture, 1, FRAMES_PER_INTERVAL, 0);
+	g_assert_cmpuint (run_intervals (&fixture, 2, 20, 5), ==, 0);
+	g_assert_cmpuint (run_intervals (&fixture, 1, 20, 5), ==, 1);
+
+	/* ...and a single dropped frame a good one */
+	run_intervals (&fixture, 9, FRAMES_PER_INTERVAL, 0);
+	run_intervals (&fixture, 1, FRAMES_PER_INTERVAL - 1, 1);
+	g_assert_cmpuint (run_intervals (&fixture, 9, FRAMES_PER_INTERVAL, 0), ==, 1);
+	g_assert_cmpuint (run_intervals (&fixture, 1, FRAMES_PER_INTERVAL, 0), ==, 0);
+
+	/* Intervals without any frames, when paused, don't count */
+	run_intervals (&fixture, 2, 20, 5);
+	run_intervals (&fixture, 5, 0, 0);
+	g_assert_cmpuint (run_intervals (&fixture, 1, 20, 5), ==, 1);
+}
+
+static void
+test_quality_counter_reset (void)
+{
+	Fixture fixture;
+
+	fixture_init (&fixture);
+	run_intervals (&fixture, 10, FRAMES_PER_INTERVAL, 0);
+
+	/* The sink starts counting from 0 again after a seek, which
+	 * mustn't look like a huge number of frames */
+	fixture.rendered = 0;
+	fixture.dropped = 0;
+	g_assert_cmpuint (run_intervals (&fixture, 1, 5, 5), ==, 0);
+
+	/* ...and counting goes on from there */
+	g_assert_cmpuint (run_intervals (&fixture, 3, 20, 5), ==, 1);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/quality/step-down-and-up", test_quality_step_down_and_up);
+	g_test_add_func ("/quality/lowest", test_quality_lowest);
+	g_test_add_func ("/quality/streaks", test_quality_streaks);
+	g_test_add_func ("/quality/counter-reset", test_quality_counter_reset);
+
+	return g_test_run ();
+}
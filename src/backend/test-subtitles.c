@@ -0,0 +1,224 @@
+/*
+ * Checks the lookups in the subtitle cue index against a plain scan
+ * of the cues, and the searches and text lookups built on them
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "bacon-video-subtitles.h"
+
+#define N_RANDOM_CUES 500
+#define QUERY_STEP 37 /* msecs, so as not to only hit round times */
+
+static const char overlapping_srt[] =
+	"1\n"
+	"00:00:01,000 --> 00:00:04,000\n"
+	"First\n"
+	"\n"
+	"2\n"
+	"00:00:02,000 --> 00:00:03,000\n"
+	"<i>Second</i>\n"
+	"\n"
+	"3\n"
+	"00:00:06,000 --> 00:00:07,000\n"
+	"Third\n";
+
+static BaconVideoSubtitles *
+parse (const char *data)
+{
+	BaconVideoSubtitles *subs;
+	GError *error = NULL;
+
+	subs = bacon_video_subtitles_new_from_data (data, strlen (data), "UTF-8", 0.0, &error);
+	g_assert_no_error (error);
+	g_assert (subs != NULL);
+
+	return subs;
+}
+
+static void
+append_srt_time (GString *str, gint64 msecs)
+{
+	g_string_append_printf (str, "%02u:%02u:%02u,%03u",
+				(guint) (msecs / 3600000),
+				(guint) (msecs / 60000 % 60),
+				(guint) (msecs / 1000 % 60),
+				(guint) (msecs % 1000));
+}
+
+/* Cues of random lengths, some lasting over many of the following
+ * ones, which is what the index has to get right */
+static char *
+make_random_srt (void)
+{
+	GString *str;
+	GRand *rand;
+	gint64 start = 0;
+	guint i;
+
+	rand = g_rand_new_with_seed (32);
+	str = g_string_new (NULL);
+
+	for (i = 0; i < N_RANDOM_CUES; i++) {
+		gint64 duration;
+
+		start += g_rand_int_range (rand, 0, 2000);
+		if (g_rand_int_range (rand, 0, 20) == 0)
+			duration = g_rand_int_range (rand, 10000, 60000);
+		else
+			duration = g_rand_int_range (rand, 1, 4000);
+
+		g_string_append_printf (str, "%u\n", i + 1);
+		append_srt_time (str, start);
+		g_string_append (str, " --> ");
+		append_srt_time (str, start + duration);
+		g_string_append_printf (str, "\nCue %u\n\n", i);
+	}
+
+	g_rand_free (rand);
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+test_cues_at (void)
+{
+	BaconVideoSubtitles *subs;
+	char *srt;
+	gint64 time, last_end = 0;
+	guint i, n_cues;
+
+	srt = make_random_srt ();
+	subs = parse (srt);
+	g_free (srt);
+
+	n_cues = bacon_video_subtitles_get_n_cues (subs);
+	g_assert_cmpuint (n_cues, ==, N_RANDOM_CUES);
+
+	for (i = 0; i < n_cues; i++)
+		last_end = MAX (last_end, bacon_video_subtitles_get_cue (subs, i)->end);
+
+	for (time = -QUERY_STEP; time <= last_end + QUERY_STEP; time += QUERY_STEP) {
+		guint *indices;
+		guint n_found, n_expected = 0;
+
+		indices = bacon_video_subtitles_get_cues_at (subs, time, &n_found);
+		g_assert ((indices == NULL) == (n_found == 0));
+
+		/* The same cues, in the same order, as looking at all of them */
+		for (i = 0; i < n_cues; i++) {
+			const BaconVideoSubtitleCue *cue;
+
+			cue = bacon_video_subtitles_get_cue (subs, i);
+			if (cue->start > time || cue->end <= time)
+				continue;
+
+			g_assert_cmpuint (n_expected, <, n_found);
+			g_assert_cmpuint (indices[n_expected], ==, i);
+			n_expected++;
+		}
+		g_assert_cmpuint (n_found, ==, n_expected);
+
+		g_free (indices);
+	}
+
+	bacon_video_subtitles_unref (subs);
+}
+
+static void
+test_next_cue (void)
+{
+	BaconVideoSubtitles *subs;
+
+	subs = parse (overlapping_srt);
+
+	g_assert_cmpint (bacon_video_subtitles_get_next_cue (subs, 0), ==, 0);
+	g_assert_cmpint (bacon_video_subtitles_get_next_cue (subs, 1000), ==, 1);
+	g_assert_cmpint (bacon_video_subtitles_get_next_cue (subs, 2500), ==, 2);
+	g_assert_cmpint (bacon_video_subtitles_get_next_cue (subs, 6000), ==, -1);
+
+	bacon_video_subtitles_unref (subs);
+}
+
+static void
+test_text_at (void)
+{
+	BaconVideoSubtitles *subs;
+	gint64 next_change;
+	char *text;
+
+	subs = parse (overlapping_srt);
+
+	text = bacon_video_subtitles_get_text_at (subs, 500, &next_change);
+	g_assert_cmpstr (text, ==, NULL);
+	g_assert_cmpint (next_change, ==, 1000);
+
+	/* Both, without the markup, until the second one ends */
+	text = bacon_video_subtitles_get_text_at (subs, 2500, &next_change);
+	g_assert_cmpstr (text, ==, "First\nSecond");
+	g_assert_cmpint (next_change, ==, 3000);
+	g_free (text);
+
+	text = bacon_video_subtitles_get_text_at (subs, 3000, &next_change);
+	g_assert_cmpstr (text, ==, "First");
+	g_assert_cmpint (next_change, ==, 4000);
+	g_free (text);
+
+	text = bacon_video_subtitles_get_text_at (subs, 5000, &next_change);
+	g_assert_cmpstr (text, ==, NULL);
+	g_assert_cmpint (next_change, ==, 6000);
+
+	text = bacon_video_subtitles_get_text_at (subs, 7000, &next_change);
+	g_assert_cmpstr (text, ==, NULL);
+	g_assert_cmpint (next_change, ==, -1);
+
+	bacon_video_subtitles_unref (subs);
+}
+
+static void
+test_find (void)
+{
+	BaconVideoSubtitles *subs;
+
+	subs = parse (overlapping_srt);
+
+	g_assert_cmpint (bacon_video_subtitles_find (subs, "SECOND", 0), ==, 1);
+	g_assert_cmpint (bacon_video_subtitles_find (subs, "i", 0), ==, 0);
+	g_assert_cmpint (bacon_video_subtitles_find (subs, "i", 1001), ==, 2);
+	g_assert_cmpint (bacon_video_subtitles_find (subs, "third", 6000), ==, 2);
+	g_assert_cmpint (bacon_video_subtitles_find (subs, "third", 6001), ==, -1);
+	/* The markup isn't part of the text */
+	g_assert_cmpint (bacon_video_subtitles_find (subs, "<i>", 0), ==, -1);
+
+	bacon_video_subtitles_unref (subs);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/subtitles/cues-at", test_cues_at);
+	g_test_add_func ("/subtitles/next-cue", test_next_cue);
+	g_test_add_func ("/subtitles/text-at", test_text_at);
+	g_test_add_func ("/subtitles/find", test_find);
+
+	return g_test_run ();
+}
@@ -310,6 +310,35 @@ xplayer_aspect_frame_paint (ClutterActor *actor)
     clutter_actor_paint (child);
 }
 
+/* Without a paint volume, Clutter can neither clip the redraws of the
+ * video to where it is, nor cull the frame when painting other parts
+ * of the stage */
+static gboolean
+xplayer_aspect_frame_get_paint_volume (ClutterActor       *actor,
+                                     ClutterPaintVolume *volume)
+{
+  ClutterActor *child;
+  const ClutterPaintVolume *child_volume;
+  XplayerAspectFramePrivate *priv = XPLAYER_ASPECT_FRAME (actor)->priv;
+
+  /* The child is clipped to the frame */
+  if (priv->expand)
+    return clutter_paint_volume_set_from_allocation (volume, actor);
+
+  child = clutter_actor_get_child_at_index (actor, 0);
+  if (!child || !CLUTTER_ACTOR_IS_VISIBLE (child))
+    return TRUE;
+
+  /* Scaled and rotated along with the child */
+  child_volume = clutter_actor_get_transformed_paint_volume (child, actor);
+  if (!child_volume)
+    return FALSE;
+
+  clutter_paint_volume_union (volume, child_volume);
+
+  return TRUE;
+}
+
 static void
 xplayer_aspect_frame_pick (ClutterActor       *actor,
                          const ClutterColor *color)
@@ -356,6 +385,7 @@ xplayer_aspect_frame_class_init (XplayerAspectFrameClass *klass)
   actor_class->get_preferred_height = xplayer_aspect_frame_get_preferred_height;
   actor_class->allocate = xplayer_aspect_frame_allocate;
   actor_class->paint = xplayer_aspect_frame_paint;
+  actor_class->get_paint_volume = xplayer_aspect_frame_get_paint_volume;
   actor_class->pick = xplayer_aspect_frame_pick;
 
   pspec = g_param_spec_boolean ("expand",
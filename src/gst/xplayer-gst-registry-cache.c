@@ -0,0 +1,484 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ *
+ * The Xplayer project hereby grant permission for non-gpl compatible GStreamer
+ * plugins to be used and distributed together with GStreamer and Xplayer. This
+ * permission is above and beyond the permissions granted by the GPL license
+ * Xplayer is covered by.
+ *
+ * Monday 7th February 2005: Christian Schaller: Add exception clause.
+ * See license_change file for details.
+ *
+ */
+
+/*
+ * A cache of what the GStreamer registry holds, kept in the user's cache
+ * directory between runs.
+ *
+ * It remembers the directories the plugins were found in, along with
+ * their modification times, so that when none of them changed since the
+ * last run, GStreamer can be told not to go through every plugin file
+ * looking for changes when it loads its registry.
+ *
+ * It also lists the plugins and the caps the decoders accept,
+ * which is only rebuilt when the hash of the registry's plugin list
+ * changes, so that answering whether a decoder is installed doesn't walk
+ * through all the element factories and their pad templates.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "xplayer-gst-registry-cache.h"
+
+#define CACHE_GROUP_REGISTRY "Registry"
+#define CACHE_GROUP_CAPABILITIES "Capabilities"
+
+static gboolean cache_loaded = FALSE;
+static gboolean cache_valid = FALSE;
+static gboolean update_skipped = FALSE;
+static char *plugins_hash = NULL;
+static char *directories_stamp = NULL;
+static char **directories = NULL;
+static GHashTable *plugins = NULL;
+static GHashTable *decoders = NULL;
+static GstCaps *decoder_caps = NULL; /* decoders, parsed when needed */
+G_LOCK_DEFINE_STATIC (registry_cache);
+
+static char *
+cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "xplayer", "gst-registry", NULL);
+}
+
+static GHashTable *
+string_set_new (char **strings)
+{
+  GHashTable *set;
+  guint i;
+
+  set = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (i = 0; strings != NULL && strings[i] != NULL; i++)
+    g_hash_table_insert (set, g_strdup (strings[i]), GINT_TO_POINTER (TRUE));
+
+  return set;
+}
+
+static char **
+string_set_to_strv (GHashTable *set)
+{
+  GHashTableIter iter;
+  gpointer key;
+  char **strv;
+  guint i = 0;
+
+  strv = g_new0 (char *, g_hash_table_size (set) + 1);
+  g_hash_table_iter_init (&iter, set);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    strv[i++] = g_strdup (key);
+
+  return strv;
+}
+
+/* Called with the lock held */
+static void
+cache_load (void)
+{
+  GKeyFile *keyfile;
+  char *path, **strv;
+
+  if (cache_loaded != FALSE)
+    return;
+  cache_loaded = TRUE;
+
+  keyfile = g_key_file_new ();
+  path = cache_path ();
+  if (g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, NULL) != FALSE) {
+    plugins_hash = g_key_file_get_string (keyfile, CACHE_GROUP_REGISTRY, "PluginsHash", NULL);
+    directories_stamp = g_key_file_get_string (keyfile, CACHE_GROUP_REGISTRY, "DirectoriesStamp", NULL);
+    directories = g_key_file_get_string_list (keyfile, CACHE_GROUP_REGISTRY, "Directories", NULL, NULL);
+
+    strv = g_key_file_get_string_list (keyfile, CACHE_GROUP_CAPABILITIES, "Plugins", NULL, NULL);
+    plugins = string_set_new (strv);
+    g_strfreev (strv);
+
+    /* Rebuilt if missing, as with caches that only had the media types */
+    strv = g_key_file_get_string_list (keyfile, CACHE_GROUP_CAPABILITIES, "DecoderCaps", NULL, NULL);
+    if (strv != NULL)
+      decoders = string_set_new (strv);
+    g_strfreev (strv);
+  }
+  g_free (path);
+  g_key_file_free (keyfile);
+}
+
+/* Called with the lock held */
+static void
+cache_save (void)
+{
+  GKeyFile *keyfile;
+  GError *error = NULL;
+  char *path, *dir, *data, **strv;
+  gsize length;
+
+  keyfile = g_key_file_new ();
+  g_key_file_set_string (keyfile, CACHE_GROUP_REGISTRY, "PluginsHash", plugins_hash);
+  g_key_file_set_string (keyfile, CACHE_GROUP_REGISTRY, "DirectoriesStamp", directories_stamp);
+  g_key_file_set_string_list (keyfile, CACHE_GROUP_REGISTRY, "Directories",
+			      (const char * const *) directories, g_strv_length (directories));
+
+  strv = string_set_to_strv (plugins);
+  g_key_file_set_string_list (keyfile, CACHE_GROUP_CAPABILITIES, "Plugins",
+			      (const char * const *) strv, g_strv_length (strv));
+  g_strfreev (strv);
+
+  strv = string_set_to_strv (decoders);
+  g_key_file_set_string_list (keyfile, CACHE_GROUP_CAPABILITIES, "DecoderCaps",
+			      (const char * const *) strv, g_strv_length (strv));
+  g_strfreev (strv);
+
+  data = g_key_file_to_data (keyfile, &length, NULL);
+  g_key_file_free (keyfile);
+
+  path = cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, 0700);
+  g_free (dir);
+
+  if (g_file_set_contents (path, data, length, &error) == FALSE) {
+    g_warning ("Couldn't save the GStreamer registry cache: %s", error->message);
+    g_error_free (error);
+  }
+  g_free (path);
+  g_free (data);
+}
+
+static void
+checksum_add_directory (GChecksum  *checksum,
+			const char *dir)
+{
+  GStatBuf buf;
+  char *line;
+
+  if (g_stat (dir, &buf) == 0)
+    line = g_strdup_printf ("%s %" G_GINT64_FORMAT "\n", dir, (gint64) buf.st_mtime);
+  else
+    line = g_strdup_printf ("%s missing\n", dir);
+
+  g_checksum_update (checksum, (const guchar *) line, -1);
+  g_free (line);
+}
+
+/* What the plugin files GStreamer would look at depend on, without
+ * GStreamer being initialised: the plugin directories, the registry's,
+ * the environment overriding them, and the version of GStreamer */
+static char *
+compute_directories_stamp (char **dirs)
+{
+  const char *env_vars[] = {
+    "GST_PLUGIN_PATH_1_0",
+    "GST_PLUGIN_PATH",
+    "GST_PLUGIN_SYSTEM_PATH_1_0",
+    "GST_PLUGIN_SYSTEM_PATH",
+    "GST_REGISTRY_1_0",
+    "GST_REGISTRY"
+  };
+  GChecksum *checksum;
+  char *dir, *version, *stamp;
+  guint major, minor, micro, nano;
+  guint i;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  gst_version (&major, &minor, &micro, &nano);
+  version = g_strdup_printf ("%u.%u.%u.%u\n", major, minor, micro, nano);
+  g_checksum_update (checksum, (const guchar *) version, -1);
+  g_free (version);
+
+  for (i = 0; i < G_N_ELEMENTS (env_vars); i++) {
+    const char *value = g_getenv (env_vars[i]);
+
+    g_checksum_update (checksum, (const guchar *) env_vars[i], -1);
+    g_checksum_update (checksum, (const guchar *) (value ? value : ""), strlen (value ? value : "") + 1);
+  }
+
+  /* Where new plugins might appear, and where the registry lives */
+  dir = g_build_filename (g_get_user_data_dir (), "gstreamer-1.0", "plugins", NULL);
+  checksum_add_directory (checksum, dir);
+  g_free (dir);
+  dir = g_build_filename (g_get_user_cache_dir (), "gstreamer-1.0", NULL);
+  checksum_add_directory (checksum, dir);
+  g_free (dir);
+
+  for (i = 0; dirs != NULL && dirs[i] != NULL; i++)
+    checksum_add_directory (checksum, dirs[i]);
+
+  stamp = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return stamp;
+}
+
+static gint
+compare_plugin_names (gconstpointer a,
+		      gconstpointer b)
+{
+  return g_strcmp0 (gst_plugin_get_name (GST_PLUGIN (a)),
+		    gst_plugin_get_name (GST_PLUGIN (b)));
+}
+
+/* Adds each structure of the decoders' sink caps, so that decoders
+ * for other versions of a media type, such as video/mpeg, don't count */
+static void
+add_decoder_caps (GHashTable *set)
+{
+  GList *factories, *l;
+
+  factories = gst_element_factory_list_get_elements (GST_ELEMENT_FACTORY_TYPE_DECODER,
+						     GST_RANK_MARGINAL);
+
+  for (l = factories; l != NULL; l = l->next) {
+    const GList *templates;
+
+    templates = gst_element_factory_get_static_pad_templates (GST_ELEMENT_FACTORY (l->data));
+    for (; templates != NULL; templates = templates->next) {
+      GstStaticPadTemplate *template = templates->data;
+      GstCaps *caps;
+      guint i;
+
+      if (template->direction != GST_PAD_SINK)
+        continue;
+
+      caps = gst_static_caps_get (&template->static_caps);
+      if (!gst_caps_is_any (caps)) {
+        for (i = 0; i < gst_caps_get_size (caps); i++) {
+          char *str = gst_structure_to_string (gst_caps_get_structure (caps, i));
+          g_hash_table_insert (set, str, GINT_TO_POINTER (TRUE));
+        }
+      }
+      gst_caps_unref (caps);
+    }
+  }
+
+  gst_plugin_feature_list_free (factories);
+}
+
+/* Unsets what xplayer_gst_registry_cache_init() set, once gst_init() has
+ * read it, so that it isn't passed on to other programs we run, and so
+ * that later registry updates look at the plugin files. Only done when
+ * it was unset before, as xplayer_gst_registry_cache_init() leaves it
+ * alone otherwise. */
+static void
+restore_registry_update (void)
+{
+  if (update_skipped == FALSE)
+    return;
+
+  g_unsetenv ("GST_REGISTRY_UPDATE");
+  update_skipped = FALSE;
+}
+
+/**
+ * xplayer_gst_registry_cache_init:
+ *
+ * Tells GStreamer not to look for changes in the plugin files when it
+ * loads its registry, if none of the plugin directories changed since
+ * the registry was last cached. Call it before initialising GStreamer,
+ * from the main thread, as it might change the environment, and
+ * xplayer_gst_registry_cache_update() once it's initialised, which
+ * changes it back.
+ **/
+void
+xplayer_gst_registry_cache_init (void)
+{
+  char *stamp;
+
+  /* Leave it to the user if they asked for something */
+  if (g_getenv ("GST_REGISTRY_UPDATE") != NULL)
+    return;
+
+  G_LOCK (registry_cache);
+  cache_load ();
+
+  if (directories_stamp != NULL) {
+    stamp = compute_directories_stamp (directories);
+    if (strcmp (stamp, directories_stamp) == 0) {
+      g_setenv ("GST_REGISTRY_UPDATE", "no", TRUE);
+      update_skipped = TRUE;
+    }
+    g_free (stamp);
+  }
+
+  G_UNLOCK (registry_cache);
+}
+
+/**
+ * xplayer_gst_registry_cache_update:
+ *
+ * Checks the cache against the hash of the registry's plugin list,
+ * rebuilding and saving it if they don't match. Call it once GStreamer
+ * is initialised, and after updating the registry, from the main thread,
+ * as it might change the environment.
+ **/
+void
+xplayer_gst_registry_cache_update (void)
+{
+  GList *plugin_list, *l;
+  GChecksum *checksum;
+  GHashTable *dir_set;
+  gboolean rebuild, save;
+  char *stamp;
+
+  G_LOCK (registry_cache);
+  restore_registry_update ();
+  cache_load ();
+
+  plugin_list = gst_registry_get_plugin_list (gst_registry_get ());
+  plugin_list = g_list_sort (plugin_list, compare_plugin_names);
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  for (l = plugin_list; l != NULL; l = l->next) {
+    GstPlugin *plugin = l->data;
+    char *line;
+
+    line = g_strdup_printf ("%s %s %s\n",
+			    gst_plugin_get_name (plugin),
+			    gst_plugin_get_filename (plugin) ? gst_plugin_get_filename (plugin) : "",
+			    gst_plugin_get_version (plugin));
+    g_checksum_update (checksum, (const guchar *) line, -1);
+    g_free (line);
+  }
+
+  rebuild = (plugins == NULL || decoders == NULL || directories == NULL ||
+	     g_strcmp0 (plugins_hash, g_checksum_get_string (checksum)) != 0);
+
+  if (rebuild != FALSE) {
+    g_free (plugins_hash);
+    plugins_hash = g_strdup (g_checksum_get_string (checksum));
+
+    if (plugins != NULL)
+      g_hash_table_unref (plugins);
+    plugins = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    dir_set = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (l = plugin_list; l != NULL; l = l->next) {
+      GstPlugin *plugin = l->data;
+      const char *filename;
+
+      g_hash_table_insert (plugins, g_strdup (gst_plugin_get_name (plugin)), GINT_TO_POINTER (TRUE));
+      filename = gst_plugin_get_filename (plugin);
+      if (filename != NULL)
+        g_hash_table_insert (dir_set, g_path_get_dirname (filename), GINT_TO_POINTER (TRUE));
+    }
+
+    g_strfreev (directories);
+    directories = string_set_to_strv (dir_set);
+    g_hash_table_unref (dir_set);
+
+    if (decoders != NULL)
+      g_hash_table_unref (decoders);
+    decoders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    add_decoder_caps (decoders);
+    if (decoder_caps != NULL) {
+      gst_caps_unref (decoder_caps);
+      decoder_caps = NULL;
+    }
+  }
+
+  g_checksum_free (checksum);
+  gst_plugin_list_free (plugin_list);
+
+  /* Loading the registry might have rewritten it */
+  stamp = compute_directories_stamp (directories);
+  save = (rebuild != FALSE || g_strcmp0 (stamp, directories_stamp) != 0);
+  g_free (directories_stamp);
+  directories_stamp = stamp;
+
+  if (save != FALSE)
+    cache_save ();
+  cache_valid = TRUE;
+
+  G_UNLOCK (registry_cache);
+}
+
+/**
+ * xplayer_gst_registry_cache_invalidate:
+ *
+ * Lets GStreamer look for changes in the plugin files again, for when
+ * plugins were just installed. Call it from the main thread before
+ * gst_update_registry(), and xplayer_gst_registry_cache_update() after.
+ **/
+void
+xplayer_gst_registry_cache_invalidate (void)
+{
+  G_LOCK (registry_cache);
+  restore_registry_update ();
+  cache_valid = FALSE;
+  G_UNLOCK (registry_cache);
+}
+
+/**
+ * xplayer_gst_registry_cache_has_plugin:
+ * @name: the name of a GStreamer plugin
+ *
+ * Return value: %TRUE if the registry is known to have the plugin, %FALSE
+ * if it doesn't, or if xplayer_gst_registry_cache_update() wasn't called
+ **/
+gboolean
+xplayer_gst_registry_cache_has_plugin (const char *name)
+{
+  gboolean ret;
+
+  G_LOCK (registry_cache);
+  ret = (cache_valid != FALSE && g_hash_table_contains (plugins, name));
+  G_UNLOCK (registry_cache);
+
+  return ret;
+}
+
+/**
+ * xplayer_gst_registry_cache_has_decoder:
+ * @caps: the caps of a stream, such as those of a missing decoder
+ *
+ * Return value: %TRUE if a decoder that decodebin would use is known to
+ * accept @caps, %FALSE if none is, or if
+ * xplayer_gst_registry_cache_update() wasn't called
+ **/
+gboolean
+xplayer_gst_registry_cache_has_decoder (const GstCaps *caps)
+{
+  gboolean ret = FALSE;
+
+  G_LOCK (registry_cache);
+  if (cache_valid != FALSE) {
+    if (decoder_caps == NULL) {
+      GHashTableIter iter;
+      gpointer key;
+
+      decoder_caps = gst_caps_new_empty ();
+      g_hash_table_iter_init (&iter, decoders);
+      while (g_hash_table_iter_next (&iter, &key, NULL)) {
+        GstStructure *structure = gst_structure_from_string (key, NULL);
+        if (structure != NULL)
+          gst_caps_append_structure (decoder_caps, structure);
+      }
+    }
+    ret = gst_caps_can_intersect (decoder_caps, caps);
+  }
+  G_UNLOCK (registry_cache);
+
+  return ret;
+}
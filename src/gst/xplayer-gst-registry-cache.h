@@ -1,7 +1,4 @@
-/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
 /*
- * Copyright (C) 2001,2002,2003 Bastien Nocera <hadess@hadess.net>
- *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
@@ -16,10 +13,9 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
  *
- *
  * The Xplayer project hereby grant permission for non-gpl compatible GStreamer
  * plugins to be used and distributed together with GStreamer and Xplayer. This
- * permission are above and beyond the permissions granted by the GPL license
+ * permission is above and beyond the permissions granted by the GPL license
  * Xplayer is covered by.
  *
  * Monday 7th February 2005: Christian Schaller: Add exception clause.
@@ -27,31 +23,20 @@
  *
  */
 
-#ifndef __XPLAYER_PROFILE_H__
-#define __XPLAYER_PROFILE_H__ 1
-
-#ifdef GNOME_ENABLE_DEBUG
+#ifndef HAVE_XPLAYER_GST_REGISTRY_CACHE_H
+#define HAVE_XPLAYER_GST_REGISTRY_CACHE_H
 
-#include <sys/time.h>
-#include <glib.h>
+#include <gst/gst.h>
 
-#define XPLAYER_PROFILE(function)     \
-    do{                             \
-      struct timeval current_time;  \
-      double dtime;                 \
-      gettimeofday(&current_time, NULL); \
-      dtime = -(current_time.tv_sec + (current_time.tv_usec / 1000000.0)); \
-      function;                     \
-      gettimeofday(&current_time, NULL); \
-      dtime += current_time.tv_sec + (current_time.tv_usec / 1000000.0); \
-      printf("(%s:%d) took %lf seconds\n", \
-	     G_STRFUNC, __LINE__, dtime ); \
-    }while(0)
+G_BEGIN_DECLS
 
-#else /* GNOME_ENABLE_DEBUG */
+void     xplayer_gst_registry_cache_init        (void);
+void     xplayer_gst_registry_cache_update      (void);
+void     xplayer_gst_registry_cache_invalidate  (void);
 
-#define XPLAYER_PROFILE(function) function
+gboolean xplayer_gst_registry_cache_has_plugin  (const char *name);
+gboolean xplayer_gst_registry_cache_has_decoder (const GstCaps *caps);
 
-#endif /* GNOME_ENABLE_DEBUG */
+G_END_DECLS
 
-#endif /* __XPLAYER_PROFILE_H__ */
+#endif				/* HAVE_XPLAYER_GST_REGISTRY_CACHE_H */
@@ -0,0 +1,312 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ *
+ * The Xplayer project hereby grant permission for non-gpl compatible GStreamer
+ * plugins to be used and distributed together with GStreamer and Xplayer. This
+ * permission is above and beyond the permissions granted by the GPL license
+ * Xplayer is covered by.
+ *
+ * Monday 7th February 2005: Christian Schaller: Add exception clause.
+ * See license_change file for details.
+ *
+ */
+
+/*
+ * Spans of time spent in the startup and the hot paths of the player,
+ * exported as a Chrome trace, which chrome://tracing and the Perfetto UI
+ * both open.
+ *
+ * Each thread writes its spans to a ring buffer of its own, without any
+ * locking, the oldest spans being overwritten. Each span is guarded by a
+ * sequence number, so that exporting, from any thread, skips the spans
+ * being written instead of waiting for them. Rings outlive their threads,
+ * and get reused by new ones, so that the spans of the short-lived
+ * streaming threads aren't lost.
+ *
+ * Tracing is turned on by setting XPLAYER_TRACE to the file to export
+ * the trace to when the player exits.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xplayer-trace.h"
+
+#define RING_SIZE 4096
+#define DETAIL_SIZE 96
+
+typedef struct {
+	volatile gint seq; /* odd while being written */
+	guint tid;
+	const char *name;
+	gint64 start;
+	gint64 duration;
+	char detail[DETAIL_SIZE];
+} TraceEvent;
+
+typedef struct _TraceRing TraceRing;
+struct _TraceRing {
+	TraceRing *next;
+	volatile gint in_use;
+	volatile gint n_written;
+	TraceEvent events[RING_SIZE];
+};
+
+gboolean _xplayer_trace_enabled = FALSE;
+
+static TraceRing * volatile rings = NULL;
+static volatile gint last_tid = 0;
+static guint main_tid = 0;
+static gint64 trace_epoch = 0;
+static char *trace_filename = NULL;
+
+static void
+release_ring (gpointer data)
+{
+	TraceRing *ring = data;
+
+	g_atomic_int_set (&ring->in_use, FALSE);
+}
+
+static GPrivate thread_ring = G_PRIVATE_INIT (release_ring);
+static GPrivate thread_tid;
+
+static TraceRing *
+get_thread_ring (guint *tid)
+{
+	TraceRing *ring, *head;
+
+	ring = g_private_get (&thread_ring);
+	if (ring != NULL) {
+		*tid = GPOINTER_TO_UINT (g_private_get (&thread_tid));
+		return ring;
+	}
+
+	*tid = g_atomic_int_add (&last_tid, 1) + 1;
+	g_private_set (&thread_tid, GUINT_TO_POINTER (*tid));
+
+	/* Take over the ring of a thread that's gone, or add one */
+	for (ring = g_atomic_pointer_get (&rings); ring != NULL; ring = ring->next) {
+		if (g_atomic_int_compare_and_exchange (&ring->in_use, FALSE, TRUE)) {
+			g_private_set (&thread_ring, ring);
+			return ring;
+		}
+	}
+
+	ring = g_new0 (TraceRing, 1);
+	ring->in_use = TRUE;
+	do {
+		head = g_atomic_pointer_get (&rings);
+		ring->next = head;
+	} while (!g_atomic_pointer_compare_and_exchange (&rings, head, ring));
+
+	g_private_set (&thread_ring, ring);
+	return ring;
+}
+
+/**
+ * xplayer_trace_add:
+ * @name: the name of the span, which must be a static string
+ * @start: the monotonic time at which the span started, in microseconds
+ * @end: the monotonic time at which the span ended, in microseconds
+ * @format: printf()-style format for the detail of the span
+ * @...: the arguments for @format
+ *
+ * Records a span in the ring buffer of the calling thread. Use it through
+ * xplayer_trace_begin() and xplayer_trace_end() or
+ * xplayer_trace_end_with_detail().
+ **/
+void
+xplayer_trace_add (const char *name,
+		   gint64      start,
+		   gint64      end,
+		   const char *format,
+		   ...)
+{
+	TraceRing *ring;
+	TraceEvent *event;
+	va_list args;
+	guint tid;
+	gint n, seq;
+
+	ring = get_thread_ring (&tid);
+	n = ring->n_written;
+	event = &ring->events[n % RING_SIZE];
+
+	seq = event->seq;
+	g_atomic_int_set (&event->seq, seq + 1);
+
+	event->tid = tid;
+	event->name = name;
+	event->start = start;
+	event->duration = end - start;
+	va_start (args, format);
+	g_vsnprintf (event->detail, DETAIL_SIZE, format, args);
+	va_end (args);
+
+	g_atomic_int_set (&event->seq, seq + 2);
+	g_atomic_int_set (&ring->n_written, n + 1);
+}
+
+static void
+append_json_string (GString *json, const char *str)
+{
+	g_string_append_c (json, '"');
+	for (; *str != '\0'; str++) {
+		switch (*str) {
+		case '"':
+			g_string_append (json, "\\\"");
+			break;
+		case '\\':
+			g_string_append (json, "\\\\");
+			break;
+		default:
+			if ((guchar) *str < 0x20)
+				g_string_append_printf (json, "\\u%04x", (guchar) *str);
+			else
+				g_string_append_c (json, *str);
+			break;
+		}
+	}
+	g_string_append_c (json, '"');
+}
+
+static void
+append_ring (GString *json, TraceRing *ring, int pid, gboolean *first)
+{
+	gint n_written, i;
+
+	n_written = g_atomic_int_get (&ring->n_written);
+	for (i = MAX (0, n_written - RING_SIZE); i < n_written; i++) {
+		TraceEvent *event = &ring->events[i % RING_SIZE];
+		TraceEvent copy;
+		gint seq;
+
+		/* Skip the spans being written, or overwritten since */
+		seq = g_atomic_int_get (&event->seq);
+		if (seq % 2 != 0)
+			continue;
+		memcpy (&copy, event, sizeof (TraceEvent));
+		if (g_atomic_int_get (&event->seq) != seq)
+			continue;
+		copy.detail[DETAIL_SIZE - 1] = '\0';
+
+		g_string_append (json, *first ? "\n" : ",\n");
+		*first = FALSE;
+
+		g_string_append (json, "{\"name\":");
+		append_json_string (json, copy.name);
+		g_string_append_printf (json,
+					",\"cat\":\"xplayer\",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT
+					",\"dur\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%u",
+					copy.start - trace_epoch, copy.duration, pid, copy.tid);
+		if (copy.detail[0] != '\0') {
+			g_string_append (json, ",\"args\":{\"detail\":");
+			append_json_string (json, copy.detail);
+			g_string_append_c (json, '}');
+		}
+		g_string_append_c (json, '}');
+	}
+}
+
+/**
+ * xplayer_trace_dump:
+ * @filename: the file to write the trace to
+ * @error: a #GError, or %NULL
+ *
+ * Writes all the spans still in the ring buffers to @filename, in the
+ * JSON format of Chrome traces. This can be called from any thread, and
+ * doesn't block the threads adding spans.
+ *
+ * Return value: %TRUE on success, %FALSE otherwise
+ **/
+gboolean
+xplayer_trace_dump (const char  *filename,
+		    GError     **error)
+{
+	TraceRing *ring;
+	GString *json;
+	gboolean first = TRUE, ret;
+	int pid;
+
+	pid = getpid ();
+	json = g_string_new ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	if (main_tid != 0) {
+		g_string_append_printf (json,
+					"\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"main\"}}",
+					pid, main_tid);
+		first = FALSE;
+	}
+
+	for (ring = g_atomic_pointer_get (&rings); ring != NULL; ring = ring->next)
+		append_ring (json, ring, pid, &first);
+
+	g_string_append (json, "\n]}\n");
+
+	ret = g_file_set_contents (filename, json->str, json->len, error);
+	g_string_free (json, TRUE);
+
+	return ret;
+}
+
+static void
+dump_at_exit (void)
+{
+	GError *error = NULL;
+
+	if (!xplayer_trace_dump (trace_filename, &error)) {
+		g_warning ("Couldn't write the trace to '%s': %s", trace_filename, error->message);
+		g_error_free (error);
+	}
+}
+
+/**
+ * xplayer_trace_set_enabled:
+ * @enabled: whether to record spans
+ *
+ * Turns tracing on or off. The spans recorded so far are kept.
+ **/
+void
+xplayer_trace_set_enabled (gboolean enabled)
+{
+	if (trace_epoch == 0)
+		trace_epoch = g_get_monotonic_time ();
+	_xplayer_trace_enabled = (enabled != FALSE);
+}
+
+/**
+ * xplayer_trace_init:
+ *
+ * Turns tracing on if the XPLAYER_TRACE environment variable is set, in
+ * which case the trace is written to the file it points to when the
+ * process exits. Call it from the main thread, as early as possible.
+ **/
+void
+xplayer_trace_init (void)
+{
+	const char *filename;
+
+	filename = g_getenv ("XPLAYER_TRACE");
+	if (filename == NULL || *filename == '\0' || trace_filename != NULL)
+		return;
+
+	trace_filename = g_strdup (filename);
+	get_thread_ring (&main_tid);
+	xplayer_trace_set_enabled (TRUE);
+
+	atexit (dump_at_exit);
+}
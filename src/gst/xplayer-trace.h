@@ -0,0 +1,75 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ *
+ * The Xplayer project hereby grant permission for non-gpl compatible GStreamer
+ * plugins to be used and distributed together with GStreamer and Xplayer. This
+ * permission is above and beyond the permissions granted by the GPL license
+ * Xplayer is covered by.
+ *
+ * Monday 7th February 2005: Christian Schaller: Add exception clause.
+ * See license_change file for details.
+ *
+ */
+
+#ifndef _XPLAYER_TRACE_H_
+#define _XPLAYER_TRACE_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Read directly by the macros below, so that they cost a single test
+ * when tracing is off */
+extern gboolean _xplayer_trace_enabled;
+
+void     xplayer_trace_init        (void);
+void     xplayer_trace_set_enabled (gboolean     enabled);
+gboolean xplayer_trace_dump        (const char  *filename,
+				    GError     **error);
+void     xplayer_trace_add         (const char  *name,
+				    gint64       start,
+				    gint64       end,
+				    const char  *format,
+				    ...) G_GNUC_PRINTF (4, 5);
+
+#define xplayer_trace_is_enabled() G_UNLIKELY (_xplayer_trace_enabled)
+
+/* Starts a span, returning its start time, or 0 if tracing is off */
+#define xplayer_trace_begin() (xplayer_trace_is_enabled () ? g_get_monotonic_time () : 0)
+
+/* Ends the span started at @start, the detail only being formatted
+ * if tracing was on when the span started */
+#define xplayer_trace_end(name, start) \
+	G_STMT_START { \
+		if (G_UNLIKELY ((start) != 0)) \
+			xplayer_trace_add ((name), (start), g_get_monotonic_time (), "%s", ""); \
+	} G_STMT_END
+#define xplayer_trace_end_with_detail(name, start, ...) \
+	G_STMT_START { \
+		if (G_UNLIKELY ((start) != 0)) \
+			xplayer_trace_add ((name), (start), g_get_monotonic_time (), __VA_ARGS__); \
+	} G_STMT_END
+
+/* Traces @statement as a span called @name */
+#define XPLAYER_TRACE(name, statement) \
+	G_STMT_START { \
+		gint64 _xplayer_trace_start = xplayer_trace_begin (); \
+		statement; \
+		xplayer_trace_end ((name), _xplayer_trace_start); \
+	} G_STMT_END
+
+G_END_DECLS
+
+#endif /* _XPLAYER_TRACE_H_ */
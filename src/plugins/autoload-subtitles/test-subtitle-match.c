@@ -0,0 +1,146 @@
+/*
+ * Checks which subtitle files are picked for a movie, and in what order
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "xplayer-subtitle-match.h"
+
+#define STEM "movie"
+
+/* Matches @name on its own, as the only file in the directory */
+static const char *
+match_one (const char *name)
+{
+	GPtrArray *names;
+	const char *match;
+
+	names = g_ptr_array_new ();
+	g_ptr_array_add (names, (gpointer) name);
+	match = xplayer_subtitle_match (names, STEM);
+	g_ptr_array_unref (names);
+
+	return match;
+}
+
+static void
+test_accepted (void)
+{
+	static const char *accepted[] = {
+		"movie.srt",
+		"movie.ASS",
+		"movie.en.srt",
+		"movie.eng.sub",
+		"movie.pt-BR.srt",
+		"movie.en_GB.srt",
+		"movie.es-419.srt",
+		"movie.en.forced.srt",
+		"movie.EN.SDH.srt",
+		"movie.pt-BR.forced.ssa"
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (accepted); i++)
+		g_assert_cmpstr (match_one (accepted[i]), ==, accepted[i]);
+}
+
+static void
+test_rejected (void)
+{
+	static const char *rejected[] = {
+		/* Other movies, or parts of them */
+		"movie.part2.srt",
+		"movie.2.srt",
+		"movie.extended.srt",
+		"movie.en.backup.srt",
+		"movie2.srt",
+		"movies.en.srt",
+		"moviesrt",
+		/* Not quite language tags */
+		"movie.e.srt",
+		"movie.english.srt",
+		"movie.en-.srt",
+		"movie.en-b.srt",
+		"movie.en-GBR.srt",
+		"movie.en-12.srt",
+		"movie.en..srt",
+		"movie..srt",
+		"movie.forced.srt",
+		"movie.en.forced.sdh.srt",
+		/* Not subtitles */
+		"movie.en.txt",
+		"movie.srt.bak"
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (rejected); i++)
+		g_assert_cmpstr (match_one (rejected[i]), ==, NULL);
+}
+
+/* Takes the best match out of @names each time, and checks that they
+ * come out in the order of @expected */
+static void
+test_ranking (void)
+{
+	static const char *expected[] = {
+		"movie.sub",
+		"movie.srt",
+		"movie.fr-FR.srt",
+		"movie.fr.srt",
+		"movie.fr.forced.srt",
+		"movie.de.sub",
+		"movie.de.srt",
+		"movie.en.srt",
+		"movie.en.sdh.srt"
+	};
+	GPtrArray *names;
+	guint i;
+
+	/* In reverse, so that the order of the listing isn't what's checked */
+	names = g_ptr_array_new ();
+	for (i = G_N_ELEMENTS (expected); i > 0; i--)
+		g_ptr_array_add (names, (gpointer) expected[i - 1]);
+	g_ptr_array_add (names, "movie.part2.srt");
+
+	for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+		const char *match;
+
+		match = xplayer_subtitle_match (names, STEM);
+		g_assert_cmpstr (match, ==, expected[i]);
+		g_ptr_array_remove (names, (gpointer) match);
+	}
+	g_assert_cmpstr (xplayer_subtitle_match (names, STEM), ==, NULL);
+
+	g_ptr_array_unref (names);
+}
+
+int
+main (int argc, char **argv)
+{
+	/* Before anything gets the language names, which are cached */
+	g_setenv ("LANGUAGE", "fr_FR", TRUE);
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/subtitle-match/accepted", test_accepted);
+	g_test_add_func ("/subtitle-match/rejected", test_rejected);
+	g_test_add_func ("/subtitle-match/ranking", test_ranking);
+
+	return g_test_run ();
+}
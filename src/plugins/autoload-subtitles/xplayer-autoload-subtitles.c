@@ -30,214 +30,414 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <string.h>
 
 #include "xplayer-plugin.h"
 #include "xplayer.h"
+#include "backend/bacon-video-widget.h"
+#include "xplayer-subtitle-match.h"
 
 #define XPLAYER_TYPE_AUTOLOAD_SUBTITLES_PLUGIN	(xplayer_autoload_subtitles_plugin_get_type ())
 #define XPLAYER_AUTOLOAD_SUBTITLES_PLUGIN(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), XPLAYER_TYPE_AUTOLOAD_SUBTITLES_PLUGIN, XplayerAutoloadSubtitlesPlugin))
 
+/* How long a listing of a directory that can't be monitored stays valid */
+#define LISTING_MAX_AGE (30 * G_USEC_PER_SEC)
+/* Number of directory listings kept around */
+#define MAX_LISTINGS 32
+#define ENUMERATE_BATCH_SIZE 64
+
 typedef struct {
 	guint signal_id;
 	XplayerObject *xplayer;
 	GSettings *settings;
 	gboolean autoload_subs;
+	GHashTable *listings;
+	GCancellable *cancellable;
 } XplayerAutoloadSubtitlesPluginPrivate;
 
 XPLAYER_PLUGIN_REGISTER(XPLAYER_TYPE_AUTOLOAD_SUBTITLES_PLUGIN, XplayerAutoloadSubtitlesPlugin, xplayer_autoload_subtitles_plugin)
 
-/* List from xine-lib's demux_sputext.c.
- * Keep in sync with the list in xplayer_setup_file_filters() in this file.
- * Don't add .txt extensions, as there are too many false positives. */
-static const char subtitle_ext[][4] = {
-	"sub",
-	"srt",
-	"smi",
-	"ssa",
-	"ass",
-	"asc"
-};
-
-static gboolean
-xplayer_uri_exists (const char *uri)
+/* The names of the subtitle files in a directory, so that finding the
+ * subtitles for a movie doesn't need a round-trip per candidate name */
+typedef struct {
+	GPtrArray *names;
+	GFileMonitor *monitor;
+	gint64 timestamp;
+} DirListing;
+
+typedef struct {
+	XplayerAutoloadSubtitlesPlugin *pi;
+	GCancellable *cancellable;
+	char *mrl;
+	GFile *file;
+	guint pending;
+} SubtitleLookup;
+
+typedef struct {
+	SubtitleLookup *lookup;
+	GFile *dir;
+	GPtrArray *names;
+} DirScan;
+
+static void
+dir_listing_free (DirListing *listing)
 {
-	GFile *file = g_file_new_for_uri (uri);
-	if (file != NULL) {
-		if (g_file_query_exists (file, NULL)) {
-			g_object_unref (file);
-			return TRUE;
-		}
-		g_object_unref (file);
+	g_ptr_array_unref (listing->names);
+	if (listing->monitor != NULL) {
+		g_file_monitor_cancel (listing->monitor);
+		g_object_unref (listing->monitor);
 	}
-	return FALSE;
+	g_slice_free (DirListing, listing);
 }
 
-static char *
-xplayer_uri_get_subtitle_for_uri (const char *uri)
+static void
+dir_changed_cb (GFileMonitor                   *monitor,
+		GFile                          *file,
+		GFile                          *other_file,
+		GFileMonitorEvent               event_type,
+		XplayerAutoloadSubtitlesPlugin *pi)
 {
-	char *subtitle;
-	guint len, i;
-	gint suffix;
-
-	g_return_val_if_fail (uri != NULL, NULL);
-
-	/* Find the filename suffix delimiter */
-	len = strlen (uri);
-	for (suffix = len - 1; suffix > 0; suffix--) {
-		if (uri[suffix] == G_DIR_SEPARATOR ||
-		    (uri[suffix] == '/')) {
-			/* This filename has no extension; we'll need to add one */
-			suffix = len;
-			break;
-		}
-		if (uri[suffix] == '.') {
-			/* Found our extension marker */
-			break;
-		}
-	}
-	if (suffix < 0)
-		return NULL;
+	const char *uri;
 
-	/* Generate a subtitle string with room at the end to store the
-	 * 3 character extensions for which we want to search */
-	subtitle = g_malloc0 (suffix + 4 + 1);
-	g_return_val_if_fail (subtitle != NULL, NULL);
-	g_strlcpy (subtitle, uri, suffix + 4 + 1);
-	g_strlcpy (subtitle + suffix, ".???", 5);
+	if (event_type == G_FILE_MONITOR_EVENT_CHANGED ||
+	    event_type == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT ||
+	    event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+		return;
 
-	/* Search for any files with one of our known subtitle extensions */
-	for (i = 0; i < G_N_ELEMENTS (subtitle_ext) ; i++) {
-		char *subtitle_ext_upper;
-		memcpy (subtitle + suffix + 1, subtitle_ext[i], 3);
+	uri = g_object_get_data (G_OBJECT (monitor), "uri");
+	g_hash_table_remove (pi->priv->listings, uri);
+}
 
-		if (xplayer_uri_exists (subtitle))
-			return subtitle;
+static DirListing *
+get_listing (XplayerAutoloadSubtitlesPlugin *pi,
+	     const char                     *uri)
+{
+	DirListing *listing;
 
-		/* Check with upper-cased extension */
-		subtitle_ext_upper = g_ascii_strup (subtitle_ext[i], -1);
-		memcpy (subtitle + suffix + 1, subtitle_ext_upper, 3);
-		g_free (subtitle_ext_upper);
+	listing = g_hash_table_lookup (pi->priv->listings, uri);
+	if (listing == NULL)
+		return NULL;
 
-		if (xplayer_uri_exists (subtitle))
-			return subtitle;
+	if (listing->monitor == NULL &&
+	    g_get_monotonic_time () - listing->timestamp > LISTING_MAX_AGE) {
+		g_hash_table_remove (pi->priv->listings, uri);
+		return NULL;
 	}
-	g_free (subtitle);
-	return NULL;
+
+	return listing;
 }
 
-static char *
-xplayer_uri_get_subtitle_in_subdir (GFile *file, const char *subdir)
+static void
+add_listing (XplayerAutoloadSubtitlesPlugin *pi,
+	     GFile                          *dir,
+	     GPtrArray                      *names,
+	     gboolean                        exists)
 {
-	char *filename, *subtitle, *full_path_str;
-	GFile *parent, *full_path, *directory;
+	DirListing *listing;
+	char *uri;
+
+	if (g_hash_table_size (pi->priv->listings) >= MAX_LISTINGS)
+		g_hash_table_remove_all (pi->priv->listings);
+
+	uri = g_file_get_uri (dir);
+
+	listing = g_slice_new0 (DirListing);
+	listing->names = g_ptr_array_ref (names);
+	listing->timestamp = g_get_monotonic_time ();
+
+	/* Directories that don't exist, or on remote mounts where
+	 * setting up a monitor is a round-trip itself, aren't monitored,
+	 * and get listed again once the listing expires */
+	if (exists && g_file_is_native (dir))
+		listing->monitor = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL, NULL);
+	if (listing->monitor != NULL) {
+		g_object_set_data_full (G_OBJECT (listing->monitor), "uri", g_strdup (uri), g_free);
+		g_signal_connect (listing->monitor, "changed",
+				  G_CALLBACK (dir_changed_cb), pi);
+	}
 
-	/* Get the sibling directory @subdir of the file @file */
-	parent = g_file_get_parent (file);
-	directory = g_file_get_child (parent, subdir);
-	g_object_unref (parent);
+	g_hash_table_replace (pi->priv->listings, uri, listing);
+}
 
-	/* Get the file of the same name as @file in the @subdir directory */
-	filename = g_file_get_basename (file);
-	full_path = g_file_get_child (directory, filename);
-	g_object_unref (directory);
-	g_free (filename);
+/* The directories to look for subtitles for @file in, in order */
+static GPtrArray *
+get_subtitle_dirs (GFile *file)
+{
+	GPtrArray *dirs;
+	GFile *parent;
 
-	/* Get the subtitles from that URI */
-	full_path_str = g_file_get_uri (full_path);
-	g_object_unref (full_path);
-	subtitle = xplayer_uri_get_subtitle_for_uri (full_path_str);
-	g_free (full_path_str);
+	dirs = g_ptr_array_new_with_free_func (g_object_unref);
 
-	return subtitle;
+	/* The cached subtitles directory */
+	if (g_file_is_native (file)) {
+		char *path;
+
+		path = g_build_filename (g_get_user_cache_dir (), "xplayer", "subtitles", NULL);
+		g_ptr_array_add (dirs, g_file_new_for_path (path));
+		g_free (path);
+	}
+
+	parent = g_file_get_parent (file);
+	if (parent != NULL) {
+		g_ptr_array_add (dirs, g_object_ref (parent));
+		g_ptr_array_add (dirs, g_file_get_child (parent, "subtitles"));
+		g_ptr_array_add (dirs, g_file_get_child (parent, "subs"));
+		g_object_unref (parent);
+	}
+
+	return dirs;
 }
 
+/* Looks for the subtitles of @file in the cached listings. Directories
+ * without a listing are added to @missing, and matches in directories
+ * after those are ignored, as they might not be the best. Without
+ * @missing, directories that haven't been listed are skipped. */
 static char *
-xplayer_uri_get_cached_subtitle_for_uri (const char *uri)
+find_subtitle (XplayerAutoloadSubtitlesPlugin *pi,
+	       GFile                          *file,
+	       GPtrArray                      *missing)
 {
-	char *filename, *basename, *fake_filename, *fake_uri, *ret;
+	GPtrArray *dirs;
+	char *basename, *ext, *subtitle;
+	guint i;
 
-	filename = g_filename_from_uri (uri, NULL, NULL);
-	if (filename == NULL)
+	basename = g_file_get_basename (file);
+	if (basename == NULL)
 		return NULL;
+	ext = strrchr (basename, '.');
+	if (ext != NULL && ext != basename)
+		*ext = '\0';
+
+	subtitle = NULL;
+	dirs = get_subtitle_dirs (file);
+
+	for (i = 0; i < dirs->len && subtitle == NULL; i++) {
+		GFile *dir = g_ptr_array_index (dirs, i);
+		DirListing *listing;
+		const char *name;
+		char *uri;
+
+		uri = g_file_get_uri (dir);
+		listing = get_listing (pi, uri);
+		g_free (uri);
+
+		if (listing == NULL) {
+			if (missing != NULL)
+				g_ptr_array_add (missing, g_object_ref (dir));
+			continue;
+		}
+		if (missing != NULL && missing->len > 0)
+			continue;
 
-	basename = g_path_get_basename (filename);
-	g_free (filename);
-	if (basename == NULL || strcmp (basename, ".") == 0) {
-		g_free (basename);
-		return NULL;
+		name = xplayer_subtitle_match (listing->names, basename);
+		if (name != NULL) {
+			GFile *child;
+
+			child = g_file_get_child (dir, name);
+			subtitle = g_file_get_uri (child);
+			g_object_unref (child);
+		}
 	}
 
-	fake_filename = g_build_filename (g_get_user_cache_dir (),
-				"xplayer",
-				"subtitles",
-				basename,
-				NULL);
+	g_ptr_array_unref (dirs);
 	g_free (basename);
-	fake_uri = g_filename_to_uri (fake_filename, NULL, NULL);
-	g_free (fake_filename);
-
-	ret = xplayer_uri_get_subtitle_for_uri (fake_uri);
-	g_free (fake_uri);
 
-	return ret;
+	return subtitle;
 }
 
-static char *
-xplayer_uri_get_subtitle_uri (const char *uri)
+static void
+subtitle_lookup_done (SubtitleLookup *lookup)
 {
-	GFile *file;
-	char *subtitle;
-
-	if (g_str_has_prefix (uri, "http") != FALSE ||
-	    g_str_has_prefix (uri, "rtsp") != FALSE ||
-	    g_str_has_prefix (uri, "rtmp") != FALSE)
-		return NULL;
+	XplayerAutoloadSubtitlesPlugin *pi = lookup->pi;
+	GtkWidget *bvw;
+	char *mrl, *subtitle;
 
-	/* Has the user specified a subtitle file manually? */
-	if (strstr (uri, "#subtitle:") != NULL)
-		return NULL;
+	if (pi->priv->autoload_subs == FALSE)
+		return;
 
-	/* Does the file exist? */
-	file = g_file_new_for_uri (uri);
-	if (g_file_query_exists (file, NULL) != TRUE) {
-		g_object_unref (file);
-		return NULL;
+	/* Another file was opened in the meantime */
+	mrl = xplayer_object_get_current_mrl (pi->priv->xplayer);
+	if (g_strcmp0 (mrl, lookup->mrl) != 0) {
+		g_free (mrl);
+		return;
 	}
+	g_free (mrl);
+
+	subtitle = find_subtitle (pi, lookup->file, NULL);
+	if (subtitle == NULL)
+		return;
+
+	bvw = xplayer_object_get_video_widget (pi->priv->xplayer);
+	bacon_video_widget_set_text_subtitle (BACON_VIDEO_WIDGET (bvw), subtitle);
+	/* As xplayer_action_set_mrl_with_warning() does for subtitles found
+	 * while opening the file */
+	if (g_settings_get_boolean (pi->priv->settings, "autodisplay-subtitles") == FALSE)
+		bacon_video_widget_set_subtitle (BACON_VIDEO_WIDGET (bvw), -1);
+	g_object_unref (bvw);
+	g_free (subtitle);
+}
 
-	/* Try in the cached subtitles directory */
-	subtitle = xplayer_uri_get_cached_subtitle_for_uri (uri);
-	if (subtitle != NULL) {
-		g_object_unref (file);
-		return subtitle;
+/* Caches the listing if the directory was listed fully, or doesn't
+ * exist. A listing cut short by @error isn't, and the directory will be
+ * listed again on the next lookup, after this one skips it */
+static void
+dir_scan_finish (DirScan *scan,
+		 GError  *error)
+{
+	SubtitleLookup *lookup = scan->lookup;
+
+	/* The plugin might be gone when cancelled */
+	if (!g_cancellable_is_cancelled (lookup->cancellable)) {
+		if (error == NULL ||
+		    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+		    g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_DIRECTORY))
+			add_listing (lookup->pi, scan->dir, scan->names, error == NULL);
+		else
+			g_debug ("Not caching an incomplete listing: %s", error->message);
 	}
 
-	/* Try in the current directory */
-	subtitle = xplayer_uri_get_subtitle_for_uri (uri);
-	if (subtitle != NULL) {
-		g_object_unref (file);
-		return subtitle;
+	g_object_unref (scan->dir);
+	g_ptr_array_unref (scan->names);
+	g_slice_free (DirScan, scan);
+
+	if (--lookup->pending > 0)
+		return;
+
+	if (!g_cancellable_is_cancelled (lookup->cancellable))
+		subtitle_lookup_done (lookup);
+
+	g_object_unref (lookup->cancellable);
+	g_object_unref (lookup->file);
+	g_free (lookup->mrl);
+	g_slice_free (SubtitleLookup, lookup);
+}
+
+static void
+next_files_cb (GObject      *source,
+	       GAsyncResult *result,
+	       DirScan      *scan)
+{
+	GFileEnumerator *enumerator = G_FILE_ENUMERATOR (source);
+	GList *infos, *l;
+	GError *error = NULL;
+
+	/* Either the end of the listing, or an error */
+	infos = g_file_enumerator_next_files_finish (enumerator, result, &error);
+	if (infos == NULL) {
+		g_file_enumerator_close_async (enumerator, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+		g_object_unref (enumerator);
+		dir_scan_finish (scan, error);
+		g_clear_error (&error);
+		return;
 	}
 
-	subtitle = xplayer_uri_get_subtitle_in_subdir (file, "subtitles");
-	g_object_unref (file);
+	for (l = infos; l != NULL; l = l->next) {
+		GFileInfo *info = l->data;
+		const char *name;
 
-	return subtitle;
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+			continue;
+
+		name = g_file_info_get_name (info);
+		if (xplayer_subtitle_ext_index (name) >= 0)
+			g_ptr_array_add (scan->names, g_strdup (name));
+	}
+	g_list_free_full (infos, g_object_unref);
+
+	g_file_enumerator_next_files_async (enumerator, ENUMERATE_BATCH_SIZE, G_PRIORITY_DEFAULT,
+					    scan->lookup->cancellable,
+					    (GAsyncReadyCallback) next_files_cb, scan);
 }
 
+static void
+enumerate_children_cb (GObject      *source,
+		       GAsyncResult *result,
+		       DirScan      *scan)
+{
+	GFileEnumerator *enumerator;
+	GError *error = NULL;
+
+	enumerator = g_file_enumerate_children_finish (G_FILE (source), result, &error);
+	if (enumerator == NULL) {
+		dir_scan_finish (scan, error);
+		g_error_free (error);
+		return;
+	}
 
+	g_file_enumerator_next_files_async (enumerator, ENUMERATE_BATCH_SIZE, G_PRIORITY_DEFAULT,
+					    scan->lookup->cancellable,
+					    (GAsyncReadyCallback) next_files_cb, scan);
+}
+
+/* Lists the directories in @dirs, and sets the subtitles for @mrl
+ * once they've all been listed */
+static void
+subtitle_lookup_start (XplayerAutoloadSubtitlesPlugin *pi,
+		       const char                     *mrl,
+		       GFile                          *file,
+		       GPtrArray                      *dirs)
+{
+	SubtitleLookup *lookup;
+	guint i;
+
+	lookup = g_slice_new0 (SubtitleLookup);
+	lookup->pi = pi;
+	lookup->cancellable = g_object_ref (pi->priv->cancellable);
+	lookup->mrl = g_strdup (mrl);
+	lookup->file = g_object_ref (file);
+	lookup->pending = dirs->len;
+
+	for (i = 0; i < dirs->len; i++) {
+		DirScan *scan;
+
+		scan = g_slice_new0 (DirScan);
+		scan->lookup = lookup;
+		scan->dir = g_object_ref (g_ptr_array_index (dirs, i));
+		scan->names = g_ptr_array_new_with_free_func (g_free);
+
+		g_file_enumerate_children_async (scan->dir,
+						 G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						 G_FILE_ATTRIBUTE_STANDARD_TYPE,
+						 G_FILE_QUERY_INFO_NONE, G_PRIORITY_DEFAULT,
+						 lookup->cancellable,
+						 (GAsyncReadyCallback) enumerate_children_cb, scan);
+	}
+}
 
 static char *
 get_text_subtitle_cb (XplayerObject                  *xplayer,
 		      const char                   *mrl,
 		      XplayerAutoloadSubtitlesPlugin *pi)
 {
+	GFile *file;
+	GPtrArray *missing;
 	char *sub;
 
 	if (pi->priv->autoload_subs == FALSE)
 		return NULL;
 
-	sub = xplayer_uri_get_subtitle_uri (mrl);
+	if (g_str_has_prefix (mrl, "http") != FALSE ||
+	    g_str_has_prefix (mrl, "rtsp") != FALSE ||
+	    g_str_has_prefix (mrl, "rtmp") != FALSE)
+		return NULL;
+
+	/* Has the user specified a subtitle file manually? */
+	if (strstr (mrl, "#subtitle:") != NULL)
+		return NULL;
+
+	/* Answer straight away from the listings we have, otherwise
+	 * list the directories without blocking the opening of the file,
+	 * and set the subtitles later */
+	file = g_file_new_for_uri (mrl);
+	missing = g_ptr_array_new_with_free_func (g_object_unref);
+
+	sub = find_subtitle (pi, file, missing);
+	if (sub == NULL && missing->len > 0)
+		subtitle_lookup_start (pi, mrl, file, missing);
+
+	g_ptr_array_unref (missing);
+	g_object_unref (file);
 
 	return sub;
 }
@@ -257,6 +457,9 @@ impl_activate (PeasActivatable *plugin)
 
 	pi->priv->xplayer = g_object_ref (g_object_get_data (G_OBJECT (plugin), "object"));
 	pi->priv->settings = g_settings_new ("org.x.player");
+	pi->priv->listings = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) dir_listing_free);
+	pi->priv->cancellable = g_cancellable_new ();
 	pi->priv->autoload_subs = g_settings_get_boolean (pi->priv->settings, "autoload-subtitles");
 	g_signal_connect (pi->priv->settings, "changed::autoload-subtitles",
 			  G_CALLBACK (autoload_subs_changed), pi);
@@ -273,6 +476,12 @@ impl_deactivate (PeasActivatable *plugin)
 		g_signal_handler_disconnect (pi->priv->xplayer, pi->priv->signal_id);
 		pi->priv->signal_id = 0;
 	}
+	if (pi->priv->cancellable) {
+		g_cancellable_cancel (pi->priv->cancellable);
+		g_object_unref (pi->priv->cancellable);
+		pi->priv->cancellable = NULL;
+	}
+	g_clear_pointer (&pi->priv->listings, g_hash_table_destroy);
 	if (pi->priv->xplayer) {
 		g_object_unref (pi->priv->xplayer);
 		pi->priv->xplayer = NULL;
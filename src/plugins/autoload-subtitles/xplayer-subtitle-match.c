@@ -0,0 +1,206 @@
+/*
+ * Matching of subtitle file names to the movies they're for
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "xplayer-subtitle-match.h"
+
+/* List from xine-lib's demux_sputext.c.
+ * Keep in sync with the list in xplayer_setup_file_filters().
+ * Don't add .txt extensions, as there are too many false positives. */
+static const char subtitle_ext[][4] = {
+	"sub",
+	"srt",
+	"smi",
+	"ssa",
+	"ass",
+	"asc"
+};
+
+/* The ranks of the kinds of names, each then ranked by subtitle_ext */
+enum {
+	RANK_PLAIN,		/* movie.srt */
+	RANK_PREFERRED,		/* movie.<user's language>.srt */
+	RANK_PREFERRED_VARIANT,	/* movie.<user's language>.forced.srt */
+	RANK_OTHER,		/* movie.<other language>.srt */
+	RANK_OTHER_VARIANT	/* movie.<other language>.sdh.srt */
+};
+
+gint
+xplayer_subtitle_ext_index (const char *filename)
+{
+	const char *ext;
+	guint i;
+
+	ext = strrchr (filename, '.');
+	if (ext == NULL)
+		return -1;
+
+	for (i = 0; i < G_N_ELEMENTS (subtitle_ext); i++) {
+		if (g_ascii_strcasecmp (ext + 1, subtitle_ext[i]) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* Parses the @len characters of @tag, the middle of "movie.<tag>.srt",
+ * as a language code of 2 or 3 letters, with maybe a region of 2
+ * letters or 3 digits, as in "pt-BR", "en_GB" or "es-419", and then
+ * maybe ".forced" or ".sdh". Anything else, as in "movie.part2.srt",
+ * isn't the subtitles of "movie" but of another file. */
+static gboolean
+parse_language_tag (const char *tag,
+		    gsize       len,
+		    gsize      *lang_len,
+		    gboolean   *variant)
+{
+	const char *region, *variant_name;
+	gsize i, region_len;
+
+	for (i = 0; i < len && g_ascii_isalpha (tag[i]); i++)
+		;
+	if (i < 2 || i > 3)
+		return FALSE;
+
+	if (i < len && (tag[i] == '-' || tag[i] == '_')) {
+		region = tag + i + 1;
+		region_len = len - (i + 1);
+
+		if (region_len >= 2 &&
+		    g_ascii_isalpha (region[0]) && g_ascii_isalpha (region[1]) &&
+		    (region_len == 2 || region[2] == '.'))
+			i += 1 + 2;
+		else if (region_len >= 3 &&
+			 g_ascii_isdigit (region[0]) && g_ascii_isdigit (region[1]) && g_ascii_isdigit (region[2]) &&
+			 (region_len == 3 || region[3] == '.'))
+			i += 1 + 3;
+		else
+			return FALSE;
+	}
+
+	*lang_len = i;
+	*variant = FALSE;
+	if (i == len)
+		return TRUE;
+	if (tag[i] != '.')
+		return FALSE;
+
+	variant_name = tag + i + 1;
+	len -= i + 1;
+	if ((len == strlen ("forced") && g_ascii_strncasecmp (variant_name, "forced", len) == 0) ||
+	    (len == strlen ("sdh") && g_ascii_strncasecmp (variant_name, "sdh", len) == 0)) {
+		*variant = TRUE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* g_get_language_names() has "pt_BR", where file names
+ * might have "pt-BR" */
+static gboolean
+is_preferred_language (const char *lang,
+		       gsize       len)
+{
+	const gchar * const *languages;
+	guint i;
+
+	languages = g_get_language_names ();
+	for (i = 0; languages[i] != NULL; i++) {
+		gsize j;
+
+		if (strlen (languages[i]) != len)
+			continue;
+
+		for (j = 0; j < len; j++) {
+			gchar c = (lang[j] == '-') ? '_' : lang[j];
+
+			if (g_ascii_tolower (c) != g_ascii_tolower (languages[i][j]))
+				break;
+		}
+		if (j == len)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * xplayer_subtitle_match:
+ * @names: (element-type utf8): the names of the subtitle files in a directory
+ * @stem: the movie's file name, without its extension
+ *
+ * Picks the subtitles for the movie named @stem among @names. Prefers
+ * "movie.srt", then "movie.<user's language>.srt", then other languages,
+ * with the forced and SDH variants of each after it, and then by the
+ * order of subtitle_ext.
+ *
+ * Returns: one of @names, or %NULL if none are for that movie
+ **/
+const char *
+xplayer_subtitle_match (GPtrArray  *names,
+			const char *stem)
+{
+	const char *best = NULL;
+	guint best_rank = G_MAXUINT;
+	gsize stem_len;
+	guint i;
+
+	stem_len = strlen (stem);
+
+	for (i = 0; i < names->len; i++) {
+		const char *name = g_ptr_array_index (names, i);
+		const char *suffix, *ext;
+		gint ext_index;
+		guint kind, rank;
+
+		if (strncmp (name, stem, stem_len) != 0 || name[stem_len] != '.')
+			continue;
+
+		ext_index = xplayer_subtitle_ext_index (name);
+		if (ext_index < 0)
+			continue;
+
+		suffix = name + stem_len;
+		ext = strrchr (suffix, '.');
+
+		if (ext == suffix) {
+			kind = RANK_PLAIN;
+		} else {
+			gsize lang_len;
+			gboolean variant;
+
+			if (!parse_language_tag (suffix + 1, ext - (suffix + 1), &lang_len, &variant))
+				continue;
+
+			if (is_preferred_language (suffix + 1, lang_len))
+				kind = variant ? RANK_PREFERRED_VARIANT : RANK_PREFERRED;
+			else
+				kind = variant ? RANK_OTHER_VARIANT : RANK_OTHER;
+		}
+
+		rank = kind * G_N_ELEMENTS (subtitle_ext) + ext_index;
+		if (rank < best_rank ||
+		    (rank == best_rank && strcmp (name, best) < 0)) {
+			best = name;
+			best_rank = rank;
+		}
+	}
+
+	return best;
+}
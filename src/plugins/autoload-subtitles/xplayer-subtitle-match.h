@@ -0,0 +1,32 @@
+/*
+ * Matching of subtitle file names to the movies they're for
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#ifndef XPLAYER_SUBTITLE_MATCH_H
+#define XPLAYER_SUBTITLE_MATCH_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gint        xplayer_subtitle_ext_index (const char *filename);
+const char *xplayer_subtitle_match     (GPtrArray  *names,
+					const char *stem);
+
+G_END_DECLS
+
+#endif /* XPLAYER_SUBTITLE_MATCH_H */
@@ -9,8 +9,6 @@ import zlib
 from os import sep, path, mkdir
 import gettext
 
-from hash import hash_file
-
 gettext.textdomain ("xplayer")
 
 D_ = gettext.dgettext
@@ -545,7 +543,8 @@ class OpenSubtitles (GObject.Object, # pylint: disable-msg=R0902
 
         self._action.connect ('activate', self._show_dialog)
 
-        self._action.set_sensitive (self._xplayer.is_playing () and
+        # Activated on the first file being opened, before it plays
+        self._action.set_sensitive (self._xplayer.get_current_mrl () is not None and
                   self._check_allowed_scheme () and
                                   not self._check_is_audio ())
 
@@ -757,7 +756,16 @@ class OpenSubtitles (GObject.Object, # pylint: disable-msg=R0902
         self._apply_button.set_sensitive (False)
         self._find_button.set_sensitive (False)
         self._filename = self._xplayer.get_current_mrl ()
-        (movie_hash, movie_size) = hash_file (self._filename)
+        Xplayer.movie_hash_async (Gio.File.new_for_uri (self._filename), None,
+                                  self.__on_movie_hashed, None)
+
+    def __on_movie_hashed (self, _movie_file, result, _data):
+        try:
+            (movie_hash, movie_size) = Xplayer.movie_hash_finish (result)
+        except GLib.GError as err:
+            self._progress.set_text (err.message)
+            self._find_button.set_sensitive (True)
+            return
 
         self._get_results (movie_hash, movie_size)
 
@@ -39,6 +39,7 @@
 
 #include "xplayer-plugin.h"
 #include "xplayer.h"
+#include "xplayer-interface.h"
 #include "bacon-video-widget.h"
 
 #define XPLAYER_TYPE_MOVIE_PROPERTIES_PLUGIN		(xplayer_movie_properties_plugin_get_type ())
@@ -49,7 +50,8 @@
 #define XPLAYER_MOVIE_PROPERTIES_PLUGIN_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), XPLAYER_TYPE_MOVIE_PROPERTIES_PLUGIN, XplayerMoviePropertiesPluginClass))
 
 typedef struct {
-	GtkWidget    *props;
+	GtkWidget    *page;
+	GtkWidget    *props; /* NULL until the page is first shown */
 	guint         handler_id_stream_length;
 } XplayerMoviePropertiesPluginPrivate;
 
@@ -181,6 +183,9 @@ stream_length_notify_cb (XplayerObject *xplayer,
 {
 	gint64 stream_length;
 
+	if (plugin->priv->props == NULL)
+		return;
+
 	g_object_get (G_OBJECT (xplayer),
 		      "stream-length", &stream_length,
 		      NULL);
@@ -197,6 +202,9 @@ xplayer_movie_properties_plugin_file_opened (XplayerObject *xplayer,
 {
 	GtkWidget *bvw;
 
+	if (plugin->priv->props == NULL)
+		return;
+
 	bvw = xplayer_get_video_widget (xplayer);
 	update_properties_from_bvw
 		(BACON_VIDEO_WIDGET_PROPERTIES (plugin->priv->props), bvw);
@@ -208,6 +216,9 @@ static void
 xplayer_movie_properties_plugin_file_closed (XplayerObject *xplayer,
 					   XplayerMoviePropertiesPlugin *plugin)
 {
+	if (plugin->priv->props == NULL)
+		return;
+
         /* Reset the properties and wait for the signal*/
         bacon_video_widget_properties_reset
 		(BACON_VIDEO_WIDGET_PROPERTIES (plugin->priv->props));
@@ -224,12 +235,37 @@ xplayer_movie_properties_plugin_metadata_updated (XplayerObject *xplayer,
 {
 	GtkWidget *bvw;
 
+	if (plugin->priv->props == NULL)
+		return;
+
 	bvw = xplayer_get_video_widget (xplayer);
 	update_properties_from_bvw
 		(BACON_VIDEO_WIDGET_PROPERTIES (plugin->priv->props), bvw);
 	g_object_unref (bvw);
 }
 
+static GtkWidget *
+build_properties (XplayerMoviePropertiesPlugin *plugin)
+{
+	XplayerObject *xplayer;
+	char *mrl;
+
+	xplayer = g_object_get_data (G_OBJECT (plugin), "object");
+
+	plugin->priv->props = bacon_video_widget_properties_new ();
+	gtk_widget_set_sensitive (plugin->priv->props, FALSE);
+
+	/* Catch up with the file opened before the page was shown */
+	mrl = xplayer_get_current_mrl (xplayer);
+	if (mrl != NULL) {
+		xplayer_movie_properties_plugin_file_opened (xplayer, mrl, plugin);
+		stream_length_notify_cb (xplayer, NULL, plugin);
+		g_free (mrl);
+	}
+
+	return plugin->priv->props;
+}
+
 static void
 impl_activate (PeasActivatable *plugin)
 {
@@ -239,13 +275,14 @@ impl_activate (PeasActivatable *plugin)
 	pi = XPLAYER_MOVIE_PROPERTIES_PLUGIN (plugin);
 	xplayer = g_object_get_data (G_OBJECT (plugin), "object");
 
-	pi->priv->props = bacon_video_widget_properties_new ();
-	gtk_widget_show (pi->priv->props);
+	/* The properties are only built when the page is first shown */
+	pi->priv->props = NULL;
+	pi->priv->page = xplayer_interface_lazy_new ((XplayerInterfaceBuildFunc) build_properties, pi, NULL);
+	gtk_widget_show (pi->priv->page);
 	xplayer_add_sidebar_page (xplayer,
 				"properties",
 				_("Properties"),
-				pi->priv->props);
-	gtk_widget_set_sensitive (pi->priv->props, FALSE);
+				pi->priv->page);
 
 	g_signal_connect (G_OBJECT (xplayer),
 			  "file-opened",
@@ -286,5 +323,7 @@ impl_deactivate (PeasActivatable *plugin)
 					      plugin);
 	pi->priv->handler_id_stream_length = 0;
 	xplayer_remove_sidebar_page (xplayer, "properties");
+	pi->priv->page = NULL;
+	pi->priv->props = NULL;
 }
 
@@ -41,12 +41,31 @@
 
 #include "xplayer-dirs.h"
 #include "xplayer-plugins-engine.h"
+#include "xplayer-trace.h"
+
+/* How long after startup the plugins activated on idle get loaded,
+ * in seconds */
+#define IDLE_ACTIVATION_DELAY 5
+
+/* When plugins get loaded, as given by the X-Xplayer-Activation key of
+ * their .plugin file, the default being on startup */
+typedef enum {
+	ACTIVATION_STARTUP = 1 << 0,
+	ACTIVATION_OPEN    = 1 << 1,
+	ACTIVATION_IDLE    = 1 << 2
+} PluginActivation;
 
 typedef struct _XplayerPluginsEnginePrivate{
 	PeasExtensionSet *activatable_extensions;
 	XplayerObject *xplayer;
 	GSettings *settings;
 	guint garbage_collect_id;
+
+	/* The active plugins which are waiting for their trigger */
+	GList *pending_plugins; /* of PeasPluginInfo */
+	PluginActivation triggered;
+	guint idle_activation_id;
+	gulong file_opened_id;
 } _XplayerPluginsEnginePrivate;
 
 G_DEFINE_TYPE(XplayerPluginsEngine, xplayer_plugins_engine, PEAS_TYPE_ENGINE)
@@ -93,11 +112,208 @@ on_activatable_extension_removed (PeasExtensionSet *set,
 	peas_activatable_deactivate (PEAS_ACTIVATABLE (exten));
 }
 
+static PluginActivation
+get_plugin_activation (PeasPluginInfo *info)
+{
+	const char *activation;
+
+	activation = peas_plugin_info_get_external_data (info, "Xplayer-Activation");
+	if (g_strcmp0 (activation, "open") == 0)
+		return ACTIVATION_OPEN;
+	if (g_strcmp0 (activation, "idle") == 0)
+		return ACTIVATION_IDLE;
+	return ACTIVATION_STARTUP;
+}
+
+static void
+load_plugin (XplayerPluginsEngine *engine,
+	     PeasPluginInfo *info)
+{
+	gint64 start;
+
+	start = g_get_monotonic_time ();
+	if (peas_engine_load_plugin (PEAS_ENGINE (engine), info) == FALSE)
+		return;
+
+	g_debug ("Activated plugin '%s' in %.1f ms",
+		 peas_plugin_info_get_module_name (info),
+		 (g_get_monotonic_time () - start) / 1000.0);
+	if (xplayer_trace_is_enabled ())
+		xplayer_trace_add ("plugin_activate", start, g_get_monotonic_time (),
+				   "%s", peas_plugin_info_get_module_name (info));
+}
+
+static void
+activate_pending_plugins (XplayerPluginsEngine *engine,
+			  PluginActivation triggers)
+{
+	XplayerPluginsEnginePrivate *priv = engine->priv;
+	GList *l, *next;
+
+	priv->triggered |= triggers;
+
+	for (l = priv->pending_plugins; l != NULL; l = next) {
+		PeasPluginInfo *info = l->data;
+
+		next = l->next;
+		if ((get_plugin_activation (info) & priv->triggered) == 0)
+			continue;
+
+		priv->pending_plugins = g_list_delete_link (priv->pending_plugins, l);
+		load_plugin (engine, info);
+	}
+}
+
+static gboolean
+idle_activation_cb (XplayerPluginsEngine *engine)
+{
+	engine->priv->idle_activation_id = 0;
+	activate_pending_plugins (engine, ACTIVATION_IDLE);
+
+	return FALSE;
+}
+
+static void
+file_opened_cb (XplayerObject *xplayer,
+		const char *mrl,
+		XplayerPluginsEngine *engine)
+{
+	g_signal_handler_disconnect (xplayer, engine->priv->file_opened_id);
+	engine->priv->file_opened_id = 0;
+
+	activate_pending_plugins (engine, ACTIVATION_OPEN);
+}
+
+static gboolean
+strv_contains (char **strv,
+	       const char *str)
+{
+	guint i;
+
+	for (i = 0; strv[i] != NULL; i++) {
+		if (strcmp (strv[i], str) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* The plugins waiting for their trigger are still active, as far as
+ * the settings are concerned */
+static char **
+get_active_plugins (XplayerPluginsEngine *engine)
+{
+	GPtrArray *active;
+	char **loaded;
+	GList *l;
+	guint i;
+
+	active = g_ptr_array_new ();
+
+	loaded = peas_engine_get_loaded_plugins (PEAS_ENGINE (engine));
+	for (i = 0; loaded[i] != NULL; i++)
+		g_ptr_array_add (active, loaded[i]);
+	g_free (loaded);
+
+	for (l = engine->priv->pending_plugins; l != NULL; l = l->next) {
+		if (peas_plugin_info_is_loaded (l->data) == FALSE)
+			g_ptr_array_add (active, g_strdup (peas_plugin_info_get_module_name (l->data)));
+	}
+	g_ptr_array_add (active, NULL);
+
+	return (char **) g_ptr_array_free (active, FALSE);
+}
+
+static gboolean
+strv_equal (char **a, char **b)
+{
+	guint i;
+
+	if (g_strv_length (a) != g_strv_length (b))
+		return FALSE;
+	for (i = 0; a[i] != NULL; i++) {
+		if (strv_contains (b, a[i]) == FALSE)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+loaded_plugins_changed_cb (XplayerPluginsEngine *engine,
+			   GParamSpec *pspec,
+			   gpointer user_data)
+{
+	char **active, **saved;
+
+	active = get_active_plugins (engine);
+	saved = g_settings_get_strv (engine->priv->settings, "active-plugins");
+
+	if (strv_equal (active, saved) == FALSE)
+		g_settings_set_strv (engine->priv->settings, "active-plugins", (const char * const *) active);
+
+	g_strfreev (saved);
+	g_strfreev (active);
+}
+
+/* Loads the active plugins whose trigger has already happened, and
+ * unloads the ones which aren't active anymore */
+static void
+active_plugins_changed_cb (GSettings *settings,
+			   const char *key,
+			   XplayerPluginsEngine *engine)
+{
+	XplayerPluginsEnginePrivate *priv = engine->priv;
+	const GList *plugin_infos, *l;
+	char **active;
+
+	active = g_settings_get_strv (settings, "active-plugins");
+	plugin_infos = peas_engine_get_plugin_list (PEAS_ENGINE (engine));
+
+	for (l = plugin_infos; l != NULL; l = l->next) {
+		PeasPluginInfo *info = PEAS_PLUGIN_INFO (l->data);
+		const char *module_name;
+
+		if (peas_plugin_info_is_builtin (info))
+			continue;
+
+		module_name = peas_plugin_info_get_module_name (info);
+		if (strv_contains (active, module_name) == FALSE) {
+			priv->pending_plugins = g_list_remove (priv->pending_plugins, info);
+			if (peas_plugin_info_is_loaded (info))
+				peas_engine_unload_plugin (PEAS_ENGINE (engine), info);
+		} else if (peas_plugin_info_is_loaded (info) == FALSE &&
+			   g_list_find (priv->pending_plugins, info) == NULL) {
+			if ((get_plugin_activation (info) & (priv->triggered | ACTIVATION_STARTUP)) != 0)
+				load_plugin (engine, info);
+			else
+				priv->pending_plugins = g_list_prepend (priv->pending_plugins, info);
+		}
+	}
+
+	g_strfreev (active);
+}
+
+/**
+ * xplayer_plugins_engine_activate_pending:
+ * @self: a #XplayerPluginsEngine
+ *
+ * Loads all the active plugins which are still waiting for their trigger,
+ * as the plugin manager needs them to be loaded to show them as active.
+ **/
+void
+xplayer_plugins_engine_activate_pending (XplayerPluginsEngine *self)
+{
+	g_return_if_fail (XPLAYER_IS_PLUGINS_ENGINE (self));
+
+	activate_pending_plugins (self, ACTIVATION_STARTUP | ACTIVATION_OPEN | ACTIVATION_IDLE);
+}
+
 XplayerPluginsEngine *
 xplayer_plugins_engine_get_default (XplayerObject *xplayer)
 {
 	static XplayerPluginsEngine *engine = NULL;
-	char **paths;
+	char **paths, **active;
 	guint i;
 	const GList *plugin_infos, *l;
 
@@ -121,6 +337,7 @@ xplayer_plugins_engine_get_default (XplayerObject *xplayer)
 	}
 	g_strfreev (paths);
 
+	/* The interpreter only gets loaded with the first Python plugin */
 	peas_engine_enable_loader (PEAS_ENGINE (engine), "python3");
 
 	g_object_add_weak_pointer (G_OBJECT (engine),
@@ -138,18 +355,36 @@ xplayer_plugins_engine_get_default (XplayerObject *xplayer)
 	g_signal_connect (engine->priv->activatable_extensions, "extension-removed",
 			  G_CALLBACK (on_activatable_extension_removed), engine);
 
-	g_settings_bind (engine->priv->settings, "active-plugins", engine, "loaded-plugins", G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
-
-	/* Load builtin plugins */
+	/* Load builtin plugins, and the active ones which are needed on
+	 * startup, the others waiting for their trigger */
+	active = g_settings_get_strv (engine->priv->settings, "active-plugins");
 	plugin_infos = peas_engine_get_plugin_list (PEAS_ENGINE (engine));
 
 	for (l = plugin_infos; l != NULL; l = l->next) {
 		PeasPluginInfo *plugin_info = PEAS_PLUGIN_INFO (l->data);
 
 		if (peas_plugin_info_is_builtin (plugin_info)) {
-			peas_engine_load_plugin (PEAS_ENGINE (engine), plugin_info);
+			load_plugin (engine, plugin_info);
+		} else if (strv_contains (active, peas_plugin_info_get_module_name (plugin_info))) {
+			if (get_plugin_activation (plugin_info) == ACTIVATION_STARTUP)
+				load_plugin (engine, plugin_info);
+			else
+				engine->priv->pending_plugins = g_list_prepend (engine->priv->pending_plugins, plugin_info);
 		}
 	}
+	g_strfreev (active);
+
+	engine->priv->triggered = ACTIVATION_STARTUP;
+	engine->priv->file_opened_id = g_signal_connect (xplayer, "file-opened",
+							 G_CALLBACK (file_opened_cb), engine);
+	engine->priv->idle_activation_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, IDLE_ACTIVATION_DELAY,
+								       (GSourceFunc) idle_activation_cb, engine, NULL);
+
+	/* Keep the settings and the loaded plugins in sync, in both directions */
+	g_signal_connect (engine, "notify::loaded-plugins",
+			  G_CALLBACK (loaded_plugins_changed_cb), NULL);
+	g_signal_connect (engine->priv->settings, "changed::active-plugins",
+			  G_CALLBACK (active_plugins_changed_cb), engine);
 
 	return engine;
 }
@@ -198,6 +433,22 @@ xplayer_plugins_engine_dispose (GObject *object)
 	if (engine->priv->activatable_extensions != NULL)
 		xplayer_plugins_engine_shut_down (engine);
 
+	if (engine->priv->idle_activation_id > 0)
+		g_source_remove (engine->priv->idle_activation_id);
+	engine->priv->idle_activation_id = 0;
+
+	if (engine->priv->file_opened_id > 0)
+		g_signal_handler_disconnect (engine->priv->xplayer, engine->priv->file_opened_id);
+	engine->priv->file_opened_id = 0;
+
+	g_list_free (engine->priv->pending_plugins);
+	engine->priv->pending_plugins = NULL;
+
+	/* Unloading the plugins on exit doesn't make them inactive */
+	g_signal_handlers_disconnect_by_func (engine, loaded_plugins_changed_cb, NULL);
+	if (engine->priv->settings != NULL)
+		g_signal_handlers_disconnect_by_func (engine->priv->settings, active_plugins_changed_cb, engine);
+
 	if (engine->priv->garbage_collect_id > 0)
 		g_source_remove (engine->priv->garbage_collect_id);
 	engine->priv->garbage_collect_id = 0;
@@ -61,6 +61,7 @@ struct _XplayerPluginsEngineClass
 GType			xplayer_plugins_engine_get_type			(void) G_GNUC_CONST;
 XplayerPluginsEngine	*xplayer_plugins_engine_get_default		(XplayerObject *xplayer);
 void			xplayer_plugins_engine_shut_down			(XplayerPluginsEngine *self);
+void			xplayer_plugins_engine_activate_pending		(XplayerPluginsEngine *self);
 
 G_END_DECLS
 
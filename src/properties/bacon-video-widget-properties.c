@@ -259,7 +259,7 @@ bacon_video_widget_properties_new (void)
 
 	xml = gtk_builder_new ();
 	gtk_builder_set_translation_domain (xml, GETTEXT_PACKAGE);
-	if (gtk_builder_add_from_file (xml, DATADIR"/properties.ui", NULL) == 0) {
+	if (gtk_builder_add_from_resource (xml, XPLAYER_INTERFACE_RESOURCE_PATH "properties.ui", NULL) == 0) {
 		g_object_unref (xml);
 		return NULL;
 	}
@@ -0,0 +1,216 @@
+/*
+ * Checks the movie hashes against ones computed separately, on files
+ * of generated data, and that changed files don't get stale hashes
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "xplayer-movie-hash.h"
+
+/* Not a multiple of 8, so that the last 64 KiB don't
+ * start on the same boundaries as the first */
+#define MOVIE_SIZE 200003
+#define SMALLEST_SIZE (128 * 1024)
+
+/* Pseudo-random bytes from the C standard's example rand(),
+ * so that the sums don't cancel out */
+static char *
+make_data (gsize size, guint32 seed)
+{
+	char *data;
+	gsize i;
+
+	data = g_malloc (size);
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (seed >> 16) & 0xff;
+	}
+
+	return data;
+}
+
+static void
+write_data (GFile *file, gsize size, guint32 seed)
+{
+	GError *error = NULL;
+	char *data;
+
+	data = make_data (size, seed);
+	g_file_replace_contents (file, data, size, NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_free (data);
+}
+
+static GFile *
+make_file (gsize size, guint32 seed)
+{
+	GFileIOStream *stream;
+	GError *error = NULL;
+	GFile *file;
+
+	file = g_file_new_tmp ("test-movie-hash-XXXXXX", &stream, &error);
+	g_assert_no_error (error);
+	g_object_unref (stream);
+
+	write_data (file, size, seed);
+
+	return file;
+}
+
+static void
+delete_file (GFile *file)
+{
+	g_file_delete (file, NULL, NULL);
+	g_object_unref (file);
+}
+
+static void
+check_hash (gsize size, const char *expected)
+{
+	GError *error = NULL;
+	GFile *file;
+	guint64 hashed_size = 0;
+	char *hash;
+
+	file = make_file (size, 1);
+
+	hash = xplayer_movie_hash (file, &hashed_size, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (hash, ==, expected);
+	g_assert_cmpuint (hashed_size, ==, size);
+	g_free (hash);
+
+	delete_file (file);
+}
+
+/* The expected hashes were computed with Python's struct module */
+static void
+test_hash (void)
+{
+	check_hash (MOVIE_SIZE, "e51ff36f97e19bde");
+}
+
+/* Where the first and the last 64 KiB are the whole file */
+static void
+test_smallest (void)
+{
+	check_hash (SMALLEST_SIZE, "2c190caafbb0c52e");
+}
+
+static void
+test_too_small (void)
+{
+	GError *error = NULL;
+	GFile *file;
+	char *hash;
+
+	file = make_file (SMALLEST_SIZE - 1, 1);
+
+	hash = xplayer_movie_hash (file, NULL, NULL, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert (hash == NULL);
+	g_error_free (error);
+
+	delete_file (file);
+}
+
+/* Same size, but different contents and modification time */
+static void
+test_changed (void)
+{
+	GError *error = NULL;
+	GFileInfo *info;
+	GFile *file;
+	guint64 mtime;
+	char *hash;
+
+	file = make_file (MOVIE_SIZE, 1);
+
+	hash = xplayer_movie_hash (file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (hash, ==, "e51ff36f97e19bde");
+	g_free (hash);
+
+	info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE, NULL, &error);
+	g_assert_no_error (error);
+	mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	g_object_unref (info);
+
+	/* Possibly rewritten within the same second, so the
+	 * modification time is moved on explicitly */
+	write_data (file, MOVIE_SIZE, 2);
+	g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime + 60,
+				     G_FILE_QUERY_INFO_NONE, NULL, &error);
+	g_assert_no_error (error);
+
+	hash = xplayer_movie_hash (file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (hash, ==, "efb2d365b0c3f312");
+	g_free (hash);
+
+	delete_file (file);
+}
+
+static void
+hash_ready_cb (GFile        *file,
+	       GAsyncResult *result,
+	       GAsyncResult **result_out)
+{
+	*result_out = g_object_ref (result);
+}
+
+static void
+test_async (void)
+{
+	GAsyncResult *result = NULL;
+	GError *error = NULL;
+	GFile *file;
+	guint64 hashed_size = 0;
+	char *hash;
+
+	file = make_file (MOVIE_SIZE, 1);
+
+	xplayer_movie_hash_async (file, NULL, (GAsyncReadyCallback) hash_ready_cb, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+
+	hash = xplayer_movie_hash_finish (result, &hashed_size, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (hash, ==, "e51ff36f97e19bde");
+	g_assert_cmpuint (hashed_size, ==, MOVIE_SIZE);
+	g_free (hash);
+	g_object_unref (result);
+
+	delete_file (file);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/movie-hash/hash", test_hash);
+	g_test_add_func ("/movie-hash/smallest", test_smallest);
+	g_test_add_func ("/movie-hash/too-small", test_too_small);
+	g_test_add_func ("/movie-hash/changed", test_changed);
+	g_test_add_func ("/movie-hash/async", test_async);
+
+	return g_test_run ();
+}
@@ -46,6 +46,7 @@
 #include <gtk/gtkx.h>
 
 #include "xplayer-interface.h"
+#include "xplayer-trace.h"
 
 static GtkWidget *
 xplayer_interface_error_dialog (const char *title, const char *reason,
@@ -171,30 +172,79 @@ xplayer_interface_error_with_link (const char *title, const char *reason,
 GtkBuilder *
 xplayer_interface_load (const char *name, gboolean fatal, GtkWindow *parent, gpointer user_data)
 {
-	GtkBuilder *builder = NULL;
-	char *filename;
+	GtkBuilder *builder;
+	char *path;
 
-	filename = xplayer_interface_get_full_path (name);
-	if (filename == NULL) {
+	/* The UI files are compiled in, and not installed */
+	path = g_strconcat (XPLAYER_INTERFACE_RESOURCE_PATH, name, NULL);
+	builder = xplayer_interface_load_with_resource_path (path, fatal, parent, user_data);
+	g_free (path);
+
+	return builder;
+}
+
+static GtkBuilder *
+interface_load_builder (const char *path, gboolean resource, gboolean fatal,
+			GtkWindow *parent, gpointer user_data)
+{
+	GtkBuilder *builder;
+	GError *error = NULL;
+	gint64 trace_start;
+	gboolean ret;
+
+	trace_start = xplayer_trace_begin ();
+
+	builder = gtk_builder_new ();
+	gtk_builder_set_translation_domain (builder, GETTEXT_PACKAGE);
+
+	if (resource != FALSE)
+		ret = gtk_builder_add_from_resource (builder, path, &error);
+	else
+		ret = gtk_builder_add_from_file (builder, path, &error);
+
+	if (ret == FALSE) {
 		char *msg;
 
-		msg = g_strdup_printf (_("Couldn't load the '%s' interface. %s"), name, _("The file does not exist."));
+		msg = g_strdup_printf (_("Couldn't load the '%s' interface. %s"), path, error->message);
 		if (fatal == FALSE)
 			xplayer_interface_error (msg, _("Make sure that Xplayer is properly installed."), parent);
 		else
 			xplayer_interface_error_blocking (msg, _("Make sure that Xplayer is properly installed."), parent);
 
 		g_free (msg);
+		g_error_free (error);
+		g_object_unref (builder);
+
 		return NULL;
 	}
 
-	builder = xplayer_interface_load_with_full_path (filename, fatal, parent,
-						       user_data);
-	g_free (filename);
+	gtk_builder_connect_signals (builder, user_data);
+
+	xplayer_trace_end_with_detail ("interface_load", trace_start, "%s", path);
 
 	return builder;
 }
 
+/**
+ * xplayer_interface_load_with_resource_path:
+ * @path: the resource path of the #GtkBuilder UI file to load
+ * @fatal: %TRUE if errors loading the file should be fatal, %FALSE otherwise
+ * @parent: (allow-none): the parent window to use when displaying error dialogues, or %NULL
+ * @user_data: (allow-none): the user data to pass to gtk_builder_connect_signals(), or %NULL
+ *
+ * Load a #GtkBuilder UI file from the given #GResource path and return the #GtkBuilder instance for it. If loading the file fails, an error dialogue is shown.
+ *
+ * Return value: (transfer full): the loaded #GtkBuilder object, or %NULL
+ */
+GtkBuilder *
+xplayer_interface_load_with_resource_path (const char *path, gboolean fatal,
+					   GtkWindow *parent, gpointer user_data)
+{
+	g_return_val_if_fail (path != NULL, NULL);
+
+	return interface_load_builder (path, TRUE, fatal, parent, user_data);
+}
+
 /**
  * xplayer_interface_load_with_full_path:
  * @filename: the #GtkBuilder UI file path to load
@@ -210,32 +260,10 @@ GtkBuilder *
 xplayer_interface_load_with_full_path (const char *filename, gboolean fatal, 
 				     GtkWindow *parent, gpointer user_data)
 {
-	GtkBuilder *builder = NULL;
-	GError *error = NULL;
-
-	if (filename != NULL) {
-		builder = gtk_builder_new ();
-		gtk_builder_set_translation_domain (builder, GETTEXT_PACKAGE);
-	}
-
-	if (builder == NULL || gtk_builder_add_from_file (builder, filename, &error) == FALSE) {
-		char *msg;
-
-		msg = g_strdup_printf (_("Couldn't load the '%s' interface. %s"), filename, error->message);
-		if (fatal == FALSE)
-			xplayer_interface_error (msg, _("Make sure that Xplayer is properly installed."), parent);
-		else
-			xplayer_interface_error_blocking (msg, _("Make sure that Xplayer is properly installed."), parent);
-
-		g_free (msg);
-		g_error_free (error);
-
+	if (filename == NULL)
 		return NULL;
-	}
-
-	gtk_builder_connect_signals (builder, user_data);
 
-	return builder;
+	return interface_load_builder (filename, FALSE, fatal, parent, user_data);
 }
 
 /**
@@ -376,3 +404,85 @@ xplayer_interface_get_license (void)
 			  NULL);
 }
 
+
+typedef struct {
+	XplayerInterfaceBuildFunc build_func;
+	gpointer user_data;
+	GDestroyNotify destroy;
+	GtkWidget *child;
+} LazyData;
+
+static void
+lazy_data_free (LazyData *data)
+{
+	if (data->destroy != NULL)
+		data->destroy (data->user_data);
+	g_slice_free (LazyData, data);
+}
+
+static void
+lazy_map_cb (GtkWidget *placeholder,
+	     LazyData *data)
+{
+	g_signal_handlers_disconnect_by_func (placeholder, lazy_map_cb, data);
+
+	data->child = data->build_func (data->user_data);
+	if (data->child == NULL)
+		return;
+
+	gtk_box_pack_start (GTK_BOX (placeholder), data->child, TRUE, TRUE, 0);
+	gtk_widget_show (data->child);
+}
+
+/**
+ * xplayer_interface_lazy_new:
+ * @build_func: (scope notified): the function building the contents
+ * @user_data: (closure): the user data to pass to @build_func
+ * @destroy: (allow-none): the function to free @user_data, or %NULL
+ *
+ * Creates an empty container, which only gets its contents built by
+ * @build_func when first shown on screen, so that the interfaces which
+ * most sessions never look at cost nothing on startup.
+ *
+ * Return value: (transfer floating): the container
+ */
+GtkWidget *
+xplayer_interface_lazy_new (XplayerInterfaceBuildFunc build_func,
+			    gpointer user_data,
+			    GDestroyNotify destroy)
+{
+	GtkWidget *placeholder;
+	LazyData *data;
+
+	g_return_val_if_fail (build_func != NULL, NULL);
+
+	data = g_slice_new0 (LazyData);
+	data->build_func = build_func;
+	data->user_data = user_data;
+	data->destroy = destroy;
+
+	placeholder = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+	g_object_set_data_full (G_OBJECT (placeholder), "xplayer-lazy-data", data, (GDestroyNotify) lazy_data_free);
+	g_signal_connect (placeholder, "map", G_CALLBACK (lazy_map_cb), data);
+
+	return placeholder;
+}
+
+/**
+ * xplayer_interface_lazy_get_child:
+ * @placeholder: a container created with xplayer_interface_lazy_new()
+ *
+ * Returns the contents of @placeholder, if they've been built yet.
+ *
+ * Return value: (transfer none) (allow-none): the contents, or %NULL
+ */
+GtkWidget *
+xplayer_interface_lazy_get_child (GtkWidget *placeholder)
+{
+	LazyData *data;
+
+	data = g_object_get_data (G_OBJECT (placeholder), "xplayer-lazy-data");
+	g_return_val_if_fail (data != NULL, NULL);
+
+	return data->child;
+}
@@ -28,6 +28,19 @@
 
 G_BEGIN_DECLS
 
+/* Where the UI files compiled into libxplayer live */
+#define XPLAYER_INTERFACE_RESOURCE_PATH "/org/x/player/ui/"
+
+/**
+ * XplayerInterfaceBuildFunc:
+ * @user_data: the user data passed to xplayer_interface_lazy_new()
+ *
+ * Builds the contents of a container created with xplayer_interface_lazy_new().
+ *
+ * Return value: (transfer floating): the contents, or %NULL
+ */
+typedef GtkWidget * (*XplayerInterfaceBuildFunc) (gpointer user_data);
+
 GdkPixbuf	*xplayer_interface_load_pixbuf	(const char *name);
 char		*xplayer_interface_get_full_path	(const char *name);
 GtkBuilder	*xplayer_interface_load		(const char *name,
@@ -38,6 +51,10 @@ GtkBuilder      *xplayer_interface_load_with_full_path (const char *filename,
 						      gboolean fatal, 
 						      GtkWindow *parent,
 						      gpointer user_data);
+GtkBuilder      *xplayer_interface_load_with_resource_path (const char *path,
+							  gboolean fatal,
+							  GtkWindow *parent,
+							  gpointer user_data);
 void		 xplayer_interface_error		(const char *title,
 						 const char *reason,
 						 GtkWindow *parent);
@@ -52,6 +69,10 @@ void		 xplayer_interface_error_with_link (const char *title,
 void		 xplayer_interface_set_transient_for (GtkWindow *window,
 						    GtkWindow *parent);
 char *		 xplayer_interface_get_license	(void);
+GtkWidget *	 xplayer_interface_lazy_new	(XplayerInterfaceBuildFunc build_func,
+						 gpointer user_data,
+						 GDestroyNotify destroy);
+GtkWidget *	 xplayer_interface_lazy_get_child (GtkWidget *placeholder);
 
 G_END_DECLS
 
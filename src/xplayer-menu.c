@@ -35,10 +35,11 @@
 #include "xplayer-interface.h"
 #include "xplayer-private.h"
 #include "xplayer-sidebar.h"
+#include "xplayer-preferences.h"
 #include "bacon-video-widget.h"
 #include "xplayer-uri.h"
 
-#include "xplayer-profile.h"
+#include "xplayer-trace.h"
 
 #define XPLAYER_MAX_RECENT_ITEM_LEN 40
 
@@ -596,7 +597,7 @@ quit_action_callback (GtkAction *action, Xplayer *xplayer)
 void
 preferences_action_callback (GtkAction *action, Xplayer *xplayer)
 {
-	gtk_widget_show (xplayer->prefs);
+	xplayer_show_preferences (xplayer);
 }
 
 void
@@ -677,13 +678,13 @@ dvd_chapter_menu_action_callback (GtkAction *action, Xplayer *xplayer)
 void
 next_chapter_action_callback (GtkAction *action, Xplayer *xplayer)
 {
-	XPLAYER_PROFILE (xplayer_action_next (xplayer));
+	XPLAYER_TRACE ("xplayer_action_next", xplayer_action_next (xplayer));
 }
 
 void
 previous_chapter_action_callback (GtkAction *action, Xplayer *xplayer)
 {
-	XPLAYER_PROFILE (xplayer_action_previous (xplayer));
+	XPLAYER_TRACE ("xplayer_action_previous", xplayer_action_previous (xplayer));
 }
 
 void
@@ -757,6 +758,11 @@ plugins_action_callback (GtkAction *action, Xplayer *xplayer)
 	if (xplayer->plugins == NULL) {
 		GtkWidget *manager;
 
+		/* So that the plugins still waiting for their trigger are
+		 * shown as active */
+		if (xplayer->engine != NULL)
+			xplayer_plugins_engine_activate_pending (xplayer->engine);
+
 		xplayer->plugins = gtk_dialog_new_with_buttons (_("Configure Plugins"),
 							      GTK_WINDOW (xplayer->win),
 							      GTK_DIALOG_DESTROY_WITH_PARENT,
@@ -0,0 +1,317 @@
+/* xplayer-movie-hash.c
+
+   The Gnome Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   The Gnome Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with the Gnome Library; see the file COPYING.LIB.  If not,
+   write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301  USA.
+ */
+
+/**
+ * SECTION:xplayer-movie-hash
+ * @short_description: movie hashes for subtitle lookups
+ * @stability: Unstable
+ * @include: xplayer-movie-hash.h
+ *
+ * Computes the hash used by OpenSubtitles and similar services to identify
+ * a movie file: the file size plus the sums of the first and last 64 KiB
+ * of the file, taken as little-endian 64-bit integers.
+ *
+ * Hashes are cached for as long as the size and modification time, or the
+ * entity tag, of the file don't change, so that repeated lookups of the same
+ * file don't read it again.
+ **/
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+
+#include "xplayer-movie-hash.h"
+
+#define HASH_CHUNK_SIZE 65536
+#define HASH_CACHE_SIZE 64
+
+#define QUERY_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+			 G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+			 G_FILE_ATTRIBUTE_ETAG_VALUE
+
+/* Hashes, keyed by file fingerprint */
+static GHashTable *hash_cache = NULL;
+G_LOCK_DEFINE_STATIC (hash_cache);
+
+/* Identifies a version of a file, without reading it */
+static char *
+get_fingerprint (GFile *file, GFileInfo *info)
+{
+	char *uri, *fingerprint;
+	const char *etag;
+
+	uri = g_file_get_uri (file);
+	etag = g_file_info_get_etag (info);
+	fingerprint = g_strdup_printf ("%s %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %s",
+				       uri,
+				       (guint64) g_file_info_get_size (info),
+				       g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+				       etag ? etag : "");
+	g_free (uri);
+
+	return fingerprint;
+}
+
+/* Independent accumulators, so that the additions can be pipelined,
+ * or vectorised by the compiler */
+static guint64
+sum_chunk (const guint64 *chunk)
+{
+	guint64 a = 0, b = 0, c = 0, d = 0;
+	guint i;
+
+	for (i = 0; i < HASH_CHUNK_SIZE / sizeof (guint64); i += 4) {
+		a += GUINT64_FROM_LE (chunk[i]);
+		b += GUINT64_FROM_LE (chunk[i + 1]);
+		c += GUINT64_FROM_LE (chunk[i + 2]);
+		d += GUINT64_FROM_LE (chunk[i + 3]);
+	}
+
+	return a + b + c + d;
+}
+
+static gboolean
+read_chunk (GInputStream *stream, guint64 *chunk, GCancellable *cancellable, GError **error)
+{
+	gsize bytes_read;
+
+	if (g_input_stream_read_all (stream, chunk, HASH_CHUNK_SIZE, &bytes_read, cancellable, error) == FALSE)
+		return FALSE;
+
+	if (bytes_read != HASH_CHUNK_SIZE) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     _("The file could not be read completely."));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static char *
+compute_hash (GFile *file, guint64 size, GCancellable *cancellable, GError **error)
+{
+	GFileInputStream *stream;
+	guint64 *chunk;
+	guint64 hash;
+	gboolean ret;
+
+	stream = g_file_read (file, cancellable, error);
+	if (stream == NULL)
+		return NULL;
+
+	chunk = g_malloc (HASH_CHUNK_SIZE);
+	hash = size;
+
+	ret = read_chunk (G_INPUT_STREAM (stream), chunk, cancellable, error);
+	if (ret != FALSE) {
+		hash += sum_chunk (chunk);
+
+		/* Remote streams might not be seekable, in which case the
+		 * middle of the file gets streamed through */
+		if (g_seekable_can_seek (G_SEEKABLE (stream))) {
+			ret = g_seekable_seek (G_SEEKABLE (stream), size - HASH_CHUNK_SIZE, G_SEEK_SET,
+					       cancellable, error);
+		} else {
+			guint64 remaining = size - 2 * HASH_CHUNK_SIZE;
+
+			while (ret != FALSE && remaining > 0) {
+				gssize skipped;
+
+				skipped = g_input_stream_skip (G_INPUT_STREAM (stream), MIN (remaining, G_MAXSSIZE),
+							       cancellable, error);
+				if (skipped == 0) {
+					g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+							     _("The file could not be read completely."));
+				}
+				if (skipped <= 0)
+					ret = FALSE;
+				else
+					remaining -= skipped;
+			}
+		}
+	}
+	if (ret != FALSE)
+		ret = read_chunk (G_INPUT_STREAM (stream), chunk, cancellable, error);
+	if (ret != FALSE)
+		hash += sum_chunk (chunk);
+
+	g_free (chunk);
+	g_input_stream_close (G_INPUT_STREAM (stream), NULL, NULL);
+	g_object_unref (stream);
+
+	if (ret == FALSE)
+		return NULL;
+
+	return g_strdup_printf ("%016" G_GINT64_MODIFIER "x", hash);
+}
+
+/**
+ * xplayer_movie_hash:
+ * @file: a #GFile
+ * @size: (out) (allow-none): return location for the size of @file, or %NULL
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Computes the movie hash of @file, which can be any file GIO can read.
+ * This does blocking I/O, see xplayer_movie_hash_async() for the
+ * asynchronous version.
+ *
+ * Files smaller than 128 KiB can't be hashed, and return a
+ * %G_IO_ERROR_INVALID_DATA error.
+ *
+ * Return value: the hash as a 16 character hexadecimal string, or %NULL on error
+ **/
+char *
+xplayer_movie_hash (GFile *file, guint64 *size, GCancellable *cancellable, GError **error)
+{
+	GFileInfo *info;
+	char *fingerprint, *hash;
+	guint64 file_size;
+
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	info = g_file_query_info (file, QUERY_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, cancellable, error);
+	if (info == NULL)
+		return NULL;
+
+	file_size = g_file_info_get_size (info);
+	fingerprint = get_fingerprint (file, info);
+	g_object_unref (info);
+
+	G_LOCK (hash_cache);
+	hash = hash_cache ? g_strdup (g_hash_table_lookup (hash_cache, fingerprint)) : NULL;
+	G_UNLOCK (hash_cache);
+
+	if (hash != NULL) {
+		g_free (fingerprint);
+		if (size != NULL)
+			*size = file_size;
+		return hash;
+	}
+
+	if (file_size < 2 * HASH_CHUNK_SIZE) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     _("The file is too small to be identified."));
+		g_free (fingerprint);
+		return NULL;
+	}
+
+	hash = compute_hash (file, file_size, cancellable, error);
+	if (hash == NULL) {
+		g_free (fingerprint);
+		return NULL;
+	}
+
+	G_LOCK (hash_cache);
+	if (hash_cache == NULL)
+		hash_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	else if (g_hash_table_size (hash_cache) >= HASH_CACHE_SIZE)
+		g_hash_table_remove_all (hash_cache);
+	g_hash_table_replace (hash_cache, fingerprint, g_strdup (hash));
+	G_UNLOCK (hash_cache);
+
+	if (size != NULL)
+		*size = file_size;
+
+	return hash;
+}
+
+typedef struct {
+	char *hash;
+	guint64 size;
+} HashResult;
+
+static void
+hash_result_free (HashResult *result)
+{
+	g_free (result->hash);
+	g_slice_free (HashResult, result);
+}
+
+static void
+movie_hash_thread (GSimpleAsyncResult *result,
+		   GObject *object,
+		   GCancellable *cancellable)
+{
+	HashResult *data;
+	GError *error = NULL;
+
+	data = g_simple_async_result_get_op_res_gpointer (result);
+	data->hash = xplayer_movie_hash (G_FILE (object), &data->size, cancellable, &error);
+	if (data->hash == NULL)
+		g_simple_async_result_take_error (result, error);
+}
+
+/**
+ * xplayer_movie_hash_async:
+ * @file: a #GFile
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the function to call when the hash is ready
+ * @user_data: (closure): data to pass to @callback
+ *
+ * Computes the movie hash of @file in a thread, see xplayer_movie_hash().
+ **/
+void
+xplayer_movie_hash_async (GFile *file,
+			  GCancellable *cancellable,
+			  GAsyncReadyCallback callback,
+			  gpointer user_data)
+{
+	GSimpleAsyncResult *result;
+
+	g_return_if_fail (G_IS_FILE (file));
+
+	result = g_simple_async_result_new (G_OBJECT (file), callback, user_data,
+					    xplayer_movie_hash_async);
+	g_simple_async_result_set_op_res_gpointer (result, g_slice_new0 (HashResult),
+						   (GDestroyNotify) hash_result_free);
+	g_simple_async_result_run_in_thread (result, movie_hash_thread, G_PRIORITY_DEFAULT, cancellable);
+	g_object_unref (result);
+}
+
+/**
+ * xplayer_movie_hash_finish:
+ * @result: a #GAsyncResult
+ * @size: (out) (allow-none): return location for the size of the file, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Finishes a hash computation started with xplayer_movie_hash_async().
+ *
+ * Return value: the hash as a 16 character hexadecimal string, or %NULL on error
+ **/
+char *
+xplayer_movie_hash_finish (GAsyncResult *result,
+			   guint64 *size,
+			   GError **error)
+{
+	GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+	HashResult *data;
+
+	g_return_val_if_fail (g_simple_async_result_get_source_tag (simple) == xplayer_movie_hash_async, NULL);
+
+	if (g_simple_async_result_propagate_error (simple, error))
+		return NULL;
+
+	data = g_simple_async_result_get_op_res_gpointer (simple);
+	if (size != NULL)
+		*size = data->size;
+
+	return g_strdup (data->hash);
+}
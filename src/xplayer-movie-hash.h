@@ -0,0 +1,40 @@
+/* xplayer-movie-hash.h
+
+   The Gnome Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   The Gnome Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with the Gnome Library; see the file COPYING.LIB.  If not,
+   write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301  USA.
+ */
+
+#ifndef XPLAYER_MOVIE_HASH_H
+#define XPLAYER_MOVIE_HASH_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+char *		xplayer_movie_hash		(GFile *file,
+						 guint64 *size,
+						 GCancellable *cancellable,
+						 GError **error);
+void		xplayer_movie_hash_async	(GFile *file,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+char *		xplayer_movie_hash_finish	(GAsyncResult *result,
+						 guint64 *size,
+						 GError **error);
+
+G_END_DECLS
+
+#endif /* XPLAYER_MOVIE_HASH_H */
@@ -150,53 +150,7 @@ xplayer_object_local_command_line (GApplication              *application,
 				 gchar                   ***arguments,
 				 int                       *exit_status)
 {
-	GOptionContext *context;
-	GError *error = NULL;
-	char **argv;
-	int argc;
-
-	/* Dupe so that the remote arguments are listed, but
-	 * not removed from the list */
-	argv = g_strdupv (*arguments);
-	argc = g_strv_length (argv);
-
-	context = xplayer_options_get_context ();
-	if (g_option_context_parse (context, &argc, &argv, &error) == FALSE) {
-		g_print (_("%s\nRun '%s --help' to see a full list of available command line options.\n"),
-				error->message, argv[0]);
-		g_error_free (error);
-	        *exit_status = 1;
-	        goto bail;
-	}
-
-	/* Replace relative paths with absolute URIs */
-	if (optionstate.filenames != NULL) {
-		guint n_files;
-		int i, n_args;
-
-		n_args = g_strv_length (*arguments);
-		n_files = g_strv_length (optionstate.filenames);
-
-		i = n_args - n_files;
-		for ( ; i < n_args; i++) {
-			char *new_path;
-
-			new_path = xplayer_create_full_path ((*arguments)[i]);
-			if (new_path == NULL)
-				continue;
-
-			g_free ((*arguments)[i]);
-			(*arguments)[i] = new_path;
-		}
-	}
-
-	g_strfreev (optionstate.filenames);
-	optionstate.filenames = NULL;
-
-	*exit_status = 0;
-bail:
-	g_option_context_free (context);
-	g_strfreev (argv);
+	*exit_status = xplayer_options_parse_local (arguments) ? 0 : 1;
 
 	return FALSE;
 }
@@ -504,8 +458,10 @@ xplayer_object_get_property (GObject *object,
  * xplayer_object_plugins_init:
  * @xplayer: a #XplayerObject
  *
- * Initialises the plugin engine and activates all the
- * enabled plugins.
+ * Initialises the plugin engine and activates the enabled plugins
+ * which are needed on startup. The others are activated on the
+ * first file being opened, or a few seconds later, depending on the
+ * X-Xplayer-Activation key of their .plugin file.
  **/
 void
 xplayer_object_plugins_init (XplayerObject *xplayer)
@@ -3655,6 +3611,11 @@ xplayer_action_handle_key_press (XplayerObject *xplayer, GdkEventKey *event)
 	case GDK_KEY_H:
 		xplayer_action_toggle_controls (xplayer);
 		break;
+	case GDK_KEY_i:
+	case GDK_KEY_I:
+		bacon_video_widget_set_show_stats (xplayer->bvw,
+						   !bacon_video_widget_get_show_stats (xplayer->bvw));
+		break;
 	case GDK_KEY_l:
 	case GDK_KEY_L:
 		xplayer_action_cycle_language (xplayer);
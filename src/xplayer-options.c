@@ -26,6 +26,7 @@
 #include <glib/gi18n.h>
 #include <string.h>
 #include <stdlib.h>
+#include <gst/gst.h>
 
 #include "xplayer-options.h"
 #include "xplayer-uri.h"
@@ -34,6 +35,9 @@
 
 XplayerCmdLineOptions optionstate;	/* Decoded command line options */
 
+/* Whether GStreamer is left for bacon_video_widget_preload() to initialise */
+static gboolean defer_gst_init = FALSE;
+
 G_GNUC_NORETURN static gboolean
 option_version_cb (const gchar *option_name,
 	           const gchar *value,
@@ -77,15 +81,20 @@ xplayer_options_get_context (void)
 	GOptionGroup *baconoptiongroup;
 
 	context = g_option_context_new (N_("- Play movies and songs"));
-	baconoptiongroup = bacon_video_widget_get_option_group ();
-	if (baconoptiongroup == NULL) {
-		g_warning ("Clutter or GTK+ failed to initialise properly");
-		g_option_context_free (context);
-		return NULL;
-	}
 	g_option_context_add_main_entries (context, all_options, GETTEXT_PACKAGE);
 	g_option_context_set_translation_domain (context, GETTEXT_PACKAGE);
-	g_option_context_add_group (context, baconoptiongroup);
+
+	/* Parsing GStreamer's options initialises it, which mustn't happen
+	 * while bacon_video_widget_preload() is doing so */
+	if (defer_gst_init == FALSE || gst_is_initialized () != FALSE) {
+		baconoptiongroup = bacon_video_widget_get_option_group ();
+		if (baconoptiongroup == NULL) {
+			g_warning ("Clutter or GTK+ failed to initialise properly");
+			g_option_context_free (context);
+			return NULL;
+		}
+		g_option_context_add_group (context, baconoptiongroup);
+	}
 
 	g_option_context_add_group (context, gtk_get_option_group (FALSE));
 	/* FIXME:
@@ -95,6 +104,115 @@ xplayer_options_get_context (void)
 	return context;
 }
 
+/**
+ * xplayer_options_parse_local:
+ * @arguments: (inout): the command line
+ *
+ * Parses the command line in the process it was given to, before it's
+ * handed to the running instance, if any. --help and --version are
+ * handled there and then, errors are printed, and the relative paths in
+ * @arguments are replaced with absolute URIs, as the running instance
+ * might have another working directory.
+ *
+ * Return value: %FALSE if the command line couldn't be parsed
+ **/
+gboolean
+xplayer_options_parse_local (gchar ***arguments)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	char **argv;
+	int argc;
+	gboolean ret = FALSE;
+
+	/* Dupe so that the remote arguments are listed, but
+	 * not removed from the list */
+	argv = g_strdupv (*arguments);
+	argc = g_strv_length (argv);
+
+	context = xplayer_options_get_context ();
+	if (context == NULL) {
+		g_strfreev (argv);
+		return FALSE;
+	}
+	if (g_option_context_parse (context, &argc, &argv, &error) == FALSE) {
+		g_print (_("%s\nRun '%s --help' to see a full list of available command line options.\n"),
+				error->message, argv[0]);
+		g_error_free (error);
+	        goto bail;
+	}
+
+	/* Replace relative paths with absolute URIs */
+	if (optionstate.filenames != NULL) {
+		guint n_files;
+		int i, n_args;
+
+		n_args = g_strv_length (*arguments);
+		n_files = g_strv_length (optionstate.filenames);
+
+		i = n_args - n_files;
+		for ( ; i < n_args; i++) {
+			char *new_path;
+
+			new_path = xplayer_create_full_path ((*arguments)[i]);
+			if (new_path == NULL)
+				continue;
+
+			g_free ((*arguments)[i]);
+			(*arguments)[i] = new_path;
+		}
+	}
+
+	g_strfreev (optionstate.filenames);
+	optionstate.filenames = NULL;
+
+	ret = TRUE;
+bail:
+	g_option_context_free (context);
+	g_strfreev (argv);
+
+	return ret;
+}
+
+/**
+ * xplayer_options_defer_gst_init:
+ * @argc: the number of arguments in @argv
+ * @argv: the command line
+ *
+ * Leaves GStreamer to be initialised by bacon_video_widget_preload(), in a
+ * thread, rather than while parsing the command line, unless @argv has
+ * options for GStreamer, or asks for help.
+ **/
+void
+xplayer_options_defer_gst_init (int argc, char **argv)
+{
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp (argv[i], "--") == 0)
+			break;
+		if (g_str_has_prefix (argv[i], "--gst-") != FALSE ||
+		    g_str_has_prefix (argv[i], "--help") != FALSE ||
+		    strcmp (argv[i], "-h") == 0 ||
+		    strcmp (argv[i], "-?") == 0)
+			return;
+	}
+
+	defer_gst_init = TRUE;
+}
+
+/**
+ * xplayer_options_gst_init_deferred:
+ *
+ * Return value: %TRUE if GStreamer is left for bacon_video_widget_preload()
+ * to initialise, see xplayer_options_defer_gst_init()
+ **/
+gboolean
+xplayer_options_gst_init_deferred (void)
+{
+	return defer_gst_init;
+}
+
 void
 xplayer_options_process_late (Xplayer *xplayer, const XplayerCmdLineOptions *options)
 {
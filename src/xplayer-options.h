@@ -57,6 +57,9 @@ extern XplayerCmdLineOptions optionstate;
 
 void xplayer_options_register_remote_commands (Xplayer *xplayer);
 GOptionContext *xplayer_options_get_context (void);
+gboolean xplayer_options_parse_local (gchar ***arguments);
+void xplayer_options_defer_gst_init (int argc, char **argv);
+gboolean xplayer_options_gst_init_deferred (void);
 void xplayer_options_process_early (Xplayer *xplayer,
 				  const XplayerCmdLineOptions* options);
 void xplayer_options_process_late (Xplayer *xplayer, 
@@ -36,6 +36,7 @@
 #include "xplayer-interface.h"
 #include "xplayer-rtl-helpers.h"
 #include "video-utils.h"
+#include "xplayer-trace.h"
 
 #define PL_LEN (gtk_tree_model_iter_n_children (playlist->priv->model, NULL))
 
@@ -1751,10 +1752,13 @@ xplayer_playlist_add_one_mrl (XplayerPlaylist *playlist,
 	GMount *mount;
 	GFile *file;
 	int pos;
+	gint64 trace_start;
 
 	g_return_val_if_fail (XPLAYER_IS_PLAYLIST (playlist), FALSE);
 	g_return_val_if_fail (mrl != NULL, FALSE);
 
+	trace_start = xplayer_trace_begin ();
+
 	if (display_name == NULL || *display_name == '\0')
 		filename_for_display = xplayer_playlist_mrl_to_title (mrl);
 	else
@@ -1830,6 +1834,8 @@ xplayer_playlist_add_one_mrl (XplayerPlaylist *playlist,
 			NULL);
 	xplayer_playlist_update_save_button (playlist);
 
+	xplayer_trace_end_with_detail ("xplayer_playlist_add_one_mrl", trace_start, "%s", mrl);
+
 	return TRUE;
 }
 
@@ -1954,6 +1960,7 @@ typedef struct {
 	guint next_index_to_add;
 	GList *unadded_entries; /* list of XplayerPlaylistMrlDatas */
 	volatile gint entries_remaining;
+	gint64 trace_start;
 } AddMrlsOperationData;
 
 static void
@@ -2042,6 +2049,8 @@ add_mrls_finish_operation (AddMrlsOperationData *operation_data)
 		g_simple_async_result_complete (async_result);
 		g_object_unref (async_result);
 
+		xplayer_trace_end_with_detail ("xplayer_playlist_add_mrls", operation_data->trace_start,
+					       "%u items", operation_data->next_index_to_add);
 		add_mrls_operation_data_free (operation_data);
 	}
 }
@@ -2140,6 +2149,7 @@ xplayer_playlist_add_mrls (XplayerPlaylist *self,
 	operation_data->next_index_to_add = mrl_index;
 	operation_data->unadded_entries = NULL;
 	g_atomic_int_set (&(operation_data->entries_remaining), 1);
+	operation_data->trace_start = xplayer_trace_begin ();
 
 	/* Display a waiting cursor if required */
 	if (cursor)
@@ -43,6 +43,7 @@
 #include "video-utils.h"
 #include "xplayer-subtitle-encoding.h"
 #include "xplayer-plugins-engine.h"
+#include "xplayer-trace.h"
 
 #define PWID(x) (GtkWidget *) gtk_builder_get_object (xplayer->prefs_xml, x)
 #define POBJ(x) gtk_builder_get_object (xplayer->prefs_xml, x)
@@ -74,6 +75,9 @@ lock_screensaver_on_audio_changed_cb (GSettings *settings, const gchar *key, Xpl
 	GObject *item, *radio;
 	gboolean value;
 
+	if (xplayer->prefs_xml == NULL)
+		return;
+
 	item = POBJ ("tpw_audio_toggle_button");
 	g_signal_handlers_disconnect_by_func (item,
 					      audio_screensaver_button_toggled_cb, xplayer);
@@ -133,9 +137,11 @@ font_changed_cb (GSettings *settings, const gchar *key, XplayerObject *xplayer)
 	gchar *font;
 	GtkFontButton *item;
 
-	item = GTK_FONT_BUTTON (POBJ ("font_sel_button"));
 	font = g_settings_get_string (settings, "subtitle-font");
-	gtk_font_button_set_font_name (item, font);
+	if (xplayer->prefs_xml != NULL) {
+		item = GTK_FONT_BUTTON (POBJ ("font_sel_button"));
+		gtk_font_button_set_font_name (item, font);
+	}
 	bacon_video_widget_set_subtitle_font (xplayer->bvw, font);
 	g_free (font);
 }
@@ -146,9 +152,11 @@ encoding_changed_cb (GSettings *settings, const gchar *key, XplayerObject *xplay
 	gchar *encoding;
 	GtkComboBox *item;
 
-	item = GTK_COMBO_BOX (POBJ ("subtitle_encoding_combo"));
 	encoding = g_settings_get_string (settings, "subtitle-encoding");
-	xplayer_subtitle_encoding_set (item, encoding);
+	if (xplayer->prefs_xml != NULL) {
+		item = GTK_COMBO_BOX (POBJ ("subtitle_encoding_combo"));
+		xplayer_subtitle_encoding_set (item, encoding);
+	}
 	bacon_video_widget_set_subtitle_encoding (xplayer->bvw, encoding);
 	g_free (encoding);
 }
@@ -204,32 +212,128 @@ prefer_dark_theme_changed_cb (GSettings *settings,
 
 }
 
+static struct {
+	const char *name;
+	BvwVideoProperty prop;
+	const char *label;
+	const gchar *key;
+	const gchar *adjustment;
+} props[4] = {
+	{ "tpw_contrast_scale", BVW_VIDEO_CONTRAST, "tpw_contrast_label", "contrast", "tpw_contrast_adjustment" },
+	{ "tpw_saturation_scale", BVW_VIDEO_SATURATION, "tpw_saturation_label", "saturation", "tpw_saturation_adjustment" },
+	{ "tpw_bright_scale", BVW_VIDEO_BRIGHTNESS, "tpw_brightness_label", "brightness", "tpw_bright_adjustment" },
+	{ "tpw_hue_scale", BVW_VIDEO_HUE, "tpw_hue_label", "hue", "tpw_hue_adjustment" }
+};
+
+/**
+ * xplayer_setup_preferences:
+ * @xplayer: a #XplayerObject
+ *
+ * Applies the settings which affect playback to the video widget, and
+ * keeps them applied. This doesn't need the preferences dialogue, which
+ * only gets built when first shown, see xplayer_show_preferences().
+ **/
 void
 xplayer_setup_preferences (Xplayer *xplayer)
 {
-	GtkWidget *menu, *content_area, *bvw;
+	GtkWidget *bvw;
+	guint i;
+	char *font, *encoding;
+
+	g_return_if_fail (xplayer->settings != NULL);
+
+	bvw = xplayer_get_video_widget (xplayer);
+
+	/* Remember position */
+	g_settings_bind (xplayer->settings, "remember-position", xplayer, "remember-position", G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+
+	/* Auto-resize */
+	g_settings_bind (xplayer->settings, "auto-resize", bvw, "auto-resize", G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+
+	/* Screensaver audio locking */
+	g_signal_connect (xplayer->settings, "changed::lock-screensaver-on-audio", (GCallback) lock_screensaver_on_audio_changed_cb, xplayer);
+
+	/* Disable deinterlacing */
+	g_settings_bind (xplayer->settings, "disable-deinterlacing", bvw, "deinterlacing",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY | G_SETTINGS_BIND_INVERT_BOOLEAN);
+
+	/* Adaptive quality */
+	g_settings_bind (xplayer->settings, "adaptive-quality", bvw, "adaptive-quality",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+
+	/* Loudness normalisation */
+	g_settings_bind (xplayer->settings, "loudness-normalization", bvw, "loudness-normalization",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+
+	/* Network buffering */
+	g_settings_bind (xplayer->settings, "network-buffering-mode", bvw, "buffering-mode",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+	g_settings_bind (xplayer->settings, "network-ring-buffer-size", bvw, "ring-buffer-size",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+	g_settings_bind (xplayer->settings, "network-buffer-threshold", bvw, "buffer-duration",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+	g_settings_bind (xplayer->settings, "network-buffer-low-watermark", bvw, "low-watermark",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+	g_settings_bind (xplayer->settings, "network-buffer-high-watermark", bvw, "high-watermark",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+
+	/* Prefer dark theme */
+	g_signal_connect(xplayer->settings, "changed::prefer-dark-theme", (GCallback) prefer_dark_theme_changed_cb, xplayer);
+
+	/* Brightness and all */
+	for (i = 0; i < G_N_ELEMENTS (props); i++)
+		g_settings_bind (xplayer->settings, props[i].key, bvw, props[i].key, G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+
+	/* Sound output type */
+	g_settings_bind (xplayer->settings, "audio-output-type", bvw, "audio-output-type",
+	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
+
+	/* Subtitle font selection */
+	font = g_settings_get_string (xplayer->settings, "subtitle-font");
+	if (*font != '\0')
+		bacon_video_widget_set_subtitle_font (xplayer->bvw, font);
+	g_free (font);
+	g_signal_connect (xplayer->settings, "changed::subtitle-font", (GCallback) font_changed_cb, xplayer);
+
+	/* Subtitle encoding selection, making sure the default is UTF-8 */
+	encoding = g_settings_get_string (xplayer->settings, "subtitle-encoding");
+	if (*encoding == '\0') {
+		g_free (encoding);
+		encoding = g_strdup ("UTF-8");
+	}
+	bacon_video_widget_set_subtitle_encoding (xplayer->bvw, encoding);
+	g_free (encoding);
+	g_signal_connect (xplayer->settings, "changed::subtitle-encoding", (GCallback) encoding_changed_cb, xplayer);
+
+	/* Disable keyboard shortcuts */
+	xplayer->disable_kbd_shortcuts = g_settings_get_boolean (xplayer->settings, "disable-keyboard-shortcuts");
+	g_signal_connect (xplayer->settings, "changed::disable-keyboard-shortcuts", (GCallback) disable_kbd_shortcuts_changed_cb, xplayer);
+
+	g_object_unref (bvw);
+}
+
+static void
+preferences_destroyed_cb (GtkWidget *dialog, Xplayer *xplayer)
+{
+	g_clear_object (&xplayer->prefs_xml);
+}
+
+static gboolean
+build_preferences (Xplayer *xplayer)
+{
+	GtkWidget *content_area;
 	gboolean lock_screensaver_on_audio;
 	guint i, hidden;
 	char *font, *encoding;
 	GtkWidget *widget;
 	GObject *item;
+	gint64 trace_start;
 
-	static struct {
-		const char *name;
-		BvwVideoProperty prop;
-		const char *label;
-		const gchar *key;
-		const gchar *adjustment;
-	} props[4] = {
-		{ "tpw_contrast_scale", BVW_VIDEO_CONTRAST, "tpw_contrast_label", "contrast", "tpw_contrast_adjustment" },
-		{ "tpw_saturation_scale", BVW_VIDEO_SATURATION, "tpw_saturation_label", "saturation", "tpw_saturation_adjustment" },
-		{ "tpw_bright_scale", BVW_VIDEO_BRIGHTNESS, "tpw_brightness_label", "brightness", "tpw_bright_adjustment" },
-		{ "tpw_hue_scale", BVW_VIDEO_HUE, "tpw_hue_label", "hue", "tpw_hue_adjustment" }
-	};
-
-	g_return_if_fail (xplayer->settings != NULL);
+	trace_start = xplayer_trace_begin ();
 
-	bvw = xplayer_get_video_widget (xplayer);
+	xplayer->prefs_xml = xplayer_interface_load ("preferences.ui", FALSE, GTK_WINDOW (xplayer->win), xplayer);
+	if (xplayer->prefs_xml == NULL)
+		return FALSE;
 
 	/* Work-around builder dialogue not parenting properly for
 	 * On top windows */
@@ -254,16 +358,16 @@ xplayer_setup_preferences (Xplayer *xplayer)
 			G_CALLBACK (gtk_widget_hide_on_delete), NULL);
         g_signal_connect (xplayer->prefs, "destroy",
                           G_CALLBACK (gtk_widget_destroyed), &xplayer->prefs);
+	g_signal_connect (xplayer->prefs, "destroy",
+			  G_CALLBACK (preferences_destroyed_cb), xplayer);
 
 	/* Remember position */
 	item = POBJ ("tpw_remember_position_checkbutton");
 	g_settings_bind (xplayer->settings, "remember-position", item, "active", G_SETTINGS_BIND_DEFAULT);
-	g_settings_bind (xplayer->settings, "remember-position", xplayer, "remember-position", G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
 
 	/* Auto-resize */
 	item = POBJ ("tpw_display_checkbutton");
 	g_settings_bind (xplayer->settings, "auto-resize", item, "active", G_SETTINGS_BIND_DEFAULT);
-	g_settings_bind (xplayer->settings, "auto-resize", bvw, "auto-resize", G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
 
 	/* Screensaver audio locking */
 	lock_screensaver_on_audio = g_settings_get_boolean (xplayer->settings, "lock-screensaver-on-audio");
@@ -272,18 +376,14 @@ xplayer_setup_preferences (Xplayer *xplayer)
 	else
 		item = POBJ ("tpw_video_toggle_button");
 	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (item), TRUE);
-	g_signal_connect (xplayer->settings, "changed::lock-screensaver-on-audio", (GCallback) lock_screensaver_on_audio_changed_cb, xplayer);
 
 	/* Disable deinterlacing */
 	item = POBJ ("tpw_no_deinterlace_checkbutton");
 	g_settings_bind (xplayer->settings, "disable-deinterlacing", item, "active", G_SETTINGS_BIND_DEFAULT);
-	g_settings_bind (xplayer->settings, "disable-deinterlacing", bvw, "deinterlacing",
-	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY | G_SETTINGS_BIND_INVERT_BOOLEAN);
 
 	/* Prefer dark theme */
 	item = POBJ ("tpw_prefer_dark_theme_checkbutton");
 	g_settings_bind (xplayer->settings, "prefer-dark-theme", item, "active", G_SETTINGS_BIND_DEFAULT);
-	g_signal_connect(xplayer->settings, "changed::prefer-dark-theme", (GCallback) prefer_dark_theme_changed_cb, xplayer);
 
 	/* Auto-load subtitles */
 	item = POBJ ("tpw_auto_subtitles_checkbutton");
@@ -304,7 +404,6 @@ xplayer_setup_preferences (Xplayer *xplayer)
 
 		item = POBJ (props[i].adjustment);
 		g_settings_bind (xplayer->settings, props[i].key, item, "value", G_SETTINGS_BIND_DEFAULT);
-		g_settings_bind (xplayer->settings, props[i].key, bvw, props[i].key, G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
 
 		prop_value = bacon_video_widget_get_video_property (xplayer->bvw, props[i].prop);
 		if (prop_value < 0) {
@@ -326,8 +425,6 @@ xplayer_setup_preferences (Xplayer *xplayer)
 
 	/* Sound output type */
 	item = POBJ ("tpw_sound_output_combobox");
-	g_settings_bind (xplayer->settings, "audio-output-type", bvw, "audio-output-type",
-	                 G_SETTINGS_BIND_DEFAULT | G_SETTINGS_BIND_NO_SENSITIVITY);
 	g_settings_bind_with_mapping (xplayer->settings, "audio-output-type", item, "active", G_SETTINGS_BIND_DEFAULT,
 	                              (GSettingsBindGetMapping) int_enum_get_mapping, (GSettingsBindSetMapping) int_enum_set_mapping,
 	                              g_type_class_ref (BVW_TYPE_AUDIO_OUTPUT_TYPE), (GDestroyNotify) g_type_class_unref);
@@ -337,12 +434,9 @@ xplayer_setup_preferences (Xplayer *xplayer)
 	gtk_font_button_set_title (GTK_FONT_BUTTON (item),
 				   _("Select Subtitle Font"));
 	font = g_settings_get_string (xplayer->settings, "subtitle-font");
-	if (*font != '\0') {
+	if (*font != '\0')
 		gtk_font_button_set_font_name (GTK_FONT_BUTTON (item), font);
-		bacon_video_widget_set_subtitle_font (xplayer->bvw, font);
-	}
 	g_free (font);
-	g_signal_connect (xplayer->settings, "changed::subtitle-font", (GCallback) font_changed_cb, xplayer);
 
 	/* Subtitle encoding selection */
 	item = POBJ ("subtitle_encoding_combo");
@@ -354,15 +448,24 @@ xplayer_setup_preferences (Xplayer *xplayer)
 		encoding = g_strdup ("UTF-8");
 	}
 	xplayer_subtitle_encoding_set (GTK_COMBO_BOX(item), encoding);
-	if (encoding && strcasecmp (encoding, "") != 0) {
-		bacon_video_widget_set_subtitle_encoding (xplayer->bvw, encoding);
-	}
 	g_free (encoding);
-	g_signal_connect (xplayer->settings, "changed::subtitle-encoding", (GCallback) encoding_changed_cb, xplayer);
 
-	/* Disable keyboard shortcuts */
-	xplayer->disable_kbd_shortcuts = g_settings_get_boolean (xplayer->settings, "disable-keyboard-shortcuts");
-	g_signal_connect (xplayer->settings, "changed::disable-keyboard-shortcuts", (GCallback) disable_kbd_shortcuts_changed_cb, xplayer);
+	xplayer_trace_end ("build_preferences", trace_start);
 
-	g_object_unref (bvw);
+	return TRUE;
+}
+
+/**
+ * xplayer_show_preferences:
+ * @xplayer: a #XplayerObject
+ *
+ * Shows the preferences dialogue, building it the first time.
+ **/
+void
+xplayer_show_preferences (Xplayer *xplayer)
+{
+	if (xplayer->prefs == NULL && build_preferences (xplayer) == FALSE)
+		return;
+
+	gtk_widget_show (xplayer->prefs);
 }
@@ -32,6 +32,7 @@
 G_BEGIN_DECLS
 
 void xplayer_setup_preferences (Xplayer *xplayer);
+void xplayer_show_preferences (Xplayer *xplayer);
 
 G_END_DECLS
 
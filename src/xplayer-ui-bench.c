@@ -0,0 +1,179 @@
+/*
+ * Benchmark for the parsing of the UI files at startup
+ *
+ * Builds each of the UI files the player loads, from the resources
+ * compiled into the player and from the files in the source tree, so that
+ * the two can be compared, and prints the percentiles of each as JSON.
+ * Needs a display, as GtkBuilder creates the widgets.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <gtk/gtk.h>
+
+#include "xplayer-interface.h"
+#include "xplayer-time-label.h"
+
+static const char *ui_files[] = {
+	"xplayer.ui",
+	"fullscreen.ui",
+	"playlist.ui",
+	"preferences.ui",
+	"properties.ui",
+	"uri.ui"
+};
+
+static int n_runs = 20;
+static char *srcdir = NULL;
+static char *output = NULL;
+
+static gint
+compare_doubles (gconstpointer a, gconstpointer b)
+{
+	gdouble da = *(const gdouble *) a;
+	gdouble db = *(const gdouble *) b;
+
+	return (da > db) - (da < db);
+}
+
+static gdouble
+percentile (GArray *samples, guint p)
+{
+	return g_array_index (samples, gdouble, (samples->len - 1) * p / 100);
+}
+
+/* Builds @path @n_runs times, appending the times taken to @samples,
+ * in milliseconds */
+static gboolean
+run_builds (const char *path, gboolean resource, GArray *samples)
+{
+	int run;
+
+	for (run = 0; run < n_runs; run++) {
+		GtkBuilder *builder;
+		GError *error = NULL;
+		gint64 start;
+		gdouble msecs;
+		gboolean ret;
+
+		start = g_get_monotonic_time ();
+		builder = gtk_builder_new ();
+		gtk_builder_set_translation_domain (builder, GETTEXT_PACKAGE);
+		if (resource != FALSE)
+			ret = gtk_builder_add_from_resource (builder, path, &error);
+		else
+			ret = gtk_builder_add_from_file (builder, path, &error);
+		msecs = (g_get_monotonic_time () - start) / 1000.0;
+
+		g_object_unref (builder);
+
+		if (ret == FALSE) {
+			g_printerr ("Failed to build %s: %s\n", path, error->message);
+			g_error_free (error);
+			return FALSE;
+		}
+
+		g_array_append_val (samples, msecs);
+	}
+
+	return TRUE;
+}
+
+static void
+append_samples (GString *str, const char *name, GArray *samples, gboolean last)
+{
+	char buf[3][G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_string_append_printf (str, "      \"%s\": { \"count\": %u", name, samples->len);
+	if (samples->len > 0) {
+		g_array_sort (samples, compare_doubles);
+		/* Don't let the locale put commas in our numbers */
+		g_ascii_formatd (buf[0], sizeof (buf[0]), "%.3f", g_array_index (samples, gdouble, 0));
+		g_ascii_formatd (buf[1], sizeof (buf[1]), "%.3f", percentile (samples, 50));
+		g_ascii_formatd (buf[2], sizeof (buf[2]), "%.3f", percentile (samples, 90));
+		g_string_append_printf (str, ", \"min_ms\": %s, \"p50_ms\": %s, \"p90_ms\": %s",
+					buf[0], buf[1], buf[2]);
+	}
+	g_string_append_printf (str, " }%s\n", last ? "" : ",");
+}
+
+static GOptionEntry option_entries [] = {
+	{ "runs", 0, 0, G_OPTION_ARG_INT, &n_runs, "Number of times to build each file", "N" },
+	{ "srcdir", 0, 0, G_OPTION_ARG_FILENAME, &srcdir, "Directory to load the UI files from, instead of the source tree", "DIR" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the JSON results to FILE instead of stdout", "FILE" },
+	{ NULL }
+};
+
+int
+main (int argc, char **argv)
+{
+	GError *error = NULL;
+	GString *str;
+	gboolean ok = TRUE;
+	guint i;
+
+	if (gtk_init_with_args (&argc, &argv, "- Benchmark the parsing of the UI files",
+				option_entries, GETTEXT_PACKAGE, &error) == FALSE) {
+		g_printerr ("Failed to initialise: %s\n", error ? error->message : "no display");
+		g_clear_error (&error);
+		return 1;
+	}
+
+	/* Registered up front, so that looking it up isn't timed */
+	g_type_class_unref (g_type_class_ref (XPLAYER_TYPE_TIME_LABEL));
+
+	str = g_string_new ("{\n  \"files\": {\n");
+	for (i = 0; i < G_N_ELEMENTS (ui_files); i++) {
+		GArray *from_resource, *from_file;
+		char *path;
+
+		from_resource = g_array_new (FALSE, FALSE, sizeof (gdouble));
+		from_file = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+		path = g_strconcat (XPLAYER_INTERFACE_RESOURCE_PATH, ui_files[i], NULL);
+		ok = run_builds (path, TRUE, from_resource) && ok;
+		g_free (path);
+
+		path = g_build_filename (srcdir ? srcdir : UI_SRCDIR, ui_files[i], NULL);
+		ok = run_builds (path, FALSE, from_file) && ok;
+		g_free (path);
+
+		g_string_append_printf (str, "    \"%s\": {\n", ui_files[i]);
+		append_samples (str, "resource", from_resource, FALSE);
+		append_samples (str, "file", from_file, TRUE);
+		g_string_append_printf (str, "    }%s\n", i + 1 < G_N_ELEMENTS (ui_files) ? "," : "");
+
+		g_array_free (from_resource, TRUE);
+		g_array_free (from_file, TRUE);
+	}
+	g_string_append (str, "  }\n}\n");
+
+	if (output != NULL) {
+		if (!g_file_set_contents (output, str->str, str->len, &error)) {
+			g_printerr ("Failed to write %s: %s\n", output, error->message);
+			g_error_free (error);
+			ok = FALSE;
+		}
+	} else {
+		g_print ("%s", str->str);
+	}
+
+	g_string_free (str, TRUE);
+
+	return ok ? 0 : 1;
+}
@@ -46,6 +46,7 @@
 #include <sys/stat.h>
 
 #include "gst/xplayer-gst-helpers.h"
+#include "gst/xplayer-gst-registry-cache.h"
 #include "gst/xplayer-time-helpers.h"
 #include "gst/xplayer-gst-pixbuf-helpers.h"
 #include "video-utils.h"
@@ -371,11 +372,18 @@ thumb_app_setup_play (ThumbApp *app)
 	registry = gst_registry_get ();
 
 	for (i = 0; i < G_N_ELEMENTS (blacklisted_plugins); i++) {
-		GstPlugin *plugin =
-			gst_registry_find_plugin (registry,
-						  blacklisted_plugins[i]);
-		if (plugin)
+		GstPlugin *plugin;
+
+		/* Which is usually none of them, so don't touch the registry */
+		if (!xplayer_gst_registry_cache_has_plugin (blacklisted_plugins[i]))
+			continue;
+
+		plugin = gst_registry_find_plugin (registry,
+						   blacklisted_plugins[i]);
+		if (plugin) {
 			gst_registry_remove_plugin (registry, plugin);
+			gst_object_unref (plugin);
+		}
 	}
 }
 
@@ -854,6 +862,9 @@ int main (int argc, char *argv[])
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
 
+	/* GStreamer gets initialised when parsing the options */
+	xplayer_gst_registry_cache_init ();
+
 	context = g_option_context_new ("Thumbnail movies");
 	options = gst_init_get_option_group ();
 	g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
@@ -908,6 +919,7 @@ int main (int argc, char *argv[])
 	app.input = input;
 	app.output = output;
 
+	xplayer_gst_registry_cache_update ();
 	thumb_app_setup_play (&app);
 	thumb_app_set_filename (&app);
 
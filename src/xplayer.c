@@ -49,9 +49,12 @@
 #include "xplayer-uri.h"
 #include "xplayer-preferences.h"
 #include "xplayer-rtl-helpers.h"
+#include "xplayer-trace.h"
 #include "xplayer-sidebar.h"
 #include "video-utils.h"
 
+#define XPLAYER_APPLICATION_ID "org.x.Player"
+
 static gboolean startup_called = FALSE;
 
 /* Debug log message handler: discards debug messages unless Xplayer is run with XPLAYER_DEBUG=1.
@@ -147,7 +150,7 @@ app_init (Xplayer *xplayer, char **argv)
 	xplayer->controls_visibility = XPLAYER_CONTROLS_UNDEFINED;
 
 	/* Show ! (again) the video widget this time. */
-	video_widget_create (xplayer);
+	XPLAYER_TRACE ("video_widget_create", video_widget_create (xplayer));
 	gtk_widget_grab_focus (GTK_WIDGET (xplayer->bvw));
 	xplayer_fullscreen_set_video_widget (xplayer->fs, xplayer->bvw);
 
@@ -157,9 +160,8 @@ app_init (Xplayer *xplayer, char **argv)
 		xplayer_action_fullscreen (xplayer, TRUE);
 	}
 
-	/* The prefs after the video widget is connected */
-	xplayer->prefs_xml = xplayer_interface_load ("preferences.ui", TRUE, NULL, xplayer);
-
+	/* The prefs after the video widget is connected, the dialogue
+	 * only being built when first shown */
 	xplayer_setup_preferences (xplayer);
 
 	xplayer_setup_recent (xplayer);
@@ -169,7 +171,7 @@ app_init (Xplayer *xplayer, char **argv)
 
 	/* Initialise all the plugins, and set the default page, in case
 	 * it comes from a plugin */
-	xplayer_object_plugins_init (xplayer);
+	XPLAYER_TRACE ("xplayer_object_plugins_init", xplayer_object_plugins_init (xplayer));
 	xplayer_sidebar_set_current_page (xplayer, sidebar_pageid, FALSE);
 	g_free (sidebar_pageid);
 
@@ -195,6 +197,12 @@ app_startup (GApplication *application,
 	 * when we set everything up.
 	 * Note that this will break D-Bus activation of the application */
 	startup_called = TRUE;
+
+	/* But the video widget's pipeline can be built while the
+	 * options are processed and the interface loads, unless they
+	 * have GStreamer's, which initialise it on this thread */
+	if (xplayer_options_gst_init_deferred () != FALSE)
+		bacon_video_widget_preload ();
 }
 
 static int
@@ -225,7 +233,7 @@ app_command_line (GApplication             *app,
 	/* Don't create another window if we're remote.
 	 * We can't use g_application_get_is_remote() because it's not registered yet */
 	if (startup_called != FALSE) {
-		app_init (xplayer, argv);
+		XPLAYER_TRACE ("app_init", app_init (xplayer, argv));
 
 		gdk_notify_startup_complete ();
 
@@ -242,16 +250,129 @@ app_command_line (GApplication             *app,
 	return 0;
 }
 
+/* A bare GApplication, which passes the startup notification ID along
+ * like GtkApplication does, so that the running instance can complete it */
+typedef GApplication XplayerLauncher;
+typedef GApplicationClass XplayerLauncherClass;
+
+static GType xplayer_launcher_get_type (void);
+G_DEFINE_TYPE (XplayerLauncher, xplayer_launcher, G_TYPE_APPLICATION)
+
+static void
+xplayer_launcher_add_platform_data (GApplication    *application,
+				    GVariantBuilder *builder)
+{
+	const char *startup_id;
+
+	G_APPLICATION_CLASS (xplayer_launcher_parent_class)->add_platform_data (application, builder);
+
+	startup_id = g_getenv ("DESKTOP_STARTUP_ID");
+	if (startup_id != NULL && g_utf8_validate (startup_id, -1, NULL) != FALSE)
+		g_variant_builder_add (builder, "{sv}", "desktop-startup-id", g_variant_new_string (startup_id));
+}
+
+/* Parses the command line here, as xplayer_object_local_command_line()
+ * would, so that --help, --version and errors are handled locally, and
+ * relative paths don't get resolved in the running instance's directory */
+static gboolean
+xplayer_launcher_local_command_line (GApplication   *application,
+				     gchar        ***arguments,
+				     int            *exit_status)
+{
+	if (xplayer_options_parse_local (arguments) == FALSE) {
+		*exit_status = 1;
+		return TRUE;
+	}
+
+	*exit_status = 0;
+	return FALSE;
+}
+
+static void
+xplayer_launcher_class_init (XplayerLauncherClass *klass)
+{
+	klass->local_command_line = xplayer_launcher_local_command_line;
+	klass->add_platform_data = xplayer_launcher_add_platform_data;
+}
+
+static void
+xplayer_launcher_init (XplayerLauncher *launcher)
+{
+}
+
+/* Forwards the command line to the running instance, if there's one,
+ * before anything else gets initialised, returning FALSE otherwise */
+static gboolean
+forward_to_running_instance (int argc, char **argv, int *status)
+{
+	GDBusConnection *connection;
+	GApplication *launcher;
+	GVariant *ret;
+	gboolean has_owner;
+	gint64 trace_start;
+
+	trace_start = xplayer_trace_begin ();
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+	if (connection == NULL)
+		return FALSE;
+
+	ret = g_dbus_connection_call_sync (connection,
+					   "org.freedesktop.DBus",
+					   "/org/freedesktop/DBus",
+					   "org.freedesktop.DBus",
+					   "NameHasOwner",
+					   g_variant_new ("(s)", XPLAYER_APPLICATION_ID),
+					   G_VARIANT_TYPE ("(b)"),
+					   G_DBUS_CALL_FLAGS_NO_AUTO_START,
+					   -1, NULL, NULL);
+	g_object_unref (connection);
+
+	if (ret == NULL)
+		return FALSE;
+	g_variant_get (ret, "(b)", &has_owner);
+	g_variant_unref (ret);
+
+	if (has_owner == FALSE)
+		return FALSE;
+
+	/* The instance could still go away before getting the command line,
+	 * in which case GApplication reports the error */
+	launcher = g_object_new (xplayer_launcher_get_type (),
+				 "application-id", XPLAYER_APPLICATION_ID,
+				 "flags", G_APPLICATION_HANDLES_COMMAND_LINE | G_APPLICATION_IS_LAUNCHER,
+				 NULL);
+	*status = g_application_run (launcher, argc, argv);
+	g_object_unref (launcher);
+
+	xplayer_trace_end ("forward_to_running_instance", trace_start);
+
+	return TRUE;
+}
+
 int
 main (int argc, char **argv)
 {
 	Xplayer *xplayer;
+	int status;
+
+	xplayer_trace_init ();
 
 	setlocale (LC_ALL, "");
 	bindtextdomain (GETTEXT_PACKAGE, GNOMELOCALEDIR);
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
 
+	g_type_init ();
+
+	/* Only the primary instance needs GStreamer, see app_startup() */
+	xplayer_options_defer_gst_init (argc, argv);
+
+	/* Opening files from the file manager while we're running shouldn't
+	 * pay for setting up X, GTK+ and GStreamer */
+	if (forward_to_running_instance (argc, argv, &status) != FALSE)
+		return status;
+
 #ifdef GDK_WINDOWING_X11
 	if (XInitThreads () == 0)
 	{
@@ -261,8 +382,6 @@ main (int argc, char **argv)
 	}
 #endif
 
-	g_type_init ();
-
 	g_set_prgname ("xplayer");
 	g_set_application_name (_("Media Player"));
 	gtk_window_set_default_icon_name ("xplayer");
@@ -271,7 +390,7 @@ main (int argc, char **argv)
 
 	/* Build the main Xplayer object */
 	xplayer = g_object_new (XPLAYER_TYPE_OBJECT,
-			      "application-id", "org.x.Player",
+			      "application-id", XPLAYER_APPLICATION_ID,
 			      "flags", G_APPLICATION_HANDLES_COMMAND_LINE,
 			      NULL);
 	xplayer->settings = g_settings_new (XPLAYER_GSETTINGS_SCHEMA);